@@ -0,0 +1,304 @@
+#ifndef __ASCIIFORMAT_H__
+#define __ASCIIFORMAT_H__
+/** @file AsciiFormat.h
+	Contains the number formatting used by Image::writeToAscii() and
+	Image::readFromAscii().
+	The functions write into a caller supplied character buffer and return the
+	end of what was written, in the manner of std::to_chars.  Real numbers are
+	written with the fewest significant digits that read back to the same value,
+	and a '.' is always used as the decimal point regardless of the C locale.
+*/
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <clocale>
+#include <complex>
+#include <sstream>
+
+namespace ImageTL
+{
+	/** Definitions used to specify the layout of an ASCII image file.
+		@see Image::writeToAscii()
+	*/
+	enum ascii_format
+	{
+		ascii_aligned,	/*!< Values are right aligned in fixed width columns
+						separated by a space.*/
+		ascii_csv,		/*!< Values are separated by a comma.*/
+		ascii_tsv		/*!< Values are separated by a tab.*/
+	};
+
+	// Returns true for the characters that may separate two values on a row
+	inline bool ascii_is_delimiter(char c)
+	{
+		return (c == ' ' || c == '\t' || c == ',' || c == ';' || c == '\r');
+	}
+
+	// Writes the decimal digits of n and returns the end of the output
+	inline char* ascii_write_unsigned(char *out, unsigned long long n)
+	{
+		static const char digitPairs[201] =
+			"00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+			"40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+			"8081828384858687888990919293949596979899";
+
+		char reversed[24], *r = reversed + sizeof(reversed);
+		while(n >= 100)
+		{
+			const char *pair = digitPairs + 2*(n%100);
+			n /= 100;
+			*(--r) = pair[1];
+			*(--r) = pair[0];
+		}
+		if(n >= 10)
+		{
+			const char *pair = digitPairs + 2*n;
+			*(--r) = pair[1];
+			*(--r) = pair[0];
+		}
+		else {
+			*(--r) = char('0' + n); }
+
+		size_t length = reversed + sizeof(reversed) - r;
+		memcpy(out, r, length);
+		return out + length;
+	}
+
+	inline char* ascii_write_signed(char *out, long long n)
+	{
+		if(n < 0)
+		{
+			*(out++) = '-';
+			return ascii_write_unsigned(out, 0ULL - (unsigned long long)n);
+		}
+		return ascii_write_unsigned(out, (unsigned long long)n);
+	}
+
+	// Replaces the decimal point of the current C locale with '.'
+	inline void ascii_fix_decimal_point(char *first, char *last)
+	{
+		char point = *localeconv()->decimal_point;
+		if(point == '.') {
+			return; }
+		for(; first != last; ++first) {
+			if(*first == point) {
+				*first = '.'; } }
+	}
+
+	/** Writes a real number.
+		@param out The output buffer, which must hold at least 48 characters.
+		@param n The value to write.
+		@param precision The number of significant digits, or zero to use the
+			shortest representation that reads back to the same value.
+		@param single If true the shortest representation only needs to round
+			trip through a float.
+		@return The end of the output.
+	*/
+	inline char* ascii_write_real(char *out, double n, int precision, bool single)
+	{
+		if(n != n)
+		{
+			memcpy(out, "nan", 3);
+			return out + 3;
+		}
+		if(n > 1.7976931348623157e308 || n < -1.7976931348623157e308)
+		{
+			if(n < 0) {
+				*(out++) = '-'; }
+			memcpy(out, "inf", 3);
+			return out + 3;
+		}
+
+		int length;
+		if(precision > 0)
+		{
+			length = snprintf(out, 48, "%.*g", (precision > 40)?40:precision, n);
+		}
+		else
+		{
+			// Most pixels of real images hold whole numbers
+			if(n == std::floor(n) && std::fabs(n) < 1e15 && !(n == 0 && std::signbit(n))) {
+				return ascii_write_signed(out, (long long)n); }
+
+			int p = single?6:15, pMax = single?9:17;
+			for(; p < pMax; p++)
+			{
+				length = snprintf(out, 48, "%.*g", p, n);
+				if(single ? (strtof(out, NULL) == (float)n) : (strtod(out, NULL) == n)) {
+					break; }
+			}
+			if(p == pMax) {
+				length = snprintf(out, 48, "%.*g", p, n); }
+		}
+
+		ascii_fix_decimal_point(out, out + length);
+		return out + length;
+	}
+
+	// Reads a real number written with '.' as the decimal point
+	inline const char* ascii_parse_real(const char *first, double &n)
+	{
+		char point = *localeconv()->decimal_point;
+		char *end;
+		if(point == '.')
+		{
+			n = strtod(first, &end);
+			return (end == first) ? NULL : end;
+		}
+
+		char token[64];
+		size_t length = 0;
+		while(length < sizeof(token) - 1 && first[length] != 0 && !ascii_is_delimiter(first[length]) &&
+			  first[length] != '\n' && first[length] != ')') {
+			token[length] = (first[length] == '.') ? point : first[length];
+			length++;
+		}
+		token[length] = 0;
+		n = strtod(token, &end);
+		return (end == token) ? NULL : first + (end - token);
+	}
+
+	// Reads an integer, falling back on a real number for values such as 2.0 or 1e3
+	inline const char* ascii_parse_integer(const char *first, long long &n)
+	{
+		const char *p = first;
+		bool negative = false;
+		if(*p == '-' || *p == '+') {
+			negative = (*(p++) == '-'); }
+
+		if(*p < '0' || *p > '9')
+		{
+			double real;
+			const char *end = ascii_parse_real(first, real);
+			n = (long long)std::floor(real + 0.5);
+			return end;
+		}
+
+		unsigned long long value = 0;
+		for(; *p >= '0' && *p <= '9'; ++p) {
+			value = value*10 + (*p - '0'); }
+
+		if(*p == '.' || *p == 'e' || *p == 'E')
+		{
+			double real;
+			const char *end = ascii_parse_real(first, real);
+			n = (long long)std::floor(real + 0.5);
+			return end;
+		}
+
+		n = negative ? -(long long)value : (long long)value;
+		return p;
+	}
+
+	/** @class ascii_traits
+		Formats and parses a single pixel value.
+		The general version uses the stream operators of the type, while the
+		specializations for the instantiated types avoid the streams entirely.
+	*/
+	template<class Type> struct ascii_traits
+	{
+		enum { max_length = 64 };	///< The largest number of characters written by format().
+
+		static char* format(char *out, const Type &n, int precision)
+		{
+			std::ostringstream stream;
+			if(precision > 0) {
+				stream.precision(precision); }
+			stream<<n;
+			std::string s = stream.str().substr(0, max_length);
+			memcpy(out, s.data(), s.size());
+			return out + s.size();
+		}
+
+		static const char* parse(const char *first, Type &n)
+		{
+			const char *last = first;
+			while(*last != 0 && *last != '\n' && !ascii_is_delimiter(*last)) {
+				++last; }
+			std::istringstream stream(std::string(first, last));
+			if(!(stream>>n)) {
+				return NULL; }
+			return last;
+		}
+	};
+
+	template<class Type> struct ascii_integer_traits
+	{
+		enum { max_length = 24 };
+
+		static char* format(char *out, const Type &n, int) { return ascii_write_signed(out, (long long)n); }
+
+		static const char* parse(const char *first, Type &n)
+		{
+			long long value;
+			const char *end = ascii_parse_integer(first, value);
+			n = Type(value);
+			return end;
+		}
+	};
+
+	template<class Type> struct ascii_real_traits
+	{
+		enum { max_length = 48 };
+
+		static char* format(char *out, const Type &n, int precision) { return ascii_write_real(out, (double)n, precision, sizeof(Type) < sizeof(double)); }
+
+		static const char* parse(const char *first, Type &n)
+		{
+			double value;
+			const char *end = ascii_parse_real(first, value);
+			n = Type(value);
+			return end;
+		}
+	};
+
+	template<> struct ascii_traits<char>   : public ascii_integer_traits<char>   {};
+	template<> struct ascii_traits<short>  : public ascii_integer_traits<short>  {};
+	template<> struct ascii_traits<unsigned char>  : public ascii_integer_traits<unsigned char>  {};
+	template<> struct ascii_traits<unsigned short> : public ascii_integer_traits<unsigned short> {};
+	template<> struct ascii_traits<int>    : public ascii_integer_traits<int>    {};
+	template<> struct ascii_traits<long>   : public ascii_integer_traits<long>   {};
+	template<> struct ascii_traits<float>  : public ascii_real_traits<float>     {};
+	template<> struct ascii_traits<double> : public ascii_real_traits<double>    {};
+
+	// Complex values are written as (real,imag), matching the stream operators
+	template<> struct ascii_traits<std::complex<double> >
+	{
+		enum { max_length = 2*48 + 3 };
+
+		static char* format(char *out, const std::complex<double> &n, int precision)
+		{
+			*(out++) = '(';
+			out = ascii_write_real(out, n.real(), precision, false);
+			*(out++) = ',';
+			out = ascii_write_real(out, n.imag(), precision, false);
+			*(out++) = ')';
+			return out;
+		}
+
+		static const char* parse(const char *first, std::complex<double> &n)
+		{
+			double re, im = 0;
+			if(*first != '(')
+			{
+				first = ascii_parse_real(first, re);
+				n = std::complex<double>(re, im);
+				return first;
+			}
+
+			if((first = ascii_parse_real(first + 1, re)) == NULL) {
+				return NULL; }
+			if(*first == ',' && (first = ascii_parse_real(first + 1, im)) == NULL) {
+				return NULL; }
+			if(*first != ')') {
+				return NULL; }
+
+			n = std::complex<double>(re, im);
+			return first + 1;
+		}
+	};
+}	// end namespace
+
+#endif
\ No newline at end of file
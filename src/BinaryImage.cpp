@@ -0,0 +1,235 @@
+/** @file BinaryImage.cpp
+	Contains function definitions that are declared in BinaryImage.h
+*/
+
+#include "BinaryImage.h"
+#include <algorithm>
+
+namespace ImageTL
+{
+	// Returns the number of set bits in a word
+	static inline int binary_popcount(BinaryImage::word w)
+	{
+#if defined(__GNUC__)
+		return __builtin_popcountll(w);
+#else
+		w = w - ((w >> 1) & 0x5555555555555555ULL);
+		w = (w & 0x3333333333333333ULL) + ((w >> 2) & 0x3333333333333333ULL);
+		w = (w + (w >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+		return (int)((w*0x0101010101010101ULL) >> 56);
+#endif
+	}
+
+	// Shifts a row so that bit x of dest is bit x + dx of src, where bits
+	// from outside the row are taken from fill
+	static void binary_shift(const BinaryImage::word *src, int words, int dx, BinaryImage::word fill, BinaryImage::word *dest)
+	{
+		const int bits = BinaryImage::word_bits;
+		int s = ((dx < 0)?-dx:dx)/bits, b = ((dx < 0)?-dx:dx)%bits;
+		auto at = [&](int k) { return (k < 0 || k >= words)?fill:src[k]; };
+
+		if(dx >= 0)
+		{
+			for(int k = 0; k < words; k++) {
+				dest[k] = (b == 0)?at(k + s):((at(k + s) >> b) | (at(k + s + 1) << (bits - b))); }
+		}
+		else
+		{
+			for(int k = 0; k < words; k++) {
+				dest[k] = (b == 0)?at(k - s):((at(k - s) << b) | (at(k - s - 1) >> (bits - b))); }
+		}
+	}
+
+	// Constructors
+	BinaryImage::BinaryImage(int width, int height, bool value)
+	{
+		if(width < 0 || height < 0) {
+			throw ImageException("BinaryImage::BinaryImage [The dimensions cannot be negative]"); }
+
+		m_width  = width;
+		m_height = height;
+		m_words  = (width + word_bits - 1)/word_bits;
+		m_data.assign((size_t)m_words*height, 0);
+		if(value) {
+			fill(true); }
+	}
+
+	// Access
+	BinaryImage::word BinaryImage::lastMask() const
+	{
+		int used = m_width%word_bits;
+		return (used == 0)?~word(0):((word(1) << used) - 1);
+	}
+
+	void BinaryImage::set(int x, int y, bool value)
+	{
+		word bit = word(1) << (x%word_bits);
+		if(value) {
+			row(y)[x/word_bits] |= bit; }
+		else {
+			row(y)[x/word_bits] &= ~bit; }
+	}
+
+	void BinaryImage::fill(bool value)
+	{
+		std::fill(m_data.begin(), m_data.end(), value?~word(0):word(0));
+		if(value && m_words > 0)
+		{
+			word mask = lastMask();
+			for(int y = 0; y < m_height; y++) {
+				row(y)[m_words - 1] &= mask; }
+		}
+	}
+
+	size_t BinaryImage::count() const
+	{
+		size_t total = 0;
+		for(size_t i = 0; i < m_data.size(); i++) {
+			total += binary_popcount(m_data[i]); }
+		return total;
+	}
+
+	size_t BinaryImage::count(int y) const
+	{
+		size_t total = 0;
+		const word *r = row(y);
+		for(int k = 0; k < m_words; k++) {
+			total += binary_popcount(r[k]); }
+		return total;
+	}
+
+	bool BinaryImage::any() const
+	{
+		for(size_t i = 0; i < m_data.size(); i++) {
+			if(m_data[i] != 0) {
+				return true; } }
+		return false;
+	}
+
+	// Logical operators
+	void BinaryImage::checkSize(const BinaryImage &right, const char *name) const
+	{
+		if(m_width != right.m_width || m_height != right.m_height)
+		{
+			std::stringstream msg_stream;
+			msg_stream<<"BinaryImage::operator"<<name<<" [Unmatched dimensions for operator]";
+			throw ImageException(msg_stream.str());
+		}
+	}
+
+	BinaryImage BinaryImage::operator~() const
+	{
+		BinaryImage result(*this);
+		for(size_t i = 0; i < result.m_data.size(); i++) {
+			result.m_data[i] = ~result.m_data[i]; }
+
+		if(m_words > 0)
+		{
+			word mask = lastMask();
+			for(int y = 0; y < m_height; y++) {
+				result.row(y)[m_words - 1] &= mask; }
+		}
+		return result;
+	}
+
+	BinaryImage& BinaryImage::operator&=(const BinaryImage &right)
+	{
+		checkSize(right, "&=");
+		for(size_t i = 0; i < m_data.size(); i++) {
+			m_data[i] &= right.m_data[i]; }
+		return *this;
+	}
+
+	BinaryImage& BinaryImage::operator|=(const BinaryImage &right)
+	{
+		checkSize(right, "|=");
+		for(size_t i = 0; i < m_data.size(); i++) {
+			m_data[i] |= right.m_data[i]; }
+		return *this;
+	}
+
+	BinaryImage& BinaryImage::operator^=(const BinaryImage &right)
+	{
+		checkSize(right, "^=");
+		for(size_t i = 0; i < m_data.size(); i++) {
+			m_data[i] ^= right.m_data[i]; }
+		return *this;
+	}
+
+	BinaryImage BinaryImage::operator&(const BinaryImage &right) const
+	{
+		checkSize(right, "&");
+		BinaryImage result(*this);
+		return result &= right;
+	}
+
+	BinaryImage BinaryImage::operator|(const BinaryImage &right) const
+	{
+		checkSize(right, "|");
+		BinaryImage result(*this);
+		return result |= right;
+	}
+
+	BinaryImage BinaryImage::operator^(const BinaryImage &right) const
+	{
+		checkSize(right, "^");
+		BinaryImage result(*this);
+		return result ^= right;
+	}
+
+	bool BinaryImage::operator==(const BinaryImage &right) const
+	{
+		return m_width == right.m_width && m_height == right.m_height && m_data == right.m_data;
+	}
+
+	// Morphology
+	BinaryImage BinaryImage::morphology(const std::vector<char> &taps, int tWidth, int tHeight, bool dilation) const
+	{
+		// Dilation starts empty and ORs in each tap, erosion starts full and
+		// ANDs in each tap, with pixels outside the image being neutral
+		BinaryImage result(m_width, m_height, !dilation);
+		if(m_words == 0) {
+			return result; }
+
+		const int negX = (tWidth - 1)/2, negY = (tHeight - 1)/2;
+		const word fill = dilation?word(0):~word(0);
+		const word mask = lastMask();
+
+		parallelFor(0, m_height, [&](int first, int last)
+		{
+			std::vector<word> source(m_words + 1), shifted(m_words + 1);
+			for(int y = first; y < last; y++)
+			{
+				word *out = result.row(y);
+				for(int ty = 0; ty < tHeight; ty++)
+				{
+					int sy = y - negY + ty;
+					if(sy < 0 || sy >= m_height) {
+						continue; }
+
+					// The bits past the width take the fill value while shifting
+					std::copy(row(sy), row(sy) + m_words, source.begin());
+					if(m_words > 0) {
+						source[m_words - 1] |= fill & ~mask; }
+
+					for(int tx = 0; tx < tWidth; tx++)
+					{
+						if(!taps[tx + tWidth*ty]) {
+							continue; }
+
+						binary_shift(&source[0], m_words, tx - negX, fill, &shifted[0]);
+						if(dilation) {
+							for(int k = 0; k < m_words; k++) {
+								out[k] |= shifted[k]; } }
+						else {
+							for(int k = 0; k < m_words; k++) {
+								out[k] &= shifted[k]; } }
+					}
+				}
+				out[m_words - 1] &= mask;
+			}
+		}, 16);
+
+		return result;
+	}
+}	// end namespace
\ No newline at end of file
@@ -4,8 +4,71 @@
 #include "BmpImage.h"
 #include <iomanip>
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 namespace ImageTL
 {
+	// Bitmap fields are little endian on disk
+	static inline DWORD bmp_get32(const BYTE *p) { return DWORD(p[0]) | (DWORD(p[1]) << 8) | (DWORD(p[2]) << 16) | (DWORD(p[3]) << 24); }
+	static inline WORD  bmp_get16(const BYTE *p) { return WORD(p[0] | (p[1] << 8)); }
+	static inline void  bmp_put32(BYTE *p, DWORD n) { p[0] = BYTE(n); p[1] = BYTE(n >> 8); p[2] = BYTE(n >> 16); p[3] = BYTE(n >> 24); }
+	static inline void  bmp_put16(BYTE *p, WORD n)  { p[0] = BYTE(n); p[1] = BYTE(n >> 8); }
+
+	// Returns the byte offset selected by a 32 bit channel mask, or -1 if the
+	// mask does not select exactly one byte
+	static inline int bmp_mask_offset(DWORD mask)
+	{
+		for(int offset = 0; offset < 4; offset++) {
+			if(mask == (DWORD(0xFF) << (8*offset))) {
+				return offset; } }
+		return -1;
+	}
+
+	// Converts a row of pixels with blue, green and red at the given byte
+	// offsets to luma.  The BT.601 weights are used in 8.8 fixed point so the
+	// result matches exactly with and without SSE2.  Four bytes past the end
+	// of the row must be readable.
+	template<class Type> static void bmp_luma_row(const BYTE *src, int bytesPerPixel, const int *offsets, Type *dest, int width)
+	{
+		int x = 0;
+#ifdef __SSE2__
+		if(offsets[0] == 0 && offsets[1] == 1 && offsets[2] == 2)
+		{
+			const __m128i weights = _mm_setr_epi16(29, 150, 77, 0, 29, 150, 77, 0);
+			const __m128i zero    = _mm_setzero_si128();
+			const __m128i half    = _mm_set1_epi32(128);
+			int luma[4];
+			for(; x + 4 <= width; x += 4, src += 4*bytesPerPixel)
+			{
+				// Gather four pixels into the low three bytes of each 32 bit lane
+				__m128i quad = _mm_loadu_si128((const __m128i*)src);
+				if(bytesPerPixel == 3)
+				{
+					__m128i p01 = _mm_unpacklo_epi32(quad, _mm_srli_si128(quad, 3));
+					__m128i p23 = _mm_unpacklo_epi32(_mm_srli_si128(quad, 6), _mm_srli_si128(quad, 9));
+					quad = _mm_unpacklo_epi64(p01, p23);
+				}
+
+				// Each madd gives (29b + 150g, 77r) for two pixels
+				__m128 lo = _mm_castsi128_ps(_mm_madd_epi16(_mm_unpacklo_epi8(quad, zero), weights));
+				__m128 hi = _mm_castsi128_ps(_mm_madd_epi16(_mm_unpackhi_epi8(quad, zero), weights));
+				__m128i sum = _mm_add_epi32(_mm_castps_si128(_mm_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0))),
+											_mm_castps_si128(_mm_shuffle_ps(lo, hi, _MM_SHUFFLE(3, 1, 3, 1))));
+				_mm_storeu_si128((__m128i*)luma, _mm_srli_epi32(_mm_add_epi32(sum, half), 8));
+
+				dest[x]     = Type(luma[0]);
+				dest[x + 1] = Type(luma[1]);
+				dest[x + 2] = Type(luma[2]);
+				dest[x + 3] = Type(luma[3]);
+			}
+		}
+#endif
+		for(; x < width; x++, src += bytesPerPixel) {
+			dest[x] = Type((29*src[offsets[0]] + 150*src[offsets[1]] + 77*src[offsets[2]] + 128) >> 8); }
+	}
+
 	//File io and header info
 	template<class Type> void BmpImage<Type>::printVals()
 	{
@@ -20,6 +83,7 @@ namespace ImageTL
 		std::cout << "m_bih.biHeight = " << m_bih.biHeight << std::endl;
 		std::cout << "m_bih.biPlanes = " << m_bih.biPlanes << std::endl;
 		std::cout << "m_bih.biBitCount = " << m_bih.biBitCount << std::endl;
+		std::cout << "m_bih.biCompression = " << m_bih.biCompression << std::endl;
 		std::cout << "m_bih.biSizeImage = " << m_bih.biSizeImage << std::endl;
 		std::cout << "m_bih.biXPelsPerMeter = " << m_bih.biXPelsPerMeter << std::endl;
 		std::cout << "m_bih.biYPelsPerMeter = " << m_bih.biYPelsPerMeter << std::endl;
@@ -35,7 +99,7 @@ namespace ImageTL
 		m_bih.biPlanes			=	1;
 		m_bih.biBitCount		=	8;
 		m_bih.biCompression		=	0;
-		m_bih.biSizeImage		=	this->m_width * this->m_height;
+		m_bih.biSizeImage		=	((this->m_width + 3) & ~3) * this->m_height;
 		m_bih.biXPelsPerMeter	=	0;
 		m_bih.biYPelsPerMeter	=	0;
 		m_bih.biClrUsed			=	256;
@@ -43,7 +107,7 @@ namespace ImageTL
 
 		m_bfh.bfType			=	0x4D42;
 		m_bfh.bfOffBits			=	(14 + 40 + 1024);//sizeof(m_bfh) + m_bih.biSize + sizeof(g_colorTable);
-		m_bfh.bfSize			=	m_bfh.bfOffBits + m_bih.biSizeImage*(m_bih.biBitCount/8);
+		m_bfh.bfSize			=	m_bfh.bfOffBits + m_bih.biSizeImage;
 		m_bfh.bfReserved1		=	0;
 		m_bfh.bfReserved2		=	0;
 	}
@@ -54,154 +118,332 @@ namespace ImageTL
 		if(!fin) {
 			throw ImageException((std::string("BmpImage::readHeader [Error reading header in ") + file) + "]"); }
 
-		//read bitmap file header
-		//fin.read((char*)&m_bfh, sizeof(m_bfh));
-
-		//read bitmap info header
-		//fin.read((char*)&m_bih, sizeof(m_bih));
-
-		fin.read((char*)&m_bfh.bfType, sizeof(m_bfh.bfType));
-		fin.read((char*)&m_bfh.bfSize, sizeof(m_bfh.bfSize));
-		fin.read((char*)&m_bfh.bfReserved1, sizeof(m_bfh.bfReserved2));
-		fin.read((char*)&m_bfh.bfReserved2, sizeof(m_bfh.bfReserved2));
-		fin.read((char*)&m_bfh.bfOffBits, sizeof(m_bfh.bfOffBits));
-
-		fin.read((char*)&m_bih.biSize, sizeof(m_bih.biSize));
-		fin.read((char*)&m_bih.biWidth, sizeof(m_bih.biWidth));
-		fin.read((char*)&m_bih.biHeight, sizeof(m_bih.biHeight));
-		fin.read((char*)&m_bih.biPlanes, sizeof(m_bih.biPlanes));
-		fin.read((char*)&m_bih.biBitCount, sizeof(m_bih.biBitCount));
-		fin.read((char*)&m_bih.biCompression, sizeof(m_bih.biCompression));
-		fin.read((char*)&m_bih.biSizeImage, sizeof(m_bih.biSizeImage));
-		fin.read((char*)&m_bih.biXPelsPerMeter, sizeof(m_bih.biXPelsPerMeter));
-		fin.read((char*)&m_bih.biYPelsPerMeter, sizeof(m_bih.biYPelsPerMeter));
-		fin.read((char*)&m_bih.biClrUsed, sizeof(m_bih.biClrUsed));
-		fin.read((char*)&m_bih.biClrImportant, sizeof(m_bih.biClrImportant));
-
-		//throw ImageException("BmpImage::readHeader [Only 8 bit bitmaps supported!]");
-
-		if(m_bih.biBitCount != 8) {
-			throw ImageException("BmpImage::readHeader [Only 8 bit bitmaps supported!]"); }
-
-		//set header length, assumed in bytes
-		this->m_headerLength = (14 + 40 + 1024);
-		this->m_depth  = (1 << m_bih.biBitCount) - 1;
-		this->m_height = m_bih.biHeight;
-		this->m_width  = m_bih.biWidth;
+		// Read both headers and the bitfield masks that may follow them
+		BYTE header[14 + 40 + 16];
+		memset(header, 0, sizeof(header));
+		fin.read((char*)header, sizeof(header));
+		if(fin.gcount() < 14 + 40 || bmp_get16(header) != 0x4D42) {
+			throw ImageException("BmpImage::readHeader [Invalid file format]"); }
+
+		m_bfh.bfType			=	bmp_get16(header);
+		m_bfh.bfSize			=	bmp_get32(header + 2);
+		m_bfh.bfReserved1		=	bmp_get16(header + 6);
+		m_bfh.bfReserved2		=	bmp_get16(header + 8);
+		m_bfh.bfOffBits			=	bmp_get32(header + 10);
+
+		const BYTE *info = header + 14;
+		m_bih.biSize			=	bmp_get32(info);
+		m_bih.biWidth			=	(LONG)bmp_get32(info + 4);
+		m_bih.biHeight			=	(LONG)bmp_get32(info + 8);
+		m_bih.biPlanes			=	bmp_get16(info + 12);
+		m_bih.biBitCount		=	bmp_get16(info + 14);
+		m_bih.biCompression		=	bmp_get32(info + 16);
+		m_bih.biSizeImage		=	bmp_get32(info + 20);
+		m_bih.biXPelsPerMeter	=	(LONG)bmp_get32(info + 24);
+		m_bih.biYPelsPerMeter	=	(LONG)bmp_get32(info + 28);
+		m_bih.biClrUsed			=	bmp_get32(info + 32);
+		m_bih.biClrImportant	=	bmp_get32(info + 36);
+
+		if(m_bih.biSize < 40 || m_bih.biWidth <= 0 || m_bih.biHeight == 0 || m_bih.biPlanes != 1) {
+			throw ImageException("BmpImage::readHeader [Invalid file format]"); }
+
+		bool supported = false;
+		if(m_bih.biBitCount == 8) {
+			supported = (m_bih.biCompression == bi_rgb || (m_bih.biCompression == bi_rle8 && m_bih.biHeight > 0)); }
+		else if(m_bih.biBitCount == 24) {
+			supported = (m_bih.biCompression == bi_rgb); }
+		else if(m_bih.biBitCount == 32) {
+			supported = (m_bih.biCompression == bi_rgb || m_bih.biCompression == bi_bitfields); }
+		if(!supported) {
+			throw ImageException("BmpImage::readHeader [Only 8 bit, RLE8, 24 bit and 32 bit bitmaps are supported]"); }
+
+		// Locate the bytes of each channel, BI_RGB is always BGRx
+		m_offsets[0] = 0;
+		m_offsets[1] = 1;
+		m_offsets[2] = 2;
+		m_offsets[3] = -1;
+		if(m_bih.biCompression == bi_bitfields)
+		{
+			const BYTE *masks = header + 14 + 40;
+			m_offsets[2] = bmp_mask_offset(bmp_get32(masks));
+			m_offsets[1] = bmp_mask_offset(bmp_get32(masks + 4));
+			m_offsets[0] = bmp_mask_offset(bmp_get32(masks + 8));
+			if(m_bih.biSize >= 56) {
+				m_offsets[3] = bmp_mask_offset(bmp_get32(masks + 12)); }
+
+			if(m_offsets[0] < 0 || m_offsets[1] < 0 || m_offsets[2] < 0) {
+				throw ImageException("BmpImage::readHeader [Only 8 bit channel masks are supported]"); }
+		}
+
+		// Read the color table, which sits between the headers and the pixels
+		if(m_bih.biBitCount == 8)
+		{
+			int colors = (m_bih.biClrUsed == 0 || m_bih.biClrUsed > 256)?256:(int)m_bih.biClrUsed;
+			memset(m_palette, 0, sizeof(m_palette));
+			fin.clear();
+			fin.seekg(14 + m_bih.biSize + ((m_bih.biCompression == bi_bitfields && m_bih.biSize == 40)?12:0));
+			fin.read((char*)m_palette, 4*colors);
+			if(!fin) {
+				throw ImageException("BmpImage::readHeader [Error reading the color table]"); }
+		}
 
+		this->m_headerLength = m_bfh.bfOffBits;
+		this->m_depth  = 255;
+		this->m_height = (m_bih.biHeight < 0)?-m_bih.biHeight:m_bih.biHeight;
+		this->m_width  = m_bih.biWidth;
 	}
 
-	template<class Type> void BmpImage<Type>::readData(const char *file) throw(ImageException)
+	template<class Type> void BmpImage<Type>::readPixels(const char *file, std::vector<BYTE> &pixels, int &stride) throw(ImageException)
 	{
-		try
+		std::ifstream fin(file, std::ios::in | std::ios::binary);
+		if(!fin) {
+			throw ImageException((std::string("BmpImage::readData [Error reading data in ") + file) + "]"); }
+
+		int height = this->m_height;
+		fin.seekg(0, std::ios::end);
+		std::istream::pos_type fileLength = fin.tellg();
+		fin.seekg(this->m_headerLength);
+
+		// The extra bytes let the row conversion read a whole vector past the last pixel
+		if(m_bih.biCompression == bi_rle8)
 		{
-			std::ifstream fin(file, std::ios::in | std::ios::binary);
-			if(!fin) {
-				throw ImageException((std::string("BmpImage::readData [Error reading data in ") + file) + "]"); }
+			stride = this->m_width;
+			pixels.assign((size_t)stride*height + 16, 0);
+
+			size_t dataLength = (fileLength > this->m_headerLength)?(size_t)(fileLength - this->m_headerLength):0;
+			std::vector<BYTE> data(dataLength + 2, 0);
+			fin.read((char*)&data[0], dataLength);
+			decodeRle8(&data[0], dataLength, &pixels[0], stride);
+			return;
+		}
 
-			// Allocate memory for the image
-			this->m_image = this->allocateImage();
+		// Rows are padded to a multiple of four bytes
+		stride = ((this->m_width*m_bih.biBitCount + 31)/32)*4;
+		size_t dataLength = (size_t)stride*height;
+		pixels.resize(dataLength + 16);
+		fin.read((char*)&pixels[0], dataLength);
+		if((size_t)fin.gcount() != dataLength) {
+			throw ImageException((std::string("BmpImage::readData [File is truncated: ") + file) + "]"); }
+	}
 
-			// Skip the header in the bmp file
-			fin.seekg(this->m_headerLength);
+	template<class Type> void BmpImage<Type>::decodeRle8(const BYTE *data, size_t length, BYTE *pixels, int stride) throw(ImageException)
+	{
+		int x = 0, y = 0, width = this->m_width, height = this->m_height;
+		size_t i = 0;
+		while(i + 1 < length && y < height)
+		{
+			int count = data[i], value = data[i + 1];
+			i += 2;
 
-			// Allocate temporary memory to read the data into
-			bool isUpsideDown = true;
-			if(this->m_height < 0)
+			if(count > 0)
 			{
-				m_bih.biHeight = -m_bih.biHeight;
-				this->m_height = -this->m_height;
-				isUpsideDown   = false;
+				// Encoded run of a single index
+				if(x + count > width) {
+					count = width - x; }
+				memset(pixels + (size_t)y*stride + x, value, count);
+				x += count;
 			}
+			else if(value == 0)
+			{
+				// End of line
+				x = 0;
+				y++;
+			}
+			else if(value == 1) {
+				break; }
+			else if(value == 2)
+			{
+				// Delta to a later pixel
+				if(i + 1 >= length) {
+					break; }
+				x += data[i];
+				y += data[i + 1];
+				i += 2;
+				if(x > width) {
+					x = width; }
+			}
+			else
+			{
+				// Absolute run, padded to an even number of bytes
+				if(i + value > length) {
+					throw ImageException("BmpImage::readData [Invalid RLE8 data]"); }
+				int copy = (x + value > width)?(width - x):value;
+				memcpy(pixels + (size_t)y*stride + x, data + i, copy);
+				x += copy;
+				i += value + (value & 1);
+			}
+		}
+	}
 
-			int paddedWidth = this->m_width;
-			if(this->m_width%4 != 0) {
-				paddedWidth = this->m_width + 4 - this->m_width%4; }
-
-			int dataLength = (paddedWidth*this->m_height);
-			unsigned char* imageData = new unsigned char[dataLength];
+	template<class Type> void BmpImage<Type>::convertPixels(const BYTE *pixels, int stride, bmp_channel c, Image<Type> &dest)
+	{
+		int width = this->m_width, height = this->m_height;
+		if(width == 0 || height == 0) {
+			return; }
 
-			// Read the data
-			fin.read((char*)imageData, dataLength);
+		// Bitmaps are stored bottom up unless the height is negative
+		bool isUpsideDown = (m_bih.biHeight > 0);
+		int bytesPerPixel = m_bih.biBitCount/8;
 
-			// Convert the unsigned chars into the proper data type
-			if(isUpsideDown)
+		// Palette bitmaps and single channels are converted with a table
+		Type table[256];
+		if(bytesPerPixel == 1)
+		{
+			for(int i = 0; i < 256; i++)
 			{
-				typename Image<Type>::iterator i = this->begin();
-				for(int y = this->m_height - 1; y >= 0; y--)
+				const BYTE *color = m_palette + 4*i;
+				switch(c)
 				{
-					for(int x = 0; x < paddedWidth; x++)
-					{
-						if(x >= this->m_width) {
-							break; }
-
-						*(i++) = Type( imageData[y*paddedWidth + x] );
-					}
+				case bmp_luma:  table[i] = Type((29*color[0] + 150*color[1] + 77*color[2] + 128) >> 8); break;
+				case bmp_red:   table[i] = Type(color[2]); break;
+				case bmp_green: table[i] = Type(color[1]); break;
+				case bmp_blue:  table[i] = Type(color[0]); break;
+				default:        table[i] = Type(255); break;
 				}
 			}
-			else
+		}
+		else {
+			for(int i = 0; i < 256; i++) {
+				table[i] = Type(i); } }
+
+		int offset = -1;
+		switch(c)
+		{
+		case bmp_red:   offset = m_offsets[2]; break;
+		case bmp_green: offset = m_offsets[1]; break;
+		case bmp_blue:  offset = m_offsets[0]; break;
+		case bmp_alpha: offset = (bytesPerPixel == 4)?m_offsets[3]:-1; break;
+		default: break;
+		}
+
+		// Take the pointer before the threads start, since any shared data
+		// is copied on mutable access
+		Type *image = dest.data();
+		parallelFor(0, height, [&](int first, int last)
+		{
+			for(int y = first; y < last; y++)
 			{
-				typename Image<Type>::iterator i = this->begin();
-				for(int y = 0; y < this->m_height; y++)
-				{
-					for(int x = 0; x < paddedWidth; x++)
-					{
-						if(x >= this->m_width) {
-							break; }
+				const BYTE *src = pixels + (size_t)stride*(isUpsideDown?(height - 1 - y):y);
+				Type *row = image + (size_t)width*y;
 
-						*(i++) = Type( imageData[y*paddedWidth + x] );
-					}
+				if(bytesPerPixel == 1)
+				{
+					for(int x = 0; x < width; x++) {
+						row[x] = table[src[x]]; }
+				}
+				else if(c == bmp_luma) {
+					bmp_luma_row(src, bytesPerPixel, m_offsets, row, width); }
+				else if(offset < 0)
+				{
+					for(int x = 0; x < width; x++) {
+						row[x] = Type(255); }
+				}
+				else
+				{
+					src += offset;
+					for(int x = 0; x < width; x++, src += bytesPerPixel) {
+						row[x] = table[*src]; }
 				}
 			}
+		}, 64);
+	}
 
-			delete[] imageData;
+	template<class Type> void BmpImage<Type>::readData(const char *file) throw(ImageException)
+	{
+		std::vector<BYTE> pixels;
+		int stride;
+		readPixels(file, pixels, stride);
+
+		try
+		{
+			this->freeImage(this->m_image);
+			this->m_image = this->allocateImage();
 		}
 		catch(std::bad_alloc &e)
 		{
-			std::cout<<"BmpImage::readData [Error allocating memory for a "<<this->m_width<<" x "<<this->m_height<<" image:  "<<e.what()<<"]"<<std::endl;
-			throw ImageException("BmpImage::readData [Aborting...]");
+			this->m_image = NULL;
+			std::stringstream msg_stream;
+			msg_stream<<"BmpImage::readData [Error allocating memory for a "<<this->m_width<<" x "<<this->m_height<<" image:  "<<e.what()<<"]";
+			throw ImageException(msg_stream.str());
 		}
+
+		convertPixels(&pixels[0], stride, m_channel, *this);
 	}
 
-	template<class Type> void BmpImage<Type>::writeHeader(const char *file, const char *comment) throw(ImageException)
+	template<class Type> void BmpImage<Type>::readChannels(const char *file, Image<Type> &red, Image<Type> &green, Image<Type> &blue)
 	{
+		// The header replaces the dimensions of this image, which does not
+		// receive any pixels, so they are put back afterwards
+		const int width = this->m_width, height = this->m_height;
+		try
+		{
+			readHeader(file);
+
+			std::vector<BYTE> pixels;
+			int stride;
+			readPixels(file, pixels, stride);
+
+			red.resize(this->m_width, this->m_height, false);
+			green.resize(this->m_width, this->m_height, false);
+			blue.resize(this->m_width, this->m_height, false);
+
+			convertPixels(&pixels[0], stride, bmp_red,   red);
+			convertPixels(&pixels[0], stride, bmp_green, green);
+			convertPixels(&pixels[0], stride, bmp_blue,  blue);
+		}
+		catch(...)
+		{
+			this->m_width  = width;
+			this->m_height = height;
+			throw;
+		}
+		this->m_width  = width;
+		this->m_height = height;
+	}
 
-		if(m_bih.biBitCount != 8) {
-			throw ImageException("BmpImage::writeHeader [Only 8 bit bitmaps supported!]"); }
+	template<class Type> void BmpImage<Type>::writeHeader(const char *file, const char *comment) throw(ImageException)
+	{
+		// The image may have been read from a colour bitmap or resized since
+		// the header was made, and only 8 bit grayscale is written
+		createDefaultHeader();
 
 		std::ofstream fout(file, std::ios::out | std::ios::binary | std::ios::trunc);
 		if(!fout)
 		{
 			std::stringstream msg_stream;
-			msg_stream<<"BmpImage::writeHeader [Error opening " << file << " for writing]<< endl";
+			msg_stream<<"BmpImage::writeHeader [Error opening "<<file<<" for writing]";
 			throw ImageException(msg_stream.str());
 		}
 
-		//Write bitmap file header
-		fout.write((char*)&m_bfh.bfType,		sizeof(m_bfh.bfType));
-		fout.write((char*)&m_bfh.bfSize,		sizeof(m_bfh.bfSize));
-		fout.write((char*)&m_bfh.bfReserved1,	sizeof(m_bfh.bfReserved2));
-		fout.write((char*)&m_bfh.bfReserved2,	sizeof(m_bfh.bfReserved2));
-		fout.write((char*)&m_bfh.bfOffBits,		sizeof(m_bfh.bfOffBits));
-
-		fout.write((char*)&m_bih.biSize,		sizeof(m_bih.biSize));
-		fout.write((char*)&m_bih.biWidth,		sizeof(m_bih.biWidth));
-		fout.write((char*)&m_bih.biHeight,		sizeof(m_bih.biHeight));
-		fout.write((char*)&m_bih.biPlanes,		sizeof(m_bih.biPlanes));
-		fout.write((char*)&m_bih.biBitCount,	sizeof(m_bih.biBitCount));
-		fout.write((char*)&m_bih.biCompression, sizeof(m_bih.biCompression));
-		fout.write((char*)&m_bih.biSizeImage,	sizeof(m_bih.biSizeImage));
-		fout.write((char*)&m_bih.biXPelsPerMeter, sizeof(m_bih.biXPelsPerMeter));
-		fout.write((char*)&m_bih.biYPelsPerMeter, sizeof(m_bih.biYPelsPerMeter));
-		fout.write((char*)&m_bih.biClrUsed,		sizeof(m_bih.biClrUsed));
-		fout.write((char*)&m_bih.biClrImportant, sizeof(m_bih.biClrImportant));
-		fout.write((char*)g_colorTable,			sizeof(g_colorTable));
+		// Assemble both headers and the color table so they are written at once
+		BYTE header[14 + 40 + sizeof(g_colorTable)];
+		bmp_put16(header,      m_bfh.bfType);
+		bmp_put32(header + 2,  m_bfh.bfSize);
+		bmp_put16(header + 6,  m_bfh.bfReserved1);
+		bmp_put16(header + 8,  m_bfh.bfReserved2);
+		bmp_put32(header + 10, m_bfh.bfOffBits);
+
+		BYTE *info = header + 14;
+		bmp_put32(info,      m_bih.biSize);
+		bmp_put32(info + 4,  (DWORD)m_bih.biWidth);
+		bmp_put32(info + 8,  (DWORD)m_bih.biHeight);
+		bmp_put16(info + 12, m_bih.biPlanes);
+		bmp_put16(info + 14, m_bih.biBitCount);
+		bmp_put32(info + 16, m_bih.biCompression);
+		bmp_put32(info + 20, m_bih.biSizeImage);
+		bmp_put32(info + 24, (DWORD)m_bih.biXPelsPerMeter);
+		bmp_put32(info + 28, (DWORD)m_bih.biYPelsPerMeter);
+		bmp_put32(info + 32, m_bih.biClrUsed);
+		bmp_put32(info + 36, m_bih.biClrImportant);
+		memcpy(header + 14 + 40, g_colorTable, sizeof(g_colorTable));
+
+		fout.write((const char*)header, sizeof(header));
+		if(!fout) {
+			throw ImageException((std::string("BmpImage::writeHeader [Error writing ") + file) + "]"); }
 	}
 
 	template<class Type> void BmpImage<Type>::writeData(const char *file) throw(ImageException)
 	{
-		if(m_bih.biBitCount != 8) throw ImageException("BmpImage::writeData [Only 8 bit bitmaps allowed!]");
-
 		try
 		{
 			std::ofstream fout(file, std::ios::out | std::ios::binary | std::ios::app);
@@ -212,30 +454,28 @@ namespace ImageTL
 				throw ImageException(msg_stream.str());
 			}
 
-			// Allocate temporary memory to read the data into
-			int paddedWidth = this->m_width;
-			if(this->m_width%4 != 0) {
-				paddedWidth = this->m_width + 4 - this->m_width%4; }
-
-			int dataLength = (paddedWidth * this->m_height);
-			unsigned char* imageData = new unsigned char[dataLength];
+			// Rows are padded to a multiple of four bytes and written bottom up
+			int width = this->m_width, height = this->m_height;
+			int paddedWidth = (width + 3) & ~3;
+			std::vector<BYTE> imageData((size_t)paddedWidth*height, 0);
 
-			typename Image<Type>::iterator i = this->begin();
-			for(int y = this->m_height - 1; y >= 0; y--)
+			const Type *image = this->m_image;
+			parallelFor(0, height, [&](int first, int last)
 			{
-				for(int x = 0; x < paddedWidth; x++)
+				for(int y = first; y < last; y++)
 				{
-					if(x >= this->m_width) {
-						imageData[y*paddedWidth + x] = char(0); }
-					else {
-						imageData[y*paddedWidth + x] = char( *(i++) ); }
+					const Type *src = image + (size_t)width*y;
+					BYTE *dest = &imageData[(size_t)paddedWidth*(height - 1 - y)];
+					for(int x = 0; x < width; x++) {
+						dest[x] = BYTE(src[x]); }
 				}
-			}
+			}, 64);
 
 			// write the data
-			fout.write((char*)imageData, dataLength);
-
-			delete[] imageData;
+			if(!imageData.empty()) {
+				fout.write((const char*)&imageData[0], imageData.size()); }
+			if(!fout) {
+				throw ImageException((std::string("BmpImage::writeData [Error writing ") + file) + "]"); }
 		}
 		catch(std::bad_alloc &e)
 		{
@@ -281,7 +521,9 @@ namespace ImageTL
 namespace ImageTL
 {
 	template class BmpImage<char>;
+	template class BmpImage<unsigned char>;
 	template class BmpImage<short>;
+	template class BmpImage<unsigned short>;
 	template class BmpImage<int>;
 	template class BmpImage<long>;
 	template class BmpImage<float>;
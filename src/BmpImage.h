@@ -6,16 +6,35 @@
 #include <fstream>
 #include <iomanip>
 #include <cmath>
+#include <vector>
+#include <stdint.h>
 #include "ImageIO.h"
 
 namespace ImageTL
 {
 
-	typedef	unsigned	int		DWORD;
-	typedef	long		int		LONG;
-	typedef	unsigned	short	WORD;
-	typedef	unsigned	int		UINT;
-	typedef	unsigned	char	BYTE;
+	// The bitmap fields have fixed sizes on disk, regardless of the platform
+	typedef	uint32_t	DWORD;
+	typedef	int32_t		LONG;
+	typedef	uint16_t	WORD;
+	typedef	uint32_t	UINT;
+	typedef	uint8_t		BYTE;
+
+	/** Definitions used to specify which value of each bitmap pixel is read
+		into a BmpImage.  Palette based bitmaps are looked up in their color
+		table first, so every option applies to every supported bitmap.
+		@see BmpImage::channel(), BmpImage::readChannels()
+	*/
+	enum bmp_channel
+	{
+		bmp_luma,	/*!< The pixels are converted to grayscale with the
+					ITU-R BT.601 weights (0.299 R + 0.587 G + 0.114 B).*/
+		bmp_red,	/*!< Only the red value of each pixel is read.*/
+		bmp_green,	/*!< Only the green value of each pixel is read.*/
+		bmp_blue,	/*!< Only the blue value of each pixel is read.*/
+		bmp_alpha	/*!< Only the alpha value of each pixel is read.  Bitmaps
+					without an alpha channel read as 255.*/
+	};
 
 	//color table
 	static const BYTE g_colorTable[1024] = {
@@ -60,19 +79,39 @@ namespace ImageTL
 		254,254,254,0,255,255,255,0
 	};
 
+	/** @class BmpImage
+		Reads and writes Windows bitmaps.
+		Uncompressed 8, 24 and 32 bit bitmaps can be read, as well as RLE8
+		compressed 8 bit bitmaps.  Colour bitmaps are converted to grayscale
+		unless a single channel is selected with channel(), and all three
+		colour channels can be read at once with readChannels().  Bitmaps are
+		always written as uncompressed 8 bit grayscale.
+	*/
 	template<class Type> class BmpImage : public ImageIO<Type>
 	{
 	public:
 		// File io
 		void readHeader(const char *file) throw(ImageException);
 
+		/** Reads the red, green and blue channels of <i>file</i> into three
+			separate images.  The images are resized to match the bitmap and
+			this image is left unchanged apart from its header.
+		*/
+		void readChannels(const char *file, Image<Type> &red, Image<Type> &green, Image<Type> &blue);
+
+		/** Returns a reference to the channel that read() places in the
+			image.  The default is bmp_luma.
+			@see bmp_channel
+		*/
+		bmp_channel& channel() { return m_channel; }
+
 		// Constructors
-		BmpImage() : ImageIO<Type>() { createDefaultHeader(); }
-		BmpImage(const BmpImage &i, bool copy = true) : ImageIO<Type>(i, copy) { createDefaultHeader(); }
-		BmpImage(const ImageIO<Type> &i, bool copy = true) : ImageIO<Type>(i, copy) { createDefaultHeader(); }
-		BmpImage(const char *file, depth_handling dh = upper_scale | lower_translate) : ImageIO<Type>(0, 0, 0, dh) { this->read(file); }
-		BmpImage(int w, int h, int d, depth_handling dh = upper_scale | lower_translate) : ImageIO<Type>(w, h, d, dh) { createDefaultHeader(); }
-		BmpImage(const Image<Type> &i, bool copy = true, int d = 255, depth_handling dh = upper_scale | lower_translate) : ImageIO<Type>(i, copy, d, dh) { createDefaultHeader(); }
+		BmpImage() : ImageIO<Type>(), m_channel(bmp_luma) { createDefaultHeader(); }
+		BmpImage(const BmpImage &i, bool copy = true) : ImageIO<Type>(i, copy), m_channel(i.m_channel) { createDefaultHeader(); }
+		BmpImage(const ImageIO<Type> &i, bool copy = true) : ImageIO<Type>(i, copy), m_channel(bmp_luma) { createDefaultHeader(); }
+		BmpImage(const char *file, depth_handling dh = upper_scale | lower_translate, bmp_channel c = bmp_luma) : ImageIO<Type>(0, 0, 0, dh), m_channel(c) { this->read(file); }
+		BmpImage(int w, int h, int d, depth_handling dh = upper_scale | lower_translate) : ImageIO<Type>(w, h, d, dh), m_channel(bmp_luma) { createDefaultHeader(); }
+		BmpImage(const Image<Type> &i, bool copy = true, int d = 255, depth_handling dh = upper_scale | lower_translate) : ImageIO<Type>(i, copy, d, dh), m_channel(bmp_luma) { createDefaultHeader(); }
 
 		// Operators (= operator is not inherited)
 		BmpImage& operator=(const Image<Type>&);
@@ -87,6 +126,22 @@ namespace ImageTL
 		void writeData(const char *file) throw(ImageException);
 		void createDefaultHeader() throw(ImageException);
 
+		// Pixel decoding
+		void readPixels(const char *file, std::vector<BYTE> &pixels, int &stride) throw(ImageException);
+		void decodeRle8(const BYTE *data, size_t length, BYTE *pixels, int stride) throw(ImageException);
+		void convertPixels(const BYTE *pixels, int stride, bmp_channel c, Image<Type> &dest);
+
+		enum
+		{
+			bi_rgb       = 0,	///< Uncompressed pixels.
+			bi_rle8      = 1,	///< Run length encoded 8 bit pixels.
+			bi_bitfields = 3	///< Uncompressed pixels with channel masks.
+		};
+
+		bmp_channel m_channel;		///< The channel read() places in the image.
+		BYTE        m_palette[1024];///< The color table of the last 8 bit bitmap read.
+		int         m_offsets[4];	///< The byte offsets of blue, green, red and alpha in a 32 bit pixel (-1 for none).
+
 		//image structures
 		struct BITMAP_INFO_HEADER{
 
@@ -102,10 +157,10 @@ namespace ImageTL
 			//Specifies the number of planes for the target device. Must be set to 1.
 			WORD biPlanes;
 
-			//Specifies number of bits per pixel. Must be 1, 4, 8, or 24.
+			//Specifies number of bits per pixel. Must be 1, 4, 8, 16, 24 or 32.
 			WORD biBitCount;
 
-			//Specifies the type of compression for a compressed bitmap. Must be (0 for NONE, 1 for RLE8, or 2 for RLE)
+			//Specifies the type of compression for a compressed bitmap. (0 for NONE, 1 for RLE8, 2 for RLE4 or 3 for BITFIELDS)
 			DWORD biCompression;
 
 			//Specifies image size in bytes. Valid to set to 0 if bitmap is the BI_RGB format.
@@ -17,7 +17,9 @@ namespace ImageTL
 		int yMin = this->m_imageY - this->m_templateNegOffsetY;
 		int yMax = this->m_imageY + this->m_templatePosOffsetY;
 
-		Type sum = Type(0);
+		// Sum in the wide type so that 8 and 16 bit images don't overflow
+		typedef typename wide_traits<Type>::type wide;
+		wide sum = wide(0);
 		Type imageData, templateData;
 		for(int yLoop = yMin; yLoop <= yMax; yLoop++)
 		{
@@ -29,11 +31,11 @@ namespace ImageTL
 					continue; }
 
 				templateData = this->m_tLink->operator()(xLoop, yLoop);
-				sum += imageData * templateData;
+				sum += wide(imageData) * wide(templateData);
 			}
 		}
 
-		return sum;
+		return saturate_cast<Type>(sum);
 	}
 
 	template<class Type> Type MulMaxIterator<Type>::operator*()
@@ -116,21 +118,27 @@ namespace ImageTL
 namespace ImageTL
 {
 	template class MulSumIterator<char>;
+	template class MulSumIterator<unsigned char>;
 	template class MulSumIterator<short>;
+	template class MulSumIterator<unsigned short>;
 	template class MulSumIterator<int>;
 	template class MulSumIterator<long>;
 	template class MulSumIterator<float>;
 	template class MulSumIterator<double>;
 
 	template class MulMaxIterator<char>;
+	template class MulMaxIterator<unsigned char>;
 	template class MulMaxIterator<short>;
+	template class MulMaxIterator<unsigned short>;
 	template class MulMaxIterator<int>;
 	template class MulMaxIterator<long>;
 	template class MulMaxIterator<float>;
 	template class MulMaxIterator<double>;
 
 	template class MulMinIterator<char>;
+	template class MulMinIterator<unsigned char>;
 	template class MulMinIterator<short>;
+	template class MulMinIterator<unsigned short>;
 	template class MulMinIterator<int>;
 	template class MulMinIterator<long>;
 	template class MulMinIterator<float>;
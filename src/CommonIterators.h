@@ -17,6 +17,7 @@ namespace ImageTL
 #include "Image.h"
 #include "ImageException.h"
 #include "Template.h"
+#include "Saturate.h"
 #include "ConvolutionIterator.h"
 
 namespace ImageTL
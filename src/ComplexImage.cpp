@@ -72,8 +72,8 @@ namespace ImageTL
 
 	ComplexImage::ComplexImage(const Image<double> &i) : Image<complex<double> >(i.width(), i.height(), i.edgeHandling())
 	{
-		Image<double>::iterator iter = i.begin();
-		Image<double>::iterator e = i.end();
+		Image<double>::const_iterator iter = i.begin();
+		Image<double>::const_iterator e = i.end();
 		iterator iter_comp = begin();
 		for(; iter != e; ++iter, ++iter_comp)
 		{
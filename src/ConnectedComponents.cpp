@@ -0,0 +1,103 @@
+/** @file ConnectedComponents.cpp
+	Contains function definitions that are declared in ConnectedComponents.h
+*/
+
+#include "ConnectedComponents.h"
+
+namespace ImageTL
+{
+	// Returns the root of run i, pointing every run on the way straight at it
+	static int component_find(std::vector<int> &parent, int i)
+	{
+		int root = i;
+		while(parent[root] != root) {
+			root = parent[root]; }
+		while(parent[i] != root)
+		{
+			int next = parent[i];
+			parent[i] = root;
+			i = next;
+		}
+		return root;
+	}
+
+	// Joins the trees of runs a and b under the earlier of their roots, so the
+	// root of every component is its first run in raster order
+	static void component_union(std::vector<int> &parent, int a, int b)
+	{
+		a = component_find(parent, a);
+		b = component_find(parent, b);
+		if(a < b) {
+			parent[b] = a; }
+		else if(b < a) {
+			parent[a] = b; }
+	}
+
+	// Joins the runs of row y with the runs of row y - 1 that they touch.
+	// With diagonal connections runs touch if they overlap after widening one
+	// of them by a pixel each side.
+	static void component_join_rows(const ImageRoi &region, std::vector<int> &parent, int y, int reach)
+	{
+		const roi_run *first = region.runs().data();
+		const roi_run *above = region.rowBegin(y - 1), *aboveEnd = region.rowEnd(y - 1);
+		for(const roi_run *r = region.rowBegin(y), *e = region.rowEnd(y); r != e && above != aboveEnd; ++r)
+		{
+			// Skip runs above that end before this one starts
+			while(above != aboveEnd && above->x1 + reach <= r->x0) {
+				++above; }
+			for(const roi_run *a = above; a != aboveEnd && a->x0 < r->x1 + reach; ++a) {
+				component_union(parent, (int)(r - first), (int)(a - first)); }
+		}
+	}
+
+	int labelRuns(const ImageRoi &region, std::vector<int> &runLabels, connectivity conn)
+	{
+		const std::vector<roi_run> &runs = region.runs();
+		const int count = (int)runs.size(), height = region.height();
+		const int reach = (conn == connect_moore)?1:0;
+		std::vector<int> parent(count);
+		for(int i = 0; i < count; i++) {
+			parent[i] = i; }
+
+		// Each strip only joins runs within its own rows, so the trees that
+		// the threads change never meet
+		const int strips = std::max(1, std::min(threadCount(), height/16));
+		parallelFor(0, strips, [&](int first, int last)
+		{
+			for(int s = first; s < last; s++)
+			{
+				const int y0 = (int)((long long)height*s/strips), y1 = (int)((long long)height*(s + 1)/strips);
+				for(int y = y0 + 1; y < y1; y++) {
+					component_join_rows(region, parent, y, reach); }
+			}
+		});
+
+		// Then stitch the strips together along their boundaries
+		for(int s = 1; s < strips; s++) {
+			component_join_rows(region, parent, (int)((long long)height*s/strips), reach); }
+
+		// Roots come before the rest of their component, so labels can be
+		// handed out in one pass
+		int labels = 0;
+		runLabels.resize(count);
+		for(int i = 0; i < count; i++)
+		{
+			int root = component_find(parent, i);
+			runLabels[i] = (root == i)?++labels:runLabels[root];
+		}
+		return labels;
+	}
+
+	int labelComponents(const ImageRoi &region, Image<int> &labels, std::vector<component_stats> *stats, connectivity conn)
+	{
+		std::vector<int> runLabels;
+		int count = labelRuns(region, runLabels, conn);
+		component_gather(region, runLabels, count, labels, stats, (const char*)NULL);
+		return count;
+	}
+
+	int labelComponents(const BinaryImage &mask, Image<int> &labels, std::vector<component_stats> *stats, connectivity conn)
+	{
+		return labelComponents(ImageRoi(mask), labels, stats, conn);
+	}
+}	// end namespace
\ No newline at end of file
@@ -0,0 +1,164 @@
+#ifndef __CONNECTEDCOMPONENTS_H__
+#define __CONNECTEDCOMPONENTS_H__
+/** @file ConnectedComponents.h
+	Contains labelComponents(), which labels the connected regions of a mask
+	and measures them.
+*/
+
+#include <vector>
+#include <algorithm>
+#include "ImageRoi.h"
+
+namespace ImageTL
+{
+	/** The pixels that are neighbours when labelling components. */
+	enum connectivity
+	{
+		connect_von_neumann,	///< The 4 pixels that share an edge, as the von_neumann template.
+		connect_moore			///< The 8 pixels that share an edge or a corner, as the moore template.
+	};
+
+	/** @class component_stats
+		The measurements of one connected component.
+	*/
+	struct component_stats
+	{
+		size_t area;	///< The number of pixels.
+		int x0;			///< The first column of the bounding box.
+		int y0;			///< The first row of the bounding box.
+		int x1;			///< One past the last column of the bounding box.
+		int y1;			///< One past the last row of the bounding box.
+		double cx;		///< The mean column of the pixels.
+		double cy;		///< The mean row of the pixels.
+		double sum;		///< The sum of the value image over the pixels, or 0 without one.
+	};
+
+	/** Labels the runs of a region by the connected component they are in.
+		Runs are joined with a union-find over the runs, with path
+		compression.  The rows are split into one strip per thread, each
+		strip joins the runs of its own rows in parallel, and then the runs
+		either side of each strip boundary are joined.
+		@param region The region to label.
+		@param runLabels Set to the label of each run of region.runs(),
+			numbered from 1 in the order the components first appear in a
+			raster scan.
+		@param conn Whether diagonal pixels are connected.
+		@return The number of components.
+	*/
+	int labelRuns(const ImageRoi &region, std::vector<int> &runLabels, connectivity conn = connect_moore);
+
+	// Writes the label image and gathers the statistics of labelled runs,
+	// summing values over each run if it isn't NULL
+	template<class Type> void component_gather(const ImageRoi &region, const std::vector<int> &runLabels, int count,
+											   Image<int> &labels, std::vector<component_stats> *stats, const Type *values)
+	{
+		const int width = region.width(), height = region.height();
+		if(labels.width() != width || labels.height() != height) {
+			labels.resize(width, height, false); }
+
+		int *out = labels.data();
+		const roi_run *first = region.runs().data();
+		parallelFor(0, height, [&](int begin, int end)
+		{
+			for(int y = begin; y < end; y++)
+			{
+				int *row = out + (size_t)width*y, x = 0;
+				for(const roi_run *r = region.rowBegin(y), *e = region.rowEnd(y); r != e; ++r)
+				{
+					std::fill(row + x, row + r->x0, 0);
+					std::fill(row + r->x0, row + r->x1, runLabels[r - first]);
+					x = r->x1;
+				}
+				std::fill(row + x, row + width, 0);
+			}
+		}, 64);
+
+		if(!stats) {
+			return; }
+
+		// The area and centroid of a run have closed forms, so only the value
+		// image is read pixel by pixel
+		const component_stats empty = {0, width, height, 0, 0, 0., 0., 0.};
+		stats->assign(count, empty);
+		const std::vector<roi_run> &runs = region.runs();
+		for(size_t i = 0; i < runs.size(); i++)
+		{
+			const roi_run &r = runs[i];
+			component_stats &s = (*stats)[runLabels[i] - 1];
+			const int length = r.x1 - r.x0;
+			s.area += length;
+			s.x0 = std::min(s.x0, r.x0);
+			s.x1 = std::max(s.x1, r.x1);
+			s.y0 = std::min(s.y0, r.y);
+			s.y1 = std::max(s.y1, r.y + 1);
+			s.cx += 0.5*length*(r.x0 + r.x1 - 1);
+			s.cy += (double)length*r.y;
+			if(values)
+			{
+				const Type *v = values + (size_t)width*r.y;
+				double sum = 0.;
+				for(int x = r.x0; x < r.x1; x++) {
+					sum += double(v[x]); }
+				s.sum += sum;
+			}
+		}
+		for(int k = 0; k < count; k++)
+		{
+			(*stats)[k].cx /= (double)(*stats)[k].area;
+			(*stats)[k].cy /= (double)(*stats)[k].area;
+		}
+	}
+
+	/** Labels the connected components of a region.
+		Each pixel of <i>labels</i> is set to the number of its component,
+		from 1 in raster order of the first pixel of each component, or 0 if
+		it isn't in the region.
+		@param region The pixels to label.
+		@param labels Resized to the region and set to the labels.
+		@param stats If this isn't NULL, element <i>k</i> is set to the
+			measurements of component <i>k+1</i>.
+		@param conn Whether diagonal pixels are connected.
+		@return The number of components.
+		@code
+		BinaryImage bright = BinaryImage::compare(input, compare_greater, threshold);
+		Image<int> labels;
+		std::vector<component_stats> stats;
+		int count = labelComponents(bright, input, labels, stats);
+		@endcode
+	*/
+	int labelComponents(const ImageRoi &region, Image<int> &labels, std::vector<component_stats> *stats = NULL, connectivity conn = connect_moore);
+
+	/** Labels the connected components of the pixels selected in a mask.
+		@copydetails labelComponents(const ImageRoi&, Image<int>&, std::vector<component_stats>*, connectivity)
+	*/
+	int labelComponents(const BinaryImage &mask, Image<int> &labels, std::vector<component_stats> *stats = NULL, connectivity conn = connect_moore);
+
+	/** Labels the connected components of the pixels of <i>mask</i> that are
+		not zero.
+		@copydetails labelComponents(const ImageRoi&, Image<int>&, std::vector<component_stats>*, connectivity)
+	*/
+	template<class Type> int labelComponents(const Image<Type> &mask, Image<int> &labels, std::vector<component_stats> *stats = NULL, connectivity conn = connect_moore)
+	{
+		return labelComponents(ImageRoi(mask), labels, stats, conn);
+	}
+
+	/** Labels the connected components of the pixels selected in a mask, and
+		sums <i>values</i> over each of them into component_stats::sum.
+		@throw ImageException If <i>values</i> is not the size of the mask.
+		@copydetails labelComponents(const ImageRoi&, Image<int>&, std::vector<component_stats>*, connectivity)
+	*/
+	template<class Type> int labelComponents(const BinaryImage &mask, const Image<Type> &values, Image<int> &labels,
+											 std::vector<component_stats> &stats, connectivity conn = connect_moore)
+	{
+		if(values.width() != mask.width() || values.height() != mask.height()) {
+			throw ImageException("labelComponents [The value image is not the size of the mask]"); }
+
+		ImageRoi region(mask);
+		std::vector<int> runLabels;
+		int count = labelRuns(region, runLabels, conn);
+		component_gather(region, runLabels, count, labels, &stats, values.data());
+		return count;
+	}
+}	// end namespace
+
+#endif
\ No newline at end of file
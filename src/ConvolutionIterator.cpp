@@ -201,63 +201,81 @@ namespace ImageTL
 namespace ImageTL
 {
 	template class ConvolutionIterator<char>;
+	template class ConvolutionIterator<unsigned char>;
 	template class ConvolutionIterator<short>;
+	template class ConvolutionIterator<unsigned short>;
 	template class ConvolutionIterator<int>;
 	template class ConvolutionIterator<long>;
 	template class ConvolutionIterator<float>;
 	template class ConvolutionIterator<double>;
 
 	template char mf_mul(char&, char&);
+	template unsigned char mf_mul(unsigned char&, unsigned char&);
 	template short mf_mul(short&, short&);
+	template unsigned short mf_mul(unsigned short&, unsigned short&);
 	template int mf_mul(int&, int&);
 	template long mf_mul(long&, long&);
 	template float mf_mul(float&, float&);
 	template double mf_mul(double&, double&);
 
 	template char mf_add(char&, char&);
+	template unsigned char mf_add(unsigned char&, unsigned char&);
 	template short mf_add(short&, short&);
+	template unsigned short mf_add(unsigned short&, unsigned short&);
 	template int mf_add(int&, int&);
 	template long mf_add(long&, long&);
 	template float mf_add(float&, float&);
 	template double mf_add(double&, double&);
 
 	template char mf_sub(char&, char&);
+	template unsigned char mf_sub(unsigned char&, unsigned char&);
 	template short mf_sub(short&, short&);
+	template unsigned short mf_sub(unsigned short&, unsigned short&);
 	template int mf_sub(int&, int&);
 	template long mf_sub(long&, long&);
 	template float mf_sub(float&, float&);
 	template double mf_sub(double&, double&);
 
 	template char uf_sum(typename ConvolutionIterator<char>::data_container&);
+	template unsigned char uf_sum(typename ConvolutionIterator<unsigned char>::data_container&);
 	template short uf_sum(typename ConvolutionIterator<short>::data_container&);
+	template unsigned short uf_sum(typename ConvolutionIterator<unsigned short>::data_container&);
 	template int uf_sum(typename ConvolutionIterator<int>::data_container&);
 	template long uf_sum(typename ConvolutionIterator<long>::data_container&);
 	template float uf_sum(typename ConvolutionIterator<float>::data_container&);
 	template double uf_sum(typename ConvolutionIterator<double>::data_container&);
 
 	template char uf_max(typename ConvolutionIterator<char>::data_container&);
+	template unsigned char uf_max(typename ConvolutionIterator<unsigned char>::data_container&);
 	template short uf_max(typename ConvolutionIterator<short>::data_container&);
+	template unsigned short uf_max(typename ConvolutionIterator<unsigned short>::data_container&);
 	template int uf_max(typename ConvolutionIterator<int>::data_container&);
 	template long uf_max(typename ConvolutionIterator<long>::data_container&);
 	template float uf_max(typename ConvolutionIterator<float>::data_container&);
 	template double uf_max(typename ConvolutionIterator<double>::data_container&);
 
 	template char uf_min(typename ConvolutionIterator<char>::data_container&);
+	template unsigned char uf_min(typename ConvolutionIterator<unsigned char>::data_container&);
 	template short uf_min(typename ConvolutionIterator<short>::data_container&);
+	template unsigned short uf_min(typename ConvolutionIterator<unsigned short>::data_container&);
 	template int uf_min(typename ConvolutionIterator<int>::data_container&);
 	template long uf_min(typename ConvolutionIterator<long>::data_container&);
 	template float uf_min(typename ConvolutionIterator<float>::data_container&);
 	template double uf_min(typename ConvolutionIterator<double>::data_container&);
 
 	template char uf_mean(typename ConvolutionIterator<char>::data_container&);
+	template unsigned char uf_mean(typename ConvolutionIterator<unsigned char>::data_container&);
 	template short uf_mean(typename ConvolutionIterator<short>::data_container&);
+	template unsigned short uf_mean(typename ConvolutionIterator<unsigned short>::data_container&);
 	template int uf_mean(typename ConvolutionIterator<int>::data_container&);
 	template long uf_mean(typename ConvolutionIterator<long>::data_container&);
 	template float uf_mean(typename ConvolutionIterator<float>::data_container&);
 	template double uf_mean(typename ConvolutionIterator<double>::data_container&);
 
 	template char uf_median(typename ConvolutionIterator<char>::data_container&);
+	template unsigned char uf_median(typename ConvolutionIterator<unsigned char>::data_container&);
 	template short uf_median(typename ConvolutionIterator<short>::data_container&);
+	template unsigned short uf_median(typename ConvolutionIterator<unsigned short>::data_container&);
 	template int uf_median(typename ConvolutionIterator<int>::data_container&);
 	template long uf_median(typename ConvolutionIterator<long>::data_container&);
 	template float uf_median(typename ConvolutionIterator<float>::data_container&);
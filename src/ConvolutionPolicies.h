@@ -0,0 +1,351 @@
+#ifndef __CONVOLUTIONPOLICIES_H__
+#define __CONVOLUTIONPOLICIES_H__
+/** @file ConvolutionPolicies.h
+	Contains the compile-time merge and unity policies used by
+	Image::genericConvolution() and the convolution engine that streams over
+	the taps of a Template.
+	A policy provides the same two steps as the merge_function and
+	unity_function of a ConvolutionIterator, but since its type is a template
+	parameter, both are inlined into the loop over the neighbourhood and no
+	list of merged values is ever built.  A policy must provide:
+	- <tt>wide merge(const Type &image, const Type &tem) const</tt>
+	- <tt>typedef ... accumulator</tt>
+	- <tt>accumulator init() const</tt>
+	- <tt>void reduce(accumulator &acc, const wide &merged) const</tt>
+	- <tt>Type result(const accumulator &acc, int taps) const</tt>, where
+	  <i>taps</i> is the number of values that were reduced.
+
+	The merged values and the accumulators are of the wide type of the
+	pixels (see wide_traits), and the result is converted back with
+	saturate_cast(), so a linear product of an 8 or 16 bit image neither
+	wraps between taps nor when it is stored.
+*/
+
+#include <limits>
+#include <vector>
+#include <algorithm>
+#include "ImageThreads.h"
+#include "Saturate.h"
+#include "Template.h"
+
+namespace ImageTL
+{
+	template<class Type> class Image;
+
+	// ***** Merge policies *****
+	template<class Type> struct merge_mul		///< Merges with the product of the pixel and the template.
+	{
+		typedef typename wide_traits<Type>::type wide;
+		wide merge(const Type &image, const Type &tem) const { return wide(image)*wide(tem); }
+	};
+	template<class Type> struct merge_add		///< Merges with the sum of the pixel and the template.
+	{
+		typedef typename wide_traits<Type>::type wide;
+		wide merge(const Type &image, const Type &tem) const { return wide(image) + wide(tem); }
+	};
+	template<class Type> struct merge_sub		///< Merges with the pixel minus the template.
+	{
+		typedef typename wide_traits<Type>::type wide;
+		wide merge(const Type &image, const Type &tem) const { return wide(image) - wide(tem); }
+	};
+
+	// ***** Unity policies *****
+	template<class Type> struct unity_sum		///< Unifies with the sum of the merged values.
+	{
+		typedef typename wide_traits<Type>::type accumulator;
+		accumulator init() const { return accumulator(0); }
+		void reduce(accumulator &acc, const accumulator &value) const { acc += value; }
+		Type result(const accumulator &acc, int) const { return saturate_cast<Type>(acc); }
+	};
+
+	template<class Type> struct unity_max		///< Unifies with the maximum of the merged values.
+	{
+		typedef typename wide_traits<Type>::type accumulator;
+		accumulator init() const { return accumulator(std::numeric_limits<Type>::lowest()); }
+		void reduce(accumulator &acc, const accumulator &value) const { acc = (value > acc)?value:acc; }
+		Type result(const accumulator &acc, int) const { return saturate_cast<Type>(acc); }
+	};
+
+	template<class Type> struct unity_min		///< Unifies with the minimum of the merged values.
+	{
+		typedef typename wide_traits<Type>::type accumulator;
+		accumulator init() const { return accumulator(std::numeric_limits<Type>::max()); }
+		void reduce(accumulator &acc, const accumulator &value) const { acc = (value < acc)?value:acc; }
+		Type result(const accumulator &acc, int) const { return saturate_cast<Type>(acc); }
+	};
+
+	template<class Type> struct unity_mean		///< Unifies with the mean of the merged values.
+	{
+		typedef typename wide_traits<Type>::type accumulator;
+		accumulator init() const { return accumulator(0); }
+		void reduce(accumulator &acc, const accumulator &value) const { acc += value; }
+		Type result(const accumulator &acc, int taps) const { return (taps > 0)?saturate_cast<Type>(acc/accumulator(taps)):Type(0); }
+	};
+
+	/** @class ConvolutionPolicy
+		Combines a merge policy and a unity policy into a convolution policy.
+	*/
+	template<class Type, class Merge, class Unity> struct ConvolutionPolicy : public Merge, public Unity
+	{
+		typedef Type value_type;
+	};
+
+	template<class Type> struct MulSumPolicy  : public ConvolutionPolicy<Type, merge_mul<Type>, unity_sum<Type> >  {};	///< Right linear convolution product.
+	template<class Type> struct MulMaxPolicy  : public ConvolutionPolicy<Type, merge_mul<Type>, unity_max<Type> >  {};	///< Right multiplicative maximum convolution product.
+	template<class Type> struct MulMinPolicy  : public ConvolutionPolicy<Type, merge_mul<Type>, unity_min<Type> >  {};	///< Right multiplicative minimum convolution product.
+	template<class Type> struct MulMeanPolicy : public ConvolutionPolicy<Type, merge_mul<Type>, unity_mean<Type> > {};	///< Mean of the products.
+	template<class Type> struct AddSumPolicy  : public ConvolutionPolicy<Type, merge_add<Type>, unity_sum<Type> >  {};	///< Sum of the sums.
+	template<class Type> struct AddMaxPolicy  : public ConvolutionPolicy<Type, merge_add<Type>, unity_max<Type> >  {};	///< Right additive maximum convolution product (grayscale dilation).
+	template<class Type> struct AddMinPolicy  : public ConvolutionPolicy<Type, merge_add<Type>, unity_min<Type> >  {};	///< Right additive minimum convolution product.
+	template<class Type> struct SubMinPolicy  : public ConvolutionPolicy<Type, merge_sub<Type>, unity_min<Type> >  {};	///< Minimum of the differences (grayscale erosion).
+
+	/** @class convolution_tiling
+		The size of the tiles that convolve() splits the output into.
+		A width or height of zero is chosen so that a tile and the neighbourhood
+		of input it reads fit in half of cacheSize().
+	*/
+	struct convolution_tiling
+	{
+		int width;		///< The width of a tile, or zero to choose it.
+		int height;		///< The height of a tile, or zero to choose it.
+
+		convolution_tiling(int w = 0, int h = 0) : width(w), height(h) {}
+	};
+
+	/** Finds the tile size used by convolve() for an image of
+		<i>width</i> x <i>height</i> pixels of <i>pixelSize</i> bytes and a
+		template of <i>tWidth</i> x <i>tHeight</i>.
+	*/
+	inline void convolution_tile_size(const convolution_tiling &tiling, int width, int height, int tWidth, int tHeight,
+									  size_t pixelSize, int &tileWidth, int &tileHeight)
+	{
+		long budget = cacheSize()/2;
+
+		tileHeight = tiling.height;
+		if(tileHeight <= 0) {
+			tileHeight = (tHeight > 32)?tHeight:32; }
+		if(tileHeight > height) {
+			tileHeight = height; }
+
+		// The input rows of a tile, plus the accumulators of one row
+		tileWidth = tiling.width;
+		if(tileWidth <= 0)
+		{
+			long rows = tileHeight + tHeight - 1 + 1;
+			tileWidth = (int)(budget/(rows*(long)pixelSize)) - (tWidth - 1);
+			tileWidth -= tileWidth%16;
+			if(tileWidth < 16) {
+				tileWidth = 16; }
+		}
+		if(tileWidth > width) {
+			tileWidth = width; }
+		if(tileWidth < 1) {
+			tileWidth = 1; }
+		if(tileHeight < 1) {
+			tileHeight = 1; }
+	}
+
+	/** Convolves <i>src</i> with <i>tem</i> using <i>policy</i> and stores
+		the result in <i>dest</i>, which must have the same dimensions as
+		<i>src</i>.
+		For templates with constant coefficients (see
+		Template::coefficients()), the output is split into 2D tiles that are
+		computed in parallel.  Each tile is sized with <i>tiling</i> so that
+		the tile and its halo of input stay in cache while the tile is
+		computed.  Within a tile, every row is split into an interior span
+		whose neighbourhoods lie inside the image and a border.  The interior
+		is computed with one pass over the span for each tap, which has no
+		bounds checks and lets the compiler vectorize across the pixels.
+		Templates that are a single column are computed in strips of columns,
+		split into bands of rows if there are fewer strips than threads, that
+		walk down the image with a rolling buffer of the rows under the
+		template.
+		Border pixels follow the edge_handling of <i>src</i>, where taps
+		outside the image are left out of the reduction for edge_skip.
+		Templates that depend on their center are evaluated one pixel at a
+		time through Template::operator().
+	*/
+	template<class Type, class Policy> void convolve(const Image<Type> &src, Template<Type> &tem, const Policy &policy, Image<Type> &dest,
+													 const convolution_tiling &tiling = convolution_tiling())
+	{
+		typedef typename Policy::accumulator accumulator;
+
+		const int width  = src.width(),  height  = src.height();
+		const int tWidth = tem.width(),  tHeight = tem.height();
+		const int negX = (tWidth - 1)/2,  posX = tWidth/2;
+		const int negY = (tHeight - 1)/2, posY = tHeight/2;
+		if(width == 0 || height == 0) {
+			return; }
+
+		const Type *coeff = tem.coefficients();
+		const Type *in  = src.data();
+		Type       *out = dest.data();
+
+		// Computes one pixel with bounds checked taps
+		auto border = [&](int x, int y, const Type *c) -> Type
+		{
+			accumulator acc = policy.init();
+			int taps = 0;
+			Type value;
+			for(int ty = 0; ty < tHeight; ty++)
+			{
+				for(int tx = 0; tx < tWidth; tx++)
+				{
+					if(!src.tryGetPixel(x - negX + tx, y - negY + ty, value)) {
+						continue; }
+					policy.reduce(acc, policy.merge(value, c?c[tx + tWidth*ty]:tem(x - negX + tx, y - negY + ty)));
+					taps++;
+				}
+			}
+			return policy.result(acc, taps);
+		};
+
+		if(coeff == NULL)
+		{
+			// The template has to be centered on each pixel, so this is serial
+			for(int y = 0; y < height; y++)
+			{
+				for(int x = 0; x < width; x++)
+				{
+					tem.setCenter(x, y);
+					out[(size_t)width*y + x] = border(x, y, NULL);
+				}
+			}
+			return;
+		}
+
+		const int x0 = (negX < width)?negX:width;
+		const int x1 = (width - posX > x0)?(width - posX):x0;
+		const int y0 = (negY < height)?negY:height;
+		const int y1 = (height - posY > y0)?(height - posY):y0;
+		const int taps = tWidth*tHeight;
+
+		int tileWidth, tileHeight;
+		convolution_tile_size(tiling, width, height, tWidth, tHeight, sizeof(Type), tileWidth, tileHeight);
+
+		if(tWidth == 1 && tHeight > 1)
+		{
+			// A vertical pass walks down strips of columns.  The rows under
+			// the template are copied into a ring of contiguous rows, which
+			// keeps them in cache even when the rows of a wide image map to
+			// the same cache sets.  Strips are also split into bands of rows
+			// when there are fewer strips than threads, since an image
+			// narrower than one tile is a single strip.
+			const int strips = (width + tileWidth - 1)/tileWidth;
+			const int interior = y1 - y0;
+			int bands = (threadCount() + strips - 1)/strips;
+			const int most = interior/((tHeight > 32)?tHeight:32);
+			if(bands > most) {
+				bands = most; }
+			if(bands < 1) {
+				bands = 1; }
+
+			parallelFor(0, strips*bands, [&](int first, int last)
+			{
+				std::vector<Type> ring((size_t)tHeight*tileWidth);
+				std::vector<accumulator> acc(tileWidth);
+				for(int unit = first; unit < last; unit++)
+				{
+					const int strip = unit/bands, band = unit%bands;
+					const int xs = strip*tileWidth;
+					const int n  = (xs + tileWidth < width)?tileWidth:(width - xs);
+					const int yb0 = y0 + (int)((long long)interior*band/bands);
+					const int yb1 = y0 + (int)((long long)interior*(band + 1)/bands);
+
+					// The first band also does the rows above the interior and
+					// the last band the rows below it
+					if(band == 0) {
+						for(int y = 0; y < y0; y++) {
+							for(int x = xs; x < xs + n; x++) {
+								out[(size_t)width*y + x] = border(x, y, coeff); } } }
+					if(band == bands - 1) {
+						for(int y = y1; y < height; y++) {
+							for(int x = xs; x < xs + n; x++) {
+								out[(size_t)width*y + x] = border(x, y, coeff); } } }
+					if(yb1 == yb0) {
+						continue; }
+
+					for(int r = yb0 - negY; r < yb0 + posY; r++) {
+						std::copy(in + (size_t)width*r + xs, in + (size_t)width*r + xs + n, &ring[(size_t)tileWidth*(r%tHeight)]); }
+
+					accumulator *a = &acc[0];
+					for(int y = yb0; y < yb1; y++)
+					{
+						const int newest = y + posY;
+						std::copy(in + (size_t)width*newest + xs, in + (size_t)width*newest + xs + n,
+								  &ring[(size_t)tileWidth*(newest%tHeight)]);
+
+						for(int i = 0; i < n; i++) {
+							a[i] = policy.init(); }
+						for(int ty = 0; ty < tHeight; ty++)
+						{
+							const Type  c = coeff[ty];
+							const Type *s = &ring[(size_t)tileWidth*((y - negY + ty)%tHeight)];
+							for(int i = 0; i < n; i++) {
+								policy.reduce(a[i], policy.merge(s[i], c)); }
+						}
+
+						Type *outRow = out + (size_t)width*y + xs;
+						for(int i = 0; i < n; i++) {
+							outRow[i] = policy.result(a[i], taps); }
+					}
+				}
+			});
+			return;
+		}
+
+		// Every other template is computed in 2D tiles
+		const int tilesX = (width  + tileWidth  - 1)/tileWidth;
+		const int tilesY = (height + tileHeight - 1)/tileHeight;
+		parallelFor(0, tilesX*tilesY, [&](int first, int last)
+		{
+			std::vector<accumulator> acc(tileWidth);
+			for(int tile = first; tile < last; tile++)
+			{
+				const int tx0 = (tile%tilesX)*tileWidth,  tx1 = (tx0 + tileWidth  < width)?(tx0 + tileWidth):width;
+				const int ty0 = (tile/tilesX)*tileHeight, ty1 = (ty0 + tileHeight < height)?(ty0 + tileHeight):height;
+
+				// The part of the tile whose neighbourhoods lie inside the image
+				const int ix0 = (tx0 > x0)?tx0:x0;
+				const int ix1 = (tx1 < x1)?tx1:x1;
+
+				for(int y = ty0; y < ty1; y++)
+				{
+					Type *outRow = out + (size_t)width*y;
+					if(y < y0 || y >= y1 || ix1 <= ix0)
+					{
+						for(int x = tx0; x < tx1; x++) {
+							outRow[x] = border(x, y, coeff); }
+						continue;
+					}
+
+					// Interior span, one tap at a time across the span
+					int n = ix1 - ix0;
+					accumulator *a = &acc[0];
+					for(int i = 0; i < n; i++) {
+						a[i] = policy.init(); }
+					for(int ty = 0; ty < tHeight; ty++)
+					{
+						const Type *inRow = in + (size_t)width*(y - negY + ty) + (ix0 - negX);
+						for(int tx = 0; tx < tWidth; tx++)
+						{
+							const Type  c = coeff[tx + tWidth*ty];
+							const Type *s = inRow + tx;
+							for(int i = 0; i < n; i++) {
+								policy.reduce(a[i], policy.merge(s[i], c)); }
+						}
+					}
+					for(int i = 0; i < n; i++) {
+						outRow[ix0 + i] = policy.result(a[i], taps); }
+
+					for(int x = tx0; x < ix0; x++) {
+						outRow[x] = border(x, y, coeff); }
+					for(int x = ix1; x < tx1; x++) {
+						outRow[x] = border(x, y, coeff); }
+				}
+			}
+		});
+	}
+}	// end namespace
+
+#endif
\ No newline at end of file
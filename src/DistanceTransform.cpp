@@ -0,0 +1,109 @@
+/** @file DistanceTransform.cpp
+	Contains function definitions that are declared in DistanceTransform.h
+*/
+
+#include "DistanceTransform.h"
+#include <limits>
+
+namespace ImageTL
+{
+	// The squared distance transform of one row, where column x has its
+	// nearest feature at row rows[x], or -1 for none.  v holds the columns
+	// whose parabolas make the lower envelope and z the boundaries between
+	// them.
+	static void distance_row(const int *rows, int y, int width, float *squared, int *nearest,
+							 std::vector<int> &v, std::vector<double> &z, std::vector<double> &f)
+	{
+		const double inf = std::numeric_limits<double>::infinity();
+		int k = -1;
+		for(int q = 0; q < width; q++)
+		{
+			if(rows[q] < 0) {
+				continue; }
+			f[q] = (double)(y - rows[q])*(y - rows[q]);
+
+			double s = -inf;
+			while(k >= 0)
+			{
+				s = ((f[q] + (double)q*q) - (f[v[k]] + (double)v[k]*v[k]))/(2.*(q - v[k]));
+				if(s > z[k]) {
+					break; }
+				k--;
+			}
+			k++;
+			v[k] = q;
+			z[k] = (k == 0)?-inf:s;
+			z[k + 1] = inf;
+		}
+
+		if(k < 0)
+		{
+			for(int q = 0; q < width; q++)
+			{
+				squared[q] = std::numeric_limits<float>::infinity();
+				if(nearest) {
+					nearest[q] = -1; }
+			}
+			return;
+		}
+
+		k = 0;
+		for(int q = 0; q < width; q++)
+		{
+			while(z[k + 1] < q) {
+				k++; }
+			const int site = v[k];
+			squared[q] = (float)((double)(q - site)*(q - site) + f[site]);
+			if(nearest) {
+				nearest[q] = site + width*rows[site]; }
+		}
+	}
+
+	void distanceTransform(const BinaryImage &features, Image<float> &squared, Image<int> *nearest)
+	{
+		const int width = features.width(), height = features.height();
+		if(squared.width() != width || squared.height() != height) {
+			squared.resize(width, height, false); }
+		if(nearest && (nearest->width() != width || nearest->height() != height)) {
+			nearest->resize(width, height, false); }
+		if(width == 0 || height == 0) {
+			return; }
+
+		// The row of the nearest feature in the column of each pixel, found by
+		// a scan down and a scan up.  Each thread takes a band of columns and
+		// walks it a row at a time, so the reads stay in order.
+		std::vector<int> rows((size_t)width*height);
+		parallelFor(0, width, [&](int first, int last)
+		{
+			for(int x = first; x < last; x++) {
+				rows[x] = features.get(x, 0)?0:-1; }
+			for(int y = 1; y < height; y++)
+			{
+				const BinaryImage::word *bits = features.row(y);
+				int *above = &rows[(size_t)width*(y - 1)], *here = &rows[(size_t)width*y];
+				for(int x = first; x < last; x++) {
+					here[x] = ((bits[x/BinaryImage::word_bits] >> (x%BinaryImage::word_bits)) & 1)?y:above[x]; }
+			}
+			for(int y = height - 2; y >= 0; y--)
+			{
+				const int *below = &rows[(size_t)width*(y + 1)];
+				int *here = &rows[(size_t)width*y];
+				for(int x = first; x < last; x++) {
+					if(below[x] >= 0 && (here[x] < 0 || below[x] - y < y - here[x])) {
+						here[x] = below[x]; } }
+			}
+		}, 64);
+
+		// The lower envelope along each row
+		float *const distance = squared.data();
+		int *const site = nearest?nearest->data():NULL;
+		parallelFor(0, height, [&](int first, int last)
+		{
+			std::vector<int> v(width);
+			std::vector<double> z(width + 1), f(width);
+			for(int y = first; y < last; y++) {
+				distance_row(&rows[(size_t)width*y], y, width, distance + (size_t)width*y,
+							 site?(site + (size_t)width*y):NULL, v, z, f); }
+		}, 16);
+	}
+}	//End namespace
\ No newline at end of file
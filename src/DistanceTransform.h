@@ -0,0 +1,45 @@
+#ifndef __DISTANCETRANSFORM_H__
+#define __DISTANCETRANSFORM_H__
+/** @file DistanceTransform.h
+	Contains distanceTransform(), the exact Euclidean distance from every
+	pixel to the nearest selected pixel of a mask.
+*/
+
+#include "BinaryImage.h"
+
+namespace ImageTL
+{
+	/** Computes the squared Euclidean distance from every pixel to the
+		nearest pixel selected in <i>features</i>.
+		This is the algorithm of Felzenszwalb and Huttenlocher, which is
+		linear in the number of pixels.  A pass down the columns finds the
+		nearest feature in each column, and a pass along the rows takes the
+		lower envelope of the parabolas that the columns give.  The columns
+		are split between the threads in bands, and the rows in bands.
+
+		@param features The mask of feature pixels, which are at distance 0.
+		@param squared Resized to the mask and set to the squared distances.
+			Pixels of a mask without features are set to infinity.
+		@param nearest If this isn't NULL it is resized to the mask and set to
+			the index <tt>x + width*y</tt> of the nearest feature of each
+			pixel, or -1 if there are none.
+		@code
+		BinaryImage edges = BinaryImage::compare(gradient, compare_greater, threshold);
+		Image<float> squared;
+		Image<int> nearest;
+		distanceTransform(edges, squared, &nearest);
+		@endcode
+	*/
+	void distanceTransform(const BinaryImage &features, Image<float> &squared, Image<int> *nearest = NULL);
+
+	/** Computes the squared Euclidean distance from every pixel to the
+		nearest pixel of <i>features</i> that isn't zero.
+		@copydetails distanceTransform(const BinaryImage&, Image<float>&, Image<int>*)
+	*/
+	template<class Type> void distanceTransform(const Image<Type> &features, Image<float> &squared, Image<int> *nearest = NULL)
+	{
+		distanceTransform(BinaryImage(features), squared, nearest);
+	}
+}	// end namespace
+
+#endif
\ No newline at end of file
@@ -0,0 +1,268 @@
+#ifndef __FIXEDPOINTTEMPLATE_CPP__
+#define __FIXEDPOINTTEMPLATE_CPP__
+/** @file FixedPointTemplate.cpp
+	Contains function definitions that are declared in FixedPointTemplate.h
+*/
+
+#include <cmath>
+#include <type_traits>
+#include "FixedPointTemplate.h"
+
+namespace ImageTL
+{
+	// The largest magnitude of a pixel of the type
+	template<class Type> static double fixed_point_pixel_range()
+	{
+		double low = -(double)std::numeric_limits<Type>::min(), high = (double)std::numeric_limits<Type>::max();
+		return (low > high)?low:high;
+	}
+
+	// Constructors
+	template<class Type> FixedPointTemplate<Type>::FixedPointTemplate(const ConstantTemplate<double> &tem, int fractionBits)
+		: m_width(tem.width()), m_height(tem.height())
+	{
+		quantize(tem.coefficients(), fractionBits);
+	}
+
+	template<class Type> FixedPointTemplate<Type>::FixedPointTemplate(const double coeff[], int width, int height, int fractionBits)
+		: m_width(width), m_height(height)
+	{
+		quantize(coeff, fractionBits);
+	}
+
+	// Quantisation
+	template<class Type> int FixedPointTemplate<Type>::maxFractionBits(const double coeff[], int size)
+	{
+		const double range = fixed_point_pixel_range<Type>();
+		for(int f = 30; f >= 0; f--)
+		{
+			// Every coefficient fits in 16 bits, and the largest sum plus the
+			// rounding term fits in 32 bits
+			double scale = std::ldexp(1., f), sum = (f > 0)?std::ldexp(1., f - 1):0.;
+			bool fits = true;
+			for(int i = 0; i < size && fits; i++)
+			{
+				double q = std::fabs(std::floor(coeff[i]*scale + 0.5));
+				fits = (q <= 32767.);
+				sum += q*range;
+			}
+			if(fits && sum <= 2147483647.) {
+				return f; }
+		}
+		return -1;
+	}
+
+	template<class Type> void FixedPointTemplate<Type>::quantize(const double coeff[], int fractionBits)
+	{
+		if(coeff == NULL || m_width <= 0 || m_height <= 0) {
+			throw ImageException("FixedPointTemplate::FixedPointTemplate [The template must have coefficients]"); }
+
+		const int size = m_width*m_height;
+		int most = maxFractionBits(coeff, size);
+		if(fractionBits < 0) {
+			fractionBits = most; }
+		if(most < 0 || fractionBits > most)
+		{
+			std::stringstream msg_stream;
+			msg_stream<<"FixedPointTemplate::FixedPointTemplate [The coefficients cannot be quantised with "<<fractionBits<<" fraction bits]";
+			throw ImageException(msg_stream.str());
+		}
+
+		m_fractionBits = fractionBits;
+		m_coeff.resize(size);
+		const double scale = std::ldexp(1., fractionBits);
+		double error = 0.;
+		for(int i = 0; i < size; i++)
+		{
+			m_coeff[i] = (short)std::floor(coeff[i]*scale + 0.5);
+			error += std::fabs(m_coeff[i]/scale - coeff[i]);
+		}
+		m_errorBound = error*fixed_point_pixel_range<Type>() + ((fractionBits > 0)?0.5:0.);
+	}
+
+	template<class Type> double FixedPointTemplate<Type>::coefficient(int i) const
+	{
+		return std::ldexp((double)m_coeff[i], -m_fractionBits);
+	}
+
+	// Convolution
+#ifdef __SSE2__
+	// The 16 bit lanes of a pixel type, where void has none
+	template<class Type> struct fixed_point_lanes                  { typedef void lanes; typedef Type storage; };
+	template<> struct fixed_point_lanes<short>                     { typedef fixed_madd_lanes<short> lanes; typedef short storage; };
+	template<> struct fixed_point_lanes<unsigned char>             { typedef fixed_madd_lanes<unsigned char> lanes; typedef unsigned char storage; };
+	template<> struct fixed_point_lanes<char>
+	{
+		typedef std::conditional<std::numeric_limits<char>::is_signed, signed char, unsigned char>::type storage;
+		typedef fixed_madd_lanes<storage> lanes;
+	};
+
+	// Computes the pixels of a row eight at a time with pmaddwd, returning
+	// the number of pixels done
+	template<class Storage, class Lanes> static int fixed_point_row_simd(const Storage *in, const std::vector<ptrdiff_t> &offsets,
+																	   const std::vector<int> &pairs, int shift, Storage *out, int n)
+	{
+		const __m128i round = _mm_set1_epi32((shift > 0)?(1 << (shift - 1)):0), count = _mm_cvtsi32_si128(shift);
+		int i = 0;
+		for(; i + 8 <= n; i += 8)
+		{
+			__m128i a0 = round, a1 = round;
+			const Storage *s = in + i;
+			for(size_t t = 0; t < pairs.size(); t++)
+			{
+				const __m128i c = _mm_set1_epi32(pairs[t]);
+				__m128i p0 = Lanes::load(s + offsets[2*t]), p1 = Lanes::load(s + offsets[2*t + 1]);
+				a0 = _mm_add_epi32(a0, _mm_madd_epi16(_mm_unpacklo_epi16(p0, p1), c));
+				a1 = _mm_add_epi32(a1, _mm_madd_epi16(_mm_unpackhi_epi16(p0, p1), c));
+			}
+			Lanes::store(out + i, _mm_sra_epi32(a0, count), _mm_sra_epi32(a1, count));
+		}
+		return i;
+	}
+
+	template<class Type, class Lanes> struct fixed_point_simd
+	{
+		typedef typename fixed_point_lanes<Type>::storage storage;
+		static int row(const Type *in, const std::vector<ptrdiff_t> &offsets, const std::vector<int> &pairs, int shift, Type *out, int n)
+			{ return fixed_point_row_simd<storage, Lanes>((const storage*)in, offsets, pairs, shift, (storage*)out, n); }
+	};
+	template<class Type> struct fixed_point_simd<Type, void>
+	{
+		static int row(const Type *, const std::vector<ptrdiff_t> &, const std::vector<int> &, int, Type *, int) { return 0; }
+	};
+#endif
+
+	template<class Type> void convolve(const Image<Type> &src, const FixedPointTemplate<Type> &tem, Image<Type> &dest)
+	{
+		if(&dest == &src) {
+			throw ImageException("convolve [The source cannot also be the destination]"); }
+
+		const int width  = src.width(),  height  = src.height();
+		const int tWidth = tem.width(),  tHeight = tem.height();
+		const int negX = (tWidth - 1)/2,  posX = tWidth/2;
+		const int negY = (tHeight - 1)/2, posY = tHeight/2;
+		if(dest.width() != width || dest.height() != height) {
+			dest.resize(width, height, false); }
+		dest.edgeHandling() = src.edgeHandling();
+		if(width == 0 || height == 0) {
+			return; }
+
+		const short *coeff = tem.coefficients();
+		const int shift = tem.fractionBits(), round = (shift > 0)?(1 << (shift - 1)):0;
+		const Type *in  = src.data();
+		Type       *out = dest.data();
+
+		// The offset of each tap from the top left tap, in pixels
+		std::vector<ptrdiff_t> offsets(tem.size() + 1);
+		for(int t = 0; t < tem.size(); t++) {
+			offsets[t] = (t%tWidth) + (ptrdiff_t)width*(t/tWidth); }
+		offsets[tem.size()] = offsets[0];
+
+#ifdef __SSE2__
+		// Pairs of coefficients packed into the two 16 bit halves of an int,
+		// where an odd last tap is paired with zero
+		std::vector<int> pairs((tem.size() + 1)/2);
+		for(size_t t = 0; t < pairs.size(); t++)
+		{
+			int c0 = coeff[2*t], c1 = ((int)(2*t + 1) < tem.size())?coeff[2*t + 1]:0;
+			pairs[t] = (int)((unsigned)(c1 & 0xFFFF) << 16 | (unsigned)(c0 & 0xFFFF));
+		}
+#endif
+
+		// Computes one pixel with bounds checked taps
+		auto border = [&](int x, int y) -> Type
+		{
+			int acc = round;
+			Type value;
+			for(int ty = 0; ty < tHeight; ty++) {
+				for(int tx = 0; tx < tWidth; tx++) {
+					if(src.tryGetPixel(x - negX + tx, y - negY + ty, value)) {
+						acc += (int)value*coeff[tx + tWidth*ty]; } } }
+			return saturate_cast<Type>(acc >> shift);
+		};
+
+		const int x0 = (negX < width)?negX:width;
+		const int x1 = (width - posX > x0)?(width - posX):x0;
+		parallelFor(0, height, [&](int first, int last)
+		{
+			for(int y = first; y < last; y++)
+			{
+				Type *outRow = out + (size_t)width*y;
+				if(y < negY || y + posY >= height || x1 == x0)
+				{
+					for(int x = 0; x < width; x++) {
+						outRow[x] = border(x, y); }
+					continue;
+				}
+
+				for(int x = 0; x < x0; x++) {
+					outRow[x] = border(x, y); }
+
+				const Type *s = in + (size_t)width*(y - negY) + (x0 - negX);
+				int i = 0;
+#ifdef __SSE2__
+				i = fixed_point_simd<Type, typename fixed_point_lanes<Type>::lanes>::row(s, offsets, pairs, shift, outRow + x0, x1 - x0);
+#endif
+				for(; i < x1 - x0; i++)
+				{
+					int acc = round;
+					for(int t = 0; t < tem.size(); t++) {
+						acc += (int)s[i + offsets[t]]*coeff[t]; }
+					outRow[x0 + i] = saturate_cast<Type>(acc >> shift);
+				}
+
+				for(int x = x1; x < width; x++) {
+					outRow[x] = border(x, y); }
+			}
+		}, 16);
+	}
+
+	template<class Type> double FixedPointTemplate<Type>::measureError(const Image<Type> &src, const ConstantTemplate<double> &reference) const
+	{
+		if(reference.width() != m_width || reference.height() != m_height) {
+			throw ImageException("FixedPointTemplate::measureError [The reference is not the size of the template]"); }
+
+		Image<Type> fixed;
+		convolve(src, *this, fixed);
+
+		const int negX = (m_width - 1)/2, negY = (m_height - 1)/2;
+		const double *coeff = reference.coefficients();
+		const double low = (double)std::numeric_limits<Type>::min(), high = (double)std::numeric_limits<Type>::max();
+		double error = 0.;
+		for(int y = 0; y < src.height(); y++)
+		{
+			for(int x = 0; x < src.width(); x++)
+			{
+				double sum = 0.;
+				Type value;
+				for(int ty = 0; ty < m_height; ty++) {
+					for(int tx = 0; tx < m_width; tx++) {
+						if(src.tryGetPixel(x - negX + tx, y - negY + ty, value)) {
+							sum += (double)value*coeff[tx + m_width*ty]; } } }
+
+				sum = (sum < low)?low:((sum > high)?high:sum);
+				double diff = std::fabs((double)fixed.data()[(size_t)src.width()*y + x] - sum);
+				error = (diff > error)?diff:error;
+			}
+		}
+		return error;
+	}
+}	//End namespace
+
+// Instantiate with the 8 and 16 bit types for library compilation
+#ifdef IMAGETL_LIBRARY_COMPILE
+namespace ImageTL
+{
+	template class FixedPointTemplate<char>;
+	template class FixedPointTemplate<unsigned char>;
+	template class FixedPointTemplate<short>;
+	template class FixedPointTemplate<unsigned short>;
+
+	template void convolve(const Image<char>&,           const FixedPointTemplate<char>&,           Image<char>&);
+	template void convolve(const Image<unsigned char>&,  const FixedPointTemplate<unsigned char>&,  Image<unsigned char>&);
+	template void convolve(const Image<short>&,          const FixedPointTemplate<short>&,          Image<short>&);
+	template void convolve(const Image<unsigned short>&, const FixedPointTemplate<unsigned short>&, Image<unsigned short>&);
+}
+#endif
+
+#endif
\ No newline at end of file
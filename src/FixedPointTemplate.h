@@ -0,0 +1,105 @@
+#ifndef __FIXEDPOINTTEMPLATE_H__
+#define __FIXEDPOINTTEMPLATE_H__
+/** @file FixedPointTemplate.h
+	Contains the FixedPointTemplate class, which quantises the coefficients
+	of a real template so that 8 and 16 bit images can be convolved entirely
+	in integer arithmetic.
+*/
+
+#include <vector>
+#include "Image.h"
+
+namespace ImageTL
+{
+	/** @class FixedPointTemplate
+		A template whose coefficients are stored as 16 bit integers in Q
+		format, for convolving images of 8 and 16 bit pixels.
+		Each coefficient <i>c</i> is stored as round(c*2^f), where <i>f</i> is
+		the number of fraction bits.  A convolution sums the products of the
+		pixels and the quantised coefficients in 32 bit integers, then adds
+		2^(f-1) and shifts right by <i>f</i>, which rounds the sum to the
+		nearest integer.  The fraction bits are chosen so that no sum can
+		overflow for any pixel values of the type.
+
+		With SSE2, the interior of a row is computed eight pixels at a time:
+		the pixels under two taps are interleaved and multiplied by the pair
+		of coefficients with pmaddwd.  Images of unsigned short, whose pixels
+		do not fit in a signed 16 bit lane, use the scalar path.
+		@code
+		ConstantTemplate<double> gauss(gaussian, 5, 5);
+		FixedPointTemplate<unsigned char> q(gauss);
+		Image<unsigned char> smooth;
+		convolve(camera, q, smooth);
+		// Every pixel of smooth is within q.errorBound() of the exact result
+		@endcode
+	*/
+	template<class Type> class FixedPointTemplate
+	{
+	public:
+		/** Quantises the coefficients of <i>tem</i>.
+			@param tem The real template.
+			@param fractionBits The number of fraction bits, or -1 to use the
+				most bits for which the quantised coefficients fit in 16 bits
+				and the sums fit in 32 bits.
+			@throw ImageException If the coefficients cannot be represented
+				with the requested number of fraction bits.
+		*/
+		explicit FixedPointTemplate(const ConstantTemplate<double> &tem, int fractionBits = -1);
+		FixedPointTemplate(const double coeff[], int width, int height, int fractionBits = -1);	///< @copydoc FixedPointTemplate(const ConstantTemplate<double>&, int)
+
+		int width()  const { return m_width; }					///< Returns the width of the template.
+		int height() const { return m_height; }					///< Returns the height of the template.
+		int size()   const { return m_width*m_height; }			///< Returns the width times the height of the template.
+		int fractionBits() const { return m_fractionBits; }		///< Returns the number of fraction bits of the coefficients.
+		const short* coefficients() const { return &m_coeff[0]; }	///< Returns the quantised coefficients in row-major order.
+		double coefficient(int i) const;						///< Returns the real value of quantised coefficient <i>i</i>.
+
+		/** Returns the largest difference between a pixel of a fixed-point
+			convolution and the exact convolution with the real coefficients,
+			before both are clamped to the range of the pixel type.
+			This is the quantisation error of the coefficients times the
+			largest pixel magnitude of the type, plus one half for the rounding
+			shift.
+		*/
+		double errorBound() const { return m_errorBound; }
+
+		/** Returns the largest difference between the fixed-point convolution
+			of <i>src</i> and the convolution of the same pixels with
+			<i>reference</i> in double precision, clamped to the range of the
+			pixel type.  The result is never more than errorBound().
+			@throw ImageException If <i>reference</i> is not the size of the
+				template.
+		*/
+		double measureError(const Image<Type> &src, const ConstantTemplate<double> &reference) const;
+
+		/** Returns the most fraction bits with which the <i>size</i>
+			coefficients can be quantised for this pixel type, or -1 if they
+			cannot be quantised at all.
+		*/
+		static int maxFractionBits(const double coeff[], int size);
+
+	protected:
+		void quantize(const double coeff[], int fractionBits);
+
+		int m_width;
+		int m_height;
+		int m_fractionBits;
+		double m_errorBound;
+		std::vector<short> m_coeff;
+	};
+
+	/** Convolves <i>src</i> with the quantised template <i>tem</i> and
+		stores the result in <i>dest</i>, which is resized to the dimensions
+		of <i>src</i> if needed and takes its edge handling.  Border pixels
+		follow the edge_handling of <i>src</i>, as in convolve().
+		@throw ImageException If <i>dest</i> is <i>src</i>.
+	*/
+	template<class Type> void convolve(const Image<Type> &src, const FixedPointTemplate<Type> &tem, Image<Type> &dest);
+}	// end namespace
+
+// Include the function definitions in the header if we aren't using a compiled library
+#ifdef IMAGETL_NO_LIBRARY
+#include "FixedPointTemplate.cpp"
+#endif
+
+#endif
\ No newline at end of file
@@ -0,0 +1,539 @@
+#ifndef __FIXEDTEMPLATE_H__
+#define __FIXEDTEMPLATE_H__
+/** @file FixedTemplate.h
+	Contains templates whose size is known at compile time, the named
+	templates as constexpr instances, and the convolution kernels for them.
+	The kernels are fully unrolled over the taps and compute a block of
+	output pixels per iteration, with SSE2 versions of the linear product for
+	float and double images, and pmaddwd versions for 8 and 16 bit images.
+*/
+
+#include "ConvolutionPolicies.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace ImageTL
+{
+	/** @class FixedTemplate
+		A template of constant coefficients with a compile-time size.
+		Unlike ConstantTemplate, it is a literal type that needs no allocation,
+		so it can be declared constexpr.  The coefficients are stored in
+		row-major order and the center is at <tt>((W-1)/2, (H-1)/2)</tt>, as
+		for a Template.
+		@code
+		constexpr FixedTemplate<double, 3, 3> box = {{1/9., 1/9., 1/9.,
+		                                              1/9., 1/9., 1/9.,
+		                                              1/9., 1/9., 1/9.}};
+		Image<double> smooth = im + box;
+		@endcode
+		@see convolve(const Image<Type>&, const FixedTemplate<Type, W, H>&, const Policy&, Image<Type>&)
+	*/
+	template<class Type, int W, int H> struct FixedTemplate
+	{
+		static_assert(W > 0 && H > 0, "FixedTemplate must have a positive size");
+
+		Type m_data[W*H];							///< The coefficients in row-major order.
+
+		static constexpr int width()  { return W; }		///< Returns the width of the template.
+		static constexpr int height() { return H; }		///< Returns the height of the template.
+		static constexpr int size()   { return W*H; }	///< Returns the width times the height of the template.
+
+		constexpr const Type* data() const { return m_data; }							///< Returns the coefficients in row-major order.
+		constexpr Type operator[](int index) const { return m_data[index]; }			///< Returns a coefficient by its row-major index.
+		constexpr Type operator()(int tx, int ty) const { return m_data[tx + W*ty]; }	///< Returns the coefficient in column <i>tx</i> and row <i>ty</i>.
+
+		/** Returns a copy of the template with every coefficient multiplied
+			by <i>n</i>.
+		*/
+		constexpr FixedTemplate scaled(Type n) const
+		{
+			FixedTemplate t = *this;
+			for(int i = 0; i < W*H; i++) {
+				t.m_data[i] *= n; }
+			return t;
+		}
+	};
+
+	//Common FixedTemplate definitions
+	constexpr FixedTemplate<double, 3, 3> fixed_moore = {{
+		1, 1, 1,
+		1, 1, 1,
+		1, 1, 1
+	}};
+	constexpr FixedTemplate<double, 3, 3> fixed_von_neumann = {{
+		0, 1, 0,
+		1, 1, 1,
+		0, 1, 0
+	}};
+	constexpr FixedTemplate<double, 3, 3> fixed_laplacian = {{
+		0,  1, 0,
+		1, -4, 1,
+		0,  1, 0
+	}};
+	/// The rotation invariant x derivative used by CoherenceEnhancingDiffusion().
+	constexpr FixedTemplate<double, 3, 3> fixed_deriv_x = FixedTemplate<double, 3, 3>{{
+		 -3, 0,  3,
+		-10, 0, 10,
+		 -3, 0,  3
+	}}.scaled(1/32.);
+	/// The rotation invariant y derivative used by CoherenceEnhancingDiffusion().
+	constexpr FixedTemplate<double, 3, 3> fixed_deriv_y = FixedTemplate<double, 3, 3>{{
+		 3,  10,  3,
+		 0,   0,  0,
+		-3, -10, -3
+	}}.scaled(1/32.);
+
+	/** Calls <tt>func(I)</tt> for I from <i>First</i> to <i>Last</i>-1.
+		Once the call is inlined, every index is a constant, so a loop over
+		the taps of a FixedTemplate becomes straight-line code.
+	*/
+	template<int First, int Last> struct fixed_unroll
+	{
+		template<class Func> static void run(Func &func)
+		{
+			func(First);
+			fixed_unroll<First + 1, Last>::run(func);
+		}
+	};
+	template<int Last> struct fixed_unroll<Last, Last>
+	{
+		template<class Func> static void run(Func &) {}
+	};
+
+	/** @class fixed_kernel
+		Computes <i>n</i> consecutive interior pixels of a row.
+		<i>in</i> points to the top left tap of the first pixel and
+		<i>stride</i> is the width of the image.  The general version works on
+		blocks of four pixels, so the four accumulators stay in registers and
+		each coefficient is loaded once per block.
+	*/
+	template<class Type, int W, int H, class Policy> struct fixed_kernel
+	{
+		static void row(const Type *in, size_t stride, const Type *c, const Policy &policy, Type *out, int n)
+		{
+			typedef typename Policy::accumulator accumulator;
+			int i = 0;
+			for(; i + 4 <= n; i += 4)
+			{
+				accumulator a0 = policy.init(), a1 = policy.init(), a2 = policy.init(), a3 = policy.init();
+				const Type *s = in + i;
+				auto tap = [&](int t)
+				{
+					const Type *p = s + (t%W) + stride*(t/W);
+					policy.reduce(a0, policy.merge(p[0], c[t]));
+					policy.reduce(a1, policy.merge(p[1], c[t]));
+					policy.reduce(a2, policy.merge(p[2], c[t]));
+					policy.reduce(a3, policy.merge(p[3], c[t]));
+				};
+				fixed_unroll<0, W*H>::run(tap);
+				out[i]     = policy.result(a0, W*H);
+				out[i + 1] = policy.result(a1, W*H);
+				out[i + 2] = policy.result(a2, W*H);
+				out[i + 3] = policy.result(a3, W*H);
+			}
+			for(; i < n; i++)
+			{
+				accumulator a = policy.init();
+				const Type *s = in + i;
+				auto tap = [&](int t) { policy.reduce(a, policy.merge(s[(t%W) + stride*(t/W)], c[t])); };
+				fixed_unroll<0, W*H>::run(tap);
+				out[i] = policy.result(a, W*H);
+			}
+		}
+	};
+
+#ifdef __SSE2__
+	// Linear products of double images, four pixels in two registers per block
+	template<int W, int H> struct fixed_kernel<double, W, H, MulSumPolicy<double> >
+	{
+		static void row(const double *in, size_t stride, const double *c, const MulSumPolicy<double> &policy, double *out, int n)
+		{
+			__m128d coeff[W*H];
+			for(int t = 0; t < W*H; t++) {
+				coeff[t] = _mm_set1_pd(c[t]); }
+
+			int i = 0;
+			for(; i + 4 <= n; i += 4)
+			{
+				__m128d a0 = _mm_setzero_pd(), a1 = _mm_setzero_pd();
+				const double *s = in + i;
+				auto tap = [&](int t)
+				{
+					const double *p = s + (t%W) + stride*(t/W);
+					a0 = _mm_add_pd(a0, _mm_mul_pd(_mm_loadu_pd(p),     coeff[t]));
+					a1 = _mm_add_pd(a1, _mm_mul_pd(_mm_loadu_pd(p + 2), coeff[t]));
+				};
+				fixed_unroll<0, W*H>::run(tap);
+				_mm_storeu_pd(out + i,     a0);
+				_mm_storeu_pd(out + i + 2, a1);
+			}
+			if(i < n) {
+				fixed_kernel<double, W, H, ConvolutionPolicy<double, merge_mul<double>, unity_sum<double> > >::row(in + i, stride, c, policy, out + i, n - i); }
+		}
+	};
+
+	// Linear products of float images, eight pixels in two registers per block
+	template<int W, int H> struct fixed_kernel<float, W, H, MulSumPolicy<float> >
+	{
+		static void row(const float *in, size_t stride, const float *c, const MulSumPolicy<float> &policy, float *out, int n)
+		{
+			__m128 coeff[W*H];
+			for(int t = 0; t < W*H; t++) {
+				coeff[t] = _mm_set1_ps(c[t]); }
+
+			int i = 0;
+			for(; i + 8 <= n; i += 8)
+			{
+				__m128 a0 = _mm_setzero_ps(), a1 = _mm_setzero_ps();
+				const float *s = in + i;
+				auto tap = [&](int t)
+				{
+					const float *p = s + (t%W) + stride*(t/W);
+					a0 = _mm_add_ps(a0, _mm_mul_ps(_mm_loadu_ps(p),     coeff[t]));
+					a1 = _mm_add_ps(a1, _mm_mul_ps(_mm_loadu_ps(p + 4), coeff[t]));
+				};
+				fixed_unroll<0, W*H>::run(tap);
+				_mm_storeu_ps(out + i,     a0);
+				_mm_storeu_ps(out + i + 4, a1);
+			}
+			if(i < n) {
+				fixed_kernel<float, W, H, ConvolutionPolicy<float, merge_mul<float>, unity_sum<float> > >::row(in + i, stride, c, policy, out + i, n - i); }
+		}
+	};
+
+	// Loads 8 pixels of an 8 or 16 bit image as 16 bit lanes, and stores 8
+	// 32 bit sums clamped to the range of the type
+	template<class Type> struct fixed_madd_lanes;
+	template<> struct fixed_madd_lanes<short>
+	{
+		static __m128i load(const short *p) { return _mm_loadu_si128((const __m128i*)p); }
+		static void store(short *p, __m128i lo, __m128i hi) { _mm_storeu_si128((__m128i*)p, _mm_packs_epi32(lo, hi)); }
+	};
+	template<> struct fixed_madd_lanes<unsigned char>
+	{
+		static __m128i load(const unsigned char *p) { return saturate_widen_u8(p); }
+		static void store(unsigned char *p, __m128i lo, __m128i hi) { __m128i w = _mm_packs_epi32(lo, hi); _mm_storel_epi64((__m128i*)p, _mm_packus_epi16(w, w)); }
+	};
+	template<> struct fixed_madd_lanes<signed char>
+	{
+		static __m128i load(const signed char *p) { return saturate_widen_s8(p); }
+		static void store(signed char *p, __m128i lo, __m128i hi) { __m128i w = _mm_packs_epi32(lo, hi); _mm_storel_epi64((__m128i*)p, _mm_packs_epi16(w, w)); }
+	};
+
+	/** @class fixed_madd_kernel
+		Linear products of 8 and 16 bit images, eight pixels per block.
+		The pixels under two taps are interleaved and multiplied by the pair of
+		coefficients with pmaddwd, which sums the two products into 32 bit
+		lanes, so the accumulators never overflow the way a sum in the pixel
+		type does.  The sums are packed back with saturation.
+	*/
+	template<class Type, class Lanes, int W, int H> struct fixed_madd_kernel
+	{
+		static void row(const Type *in, size_t stride, const Type *c, Type *out, int n)
+		{
+			enum { pairs = (W*H + 1)/2 };
+			__m128i coeff[pairs];
+			for(int t = 0; t < pairs; t++)
+			{
+				int c0 = c[2*t], c1 = (2*t + 1 < W*H)?c[2*t + 1]:0;
+				coeff[t] = _mm_set1_epi32((int)((unsigned)(c1 & 0xFFFF) << 16 | (unsigned)(c0 & 0xFFFF)));
+			}
+
+			int i = 0;
+			for(; i + 8 <= n; i += 8)
+			{
+				__m128i a0 = _mm_setzero_si128(), a1 = _mm_setzero_si128();
+				const Type *s = in + i;
+				auto pair = [&](int t)
+				{
+					const int t0 = 2*t, t1 = 2*t + 1;
+					__m128i p0 = Lanes::load(s + (t0%W) + stride*(t0/W));
+					__m128i p1 = (t1 < W*H)?Lanes::load(s + (t1%W) + stride*(t1/W)):_mm_setzero_si128();
+					a0 = _mm_add_epi32(a0, _mm_madd_epi16(_mm_unpacklo_epi16(p0, p1), coeff[t]));
+					a1 = _mm_add_epi32(a1, _mm_madd_epi16(_mm_unpackhi_epi16(p0, p1), coeff[t]));
+				};
+				fixed_unroll<0, pairs>::run(pair);
+				Lanes::store(out + i, a0, a1);
+			}
+			if(i < n) {
+				fixed_kernel<Type, W, H, ConvolutionPolicy<Type, merge_mul<Type>, unity_sum<Type> > >::row(in + i, stride, c, ConvolutionPolicy<Type, merge_mul<Type>, unity_sum<Type> >(), out + i, n - i); }
+		}
+	};
+
+	template<int W, int H> struct fixed_kernel<short, W, H, MulSumPolicy<short> >
+	{
+		static void row(const short *in, size_t stride, const short *c, const MulSumPolicy<short> &, short *out, int n)
+			{ fixed_madd_kernel<short, fixed_madd_lanes<short>, W, H>::row(in, stride, c, out, n); }
+	};
+
+	template<int W, int H> struct fixed_kernel<unsigned char, W, H, MulSumPolicy<unsigned char> >
+	{
+		static void row(const unsigned char *in, size_t stride, const unsigned char *c, const MulSumPolicy<unsigned char> &, unsigned char *out, int n)
+			{ fixed_madd_kernel<unsigned char, fixed_madd_lanes<unsigned char>, W, H>::row(in, stride, c, out, n); }
+	};
+
+	template<int W, int H> struct fixed_kernel<char, W, H, MulSumPolicy<char> >
+	{
+		static void row(const char *in, size_t stride, const char *c, const MulSumPolicy<char> &, char *out, int n)
+		{
+			if(std::numeric_limits<char>::is_signed) {
+				fixed_madd_kernel<signed char, fixed_madd_lanes<signed char>, W, H>::row((const signed char*)in, stride, (const signed char*)c, (signed char*)out, n); }
+			else {
+				fixed_madd_kernel<unsigned char, fixed_madd_lanes<unsigned char>, W, H>::row((const unsigned char*)in, stride, (const unsigned char*)c, (unsigned char*)out, n); }
+		}
+	};
+#endif
+
+	/** Convolves <i>src</i> with the fixed-size template <i>tem</i> using
+		<i>policy</i> and stores the result in <i>dest</i>, which must have
+		the same dimensions as <i>src</i>.
+		This gives the same result as convolve() with a ConstantTemplate of
+		the same coefficients, but the interior of each row is computed by a
+		fixed_kernel that is unrolled over the taps.  Border pixels follow the
+		edge_handling of <i>src</i>.
+	*/
+	template<class Type, int W, int H, class Policy> void convolve(const Image<Type> &src, const FixedTemplate<Type, W, H> &tem, const Policy &policy, Image<Type> &dest)
+	{
+		typedef typename Policy::accumulator accumulator;
+
+		const int width = src.width(), height = src.height();
+		const int negX = (W - 1)/2, posX = W/2;
+		const int negY = (H - 1)/2, posY = H/2;
+		if(width == 0 || height == 0) {
+			return; }
+
+		const Type *coeff = tem.data();
+		const Type *in  = src.data();
+		Type       *out = dest.data();
+
+		// Computes one pixel with bounds checked taps
+		auto border = [&](int x, int y) -> Type
+		{
+			accumulator acc = policy.init();
+			int taps = 0;
+			Type value;
+			for(int ty = 0; ty < H; ty++)
+			{
+				for(int tx = 0; tx < W; tx++)
+				{
+					if(!src.tryGetPixel(x - negX + tx, y - negY + ty, value)) {
+						continue; }
+					policy.reduce(acc, policy.merge(value, coeff[tx + W*ty]));
+					taps++;
+				}
+			}
+			return policy.result(acc, taps);
+		};
+
+		const int x0 = (negX < width)?negX:width;
+		const int x1 = (width - posX > x0)?(width - posX):x0;
+		parallelFor(0, height, [&](int first, int last)
+		{
+			for(int y = first; y < last; y++)
+			{
+				Type *outRow = out + (size_t)width*y;
+				if(y < negY || y + posY >= height || x1 == x0)
+				{
+					for(int x = 0; x < width; x++) {
+						outRow[x] = border(x, y); }
+					continue;
+				}
+
+				const Type *inRow = in + (size_t)width*(y - negY);
+				fixed_kernel<Type, W, H, Policy>::row(inRow, width, coeff, policy, outRow + x0, x1 - x0);
+
+				for(int x = 0; x < x0; x++) {
+					outRow[x] = border(x, y); }
+				for(int x = x1; x < width; x++) {
+					outRow[x] = border(x, y); }
+			}
+		}, 8);
+	}
+
+	/** @class fused_identity
+		The post operation of convolveFused() that stores the result of
+		each template in its own image.
+	*/
+	struct fused_identity
+	{
+		template<class Type, int N> void operator()(const Type (&values)[N], Type (&out)[N]) const
+		{
+			for(int k = 0; k < N; k++) {
+				out[k] = values[k]; }
+		}
+	};
+
+	/** @class fused_tensor_products
+		The post operation of convolveFused() that turns the two derivatives
+		<tt>(Ux, Uy)</tt> into the three products <tt>(Ux*Ux, Ux*Uy, Uy*Uy)</tt>
+		of the structure tensor.
+	*/
+	struct fused_tensor_products
+	{
+		template<class Type> void operator()(const Type (&values)[2], Type (&out)[3]) const
+		{
+			out[0] = values[0]*values[0];
+			out[1] = values[0]*values[1];
+			out[2] = values[1]*values[1];
+		}
+	};
+
+	/** Computes the linear convolution of <i>src</i> with each of the
+		<i>N</i> templates in <i>tems</i> in a single sweep over the image, and
+		writes the <i>M</i> values that <i>post</i> makes from them to the
+		images in <i>dest</i>.
+		Every neighbourhood is read once for all of the templates, and
+		<i>post</i> runs while the results are still in registers, so no
+		intermediate image is made.  <i>post</i> is called as
+		<tt>post(const Type (&values)[N], Type (&out)[M])</tt> for every pixel.
+		The destination images are resized to the dimensions of <i>src</i>
+		and take its edge_handling.  Border pixels follow the edge_handling of
+		<i>src</i> as in convolve().
+		@code
+		Image<double> Ux, Uy;
+		const FixedTemplate<double, 3, 3> derivs[2] = {fixed_deriv_x, fixed_deriv_y};
+		Image<double>* const out[2] = {&Ux, &Uy};
+		convolveFused(input, derivs, out, fused_identity());
+		@endcode
+	*/
+	template<class Type, int W, int H, int N, int M, class PostOp>
+	void convolveFused(const Image<Type> &src, const FixedTemplate<Type, W, H> (&tems)[N], Image<Type>* const (&dest)[M], const PostOp &post)
+	{
+		const int width = src.width(), height = src.height();
+		const int negX = (W - 1)/2, posX = W/2;
+		const int negY = (H - 1)/2, posY = H/2;
+		for(int m = 0; m < M; m++)
+		{
+			if(dest[m] == &src) {
+				throw ImageException("convolveFused [The source cannot also be a destination]"); }
+			if(dest[m]->width() != width || dest[m]->height() != height) {
+				dest[m]->resize(width, height, false); }
+			dest[m]->edgeHandling() = src.edgeHandling();
+		}
+		if(width == 0 || height == 0) {
+			return; }
+
+		Type coeff[N][W*H];
+		for(int k = 0; k < N; k++) {
+			for(int t = 0; t < W*H; t++) {
+				coeff[k][t] = tems[k][t]; } }
+
+		const Type *in = src.data();
+		Type *out[M];
+		for(int m = 0; m < M; m++) {
+			out[m] = dest[m]->data(); }
+
+		// Computes one pixel with bounds checked taps
+		auto border = [&](int x, int y, size_t index)
+		{
+			Type values[N], results[M], value;
+			for(int k = 0; k < N; k++) {
+				values[k] = Type(0); }
+			for(int ty = 0; ty < H; ty++)
+			{
+				for(int tx = 0; tx < W; tx++)
+				{
+					if(!src.tryGetPixel(x - negX + tx, y - negY + ty, value)) {
+						continue; }
+					for(int k = 0; k < N; k++) {
+						values[k] += value*coeff[k][tx + W*ty]; }
+				}
+			}
+			post(values, results);
+			for(int m = 0; m < M; m++) {
+				out[m][index] = results[m]; }
+		};
+
+		const int x0 = (negX < width)?negX:width;
+		const int x1 = (width - posX > x0)?(width - posX):x0;
+		parallelFor(0, height, [&](int first, int last)
+		{
+			for(int y = first; y < last; y++)
+			{
+				size_t row = (size_t)width*y;
+				if(y < negY || y + posY >= height || x1 == x0)
+				{
+					for(int x = 0; x < width; x++) {
+						border(x, y, row + x); }
+					continue;
+				}
+
+				// Interior blocks of four pixels, with every tap read once for
+				// all of the templates
+				const Type *inRow = in + (size_t)width*(y - negY) - negX;
+				int x = x0;
+				for(; x + 4 <= x1; x += 4)
+				{
+					Type acc[N][4];
+					for(int k = 0; k < N; k++) {
+						acc[k][0] = acc[k][1] = acc[k][2] = acc[k][3] = Type(0); }
+
+					const Type *s = inRow + x;
+					auto tap = [&](int t)
+					{
+						const Type *p = s + (t%W) + (size_t)width*(t/W);
+						const Type v0 = p[0], v1 = p[1], v2 = p[2], v3 = p[3];
+						for(int k = 0; k < N; k++)
+						{
+							const Type c = coeff[k][t];
+							acc[k][0] += v0*c;
+							acc[k][1] += v1*c;
+							acc[k][2] += v2*c;
+							acc[k][3] += v3*c;
+						}
+					};
+					fixed_unroll<0, W*H>::run(tap);
+
+					for(int j = 0; j < 4; j++)
+					{
+						Type values[N], results[M];
+						for(int k = 0; k < N; k++) {
+							values[k] = acc[k][j]; }
+						post(values, results);
+						for(int m = 0; m < M; m++) {
+							out[m][row + x + j] = results[m]; }
+					}
+				}
+				for(; x < x1; x++)
+				{
+					Type values[N], results[M];
+					for(int k = 0; k < N; k++) {
+						values[k] = Type(0); }
+
+					const Type *s = inRow + x;
+					auto tap = [&](int t)
+					{
+						const Type v = s[(t%W) + (size_t)width*(t/W)];
+						for(int k = 0; k < N; k++) {
+							values[k] += v*coeff[k][t]; }
+					};
+					fixed_unroll<0, W*H>::run(tap);
+
+					post(values, results);
+					for(int m = 0; m < M; m++) {
+						out[m][row + x] = results[m]; }
+				}
+
+				for(int x = 0; x < x0; x++) {
+					border(x, y, row + x); }
+				for(int x = x1; x < width; x++) {
+					border(x, y, row + x); }
+			}
+		}, 8);
+	}
+
+	/** Computes the linear convolution of <i>src</i> with each of the
+		<i>N</i> templates in <i>tems</i> in a single sweep and stores them in
+		the images in <i>dest</i>.
+		@see convolveFused(const Image<Type>&, const FixedTemplate<Type, W, H> (&)[N], Image<Type>* const (&)[M], const PostOp&)
+	*/
+	template<class Type, int W, int H, int N>
+	void convolveFused(const Image<Type> &src, const FixedTemplate<Type, W, H> (&tems)[N], Image<Type>* const (&dest)[N])
+	{
+		convolveFused(src, tems, dest, fused_identity());
+	}
+}	// end namespace
+
+#endif
\ No newline at end of file
@@ -0,0 +1,297 @@
+#ifndef __HISTOGRAM_CPP__
+#define __HISTOGRAM_CPP__
+/** @file Histogram.cpp
+	Contains function definitions that are declared in Histogram.h
+*/
+
+#include "Histogram.h"
+#include <mutex>
+#include <algorithm>
+
+namespace ImageTL
+{
+	// Converts an equalized value to the pixel type, rounding for integer types
+	template<class Type> static inline Type histogram_cast(double value)
+	{
+		return std::numeric_limits<Type>::is_integer ? Type(std::floor(value + 0.5)) : Type(value);
+	}
+
+	// Constructors
+	template<class Type> Histogram<Type>::Histogram(int bins, double minValue, double maxValue)
+	{
+		setRange(bins, minValue, maxValue);
+	}
+
+	template<class Type> Histogram<Type>::Histogram(const Image<Type> &im, int bins, double minValue, double maxValue)
+	{
+		setRange(bins, minValue, maxValue);
+		compute(im);
+	}
+
+	template<class Type> void Histogram<Type>::setRange(int bins, double minValue, double maxValue)
+	{
+		if(bins < 1) {
+			throw ImageException("Histogram::Histogram [The number of bins must be positive]"); }
+		if(maxValue < minValue) {
+			throw ImageException("Histogram::Histogram [The maximum value is less than the minimum value]"); }
+
+		m_bins  = bins;
+		m_min   = minValue;
+		m_max   = maxValue;
+		m_scale = (maxValue > minValue)?((bins - 1)/(maxValue - minValue)):0.;
+		m_total = 0;
+		m_counts.assign(bins, 0);
+	}
+
+	// Binning
+	template<class Type> void Histogram<Type>::count(const Image<Type> &im, int x, int y, int width, int height, int *counts) const
+	{
+		// Consecutive pixels go to different sub-histograms so an increment
+		// never has to wait on the increment before it
+		int *c0 = counts, *c1 = c0 + m_bins, *c2 = c1 + m_bins, *c3 = c2 + m_bins;
+		memset(counts, 0, sizeof(int)*4*m_bins);
+
+		for(int row = y; row < y + height; row++)
+		{
+			const Type *p = im.data() + (size_t)im.width()*row + x;
+			int i = 0;
+			for(; i + 4 <= width; i += 4)
+			{
+				c0[bin(p[i])]++;
+				c1[bin(p[i + 1])]++;
+				c2[bin(p[i + 2])]++;
+				c3[bin(p[i + 3])]++;
+			}
+			for(; i < width; i++) {
+				c0[bin(p[i])]++; }
+		}
+
+		for(int b = 0; b < m_bins; b++) {
+			c0[b] += c1[b] + c2[b] + c3[b]; }
+	}
+
+	template<class Type> Histogram<Type>& Histogram<Type>::compute(const Image<Type> &im)
+	{
+		int width = im.width(), height = im.height();
+		m_counts.assign(m_bins, 0);
+		m_total = width*height;
+		if(m_total == 0) {
+			return *this; }
+
+		// Each band counts into its own histograms, which are merged at the end
+		std::mutex merge;
+		parallelFor(0, height, [&](int first, int last)
+		{
+			std::vector<int> counts(4*m_bins);
+			count(im, 0, first, width, last - first, &counts[0]);
+
+			std::lock_guard<std::mutex> lock(merge);
+			for(int b = 0; b < m_bins; b++) {
+				m_counts[b] += counts[b]; }
+		}, (width < 65536)?(65536/width + 1):1);
+
+		return *this;
+	}
+
+	template<class Type> Histogram<Type>& Histogram<Type>::compute(const Image<Type> &im, int x, int y, int width, int height)
+	{
+		if(x < 0 || y < 0 || width < 0 || height < 0 || x + width > im.width() || y + height > im.height()) {
+			throw ImageException("Histogram::compute [Region is out of bounds]"); }
+
+		m_counts.assign(m_bins, 0);
+		m_total = width*height;
+		if(m_total == 0) {
+			return *this; }
+
+		std::vector<int> counts(4*m_bins);
+		count(im, x, y, width, height, &counts[0]);
+		std::copy(counts.begin(), counts.begin() + m_bins, m_counts.begin());
+
+		return *this;
+	}
+
+	// Equalization
+	template<class Type> void Histogram<Type>::clip(int limit)
+	{
+		if(limit < 1) {
+			limit = 1; }
+
+		int excess = 0;
+		for(int b = 0; b < m_bins; b++)
+		{
+			if(m_counts[b] > limit)
+			{
+				excess += m_counts[b] - limit;
+				m_counts[b] = limit;
+			}
+		}
+
+		// Spread the excess evenly, with the remainder spaced across the range
+		int share = excess/m_bins, remainder = excess%m_bins;
+		for(int b = 0; b < m_bins; b++) {
+			m_counts[b] += share; }
+		if(remainder > 0)
+		{
+			int step = m_bins/remainder;
+			for(int b = 0; remainder > 0; b += step, remainder--) {
+				m_counts[b]++; }
+		}
+	}
+
+	template<class Type> std::vector<Type> Histogram<Type>::equalizationTable() const
+	{
+		std::vector<Type> table(m_bins);
+		double scale = (m_total > 0)?((m_max - m_min)/m_total):0.;
+		int cumulative = 0;
+		for(int b = 0; b < m_bins; b++)
+		{
+			cumulative += m_counts[b];
+			table[b] = histogram_cast<Type>(m_min + scale*cumulative);
+		}
+
+		return table;
+	}
+
+	template<class Type> void Histogram<Type>::apply(Image<Type> &im, const std::vector<Type> &table) const
+	{
+		if((int)table.size() != m_bins) {
+			throw ImageException("Histogram::apply [The table does not have an entry for every bin]"); }
+
+		int width = im.width();
+		Type *data = im.data();
+		const Type *lookup = &table[0];
+		parallelFor(0, im.height(), [&](int first, int last)
+		{
+			Type *p = data + (size_t)width*first, *e = data + (size_t)width*last;
+			for(; p != e; ++p) {
+				*p = lookup[bin(*p)]; }
+		}, (width < 65536)?(65536/width + 1):1);
+	}
+
+	// Algorithms
+	template<class Type> void HistogramEqualize(Image<Type> &im, int bins, double minValue, double maxValue)
+	{
+		Histogram<Type>(im, bins, minValue, maxValue).equalize(im);
+	}
+
+	template<class Type> void CLAHE(Image<Type> &im, int tilesX, int tilesY, double clipLimit, int bins, double minValue, double maxValue)
+	{
+		int width = im.width(), height = im.height();
+		if(width == 0 || height == 0) {
+			return; }
+
+		tilesX = (tilesX < 1)?1:((tilesX > width)?width:tilesX);
+		tilesY = (tilesY < 1)?1:((tilesY > height)?height:tilesY);
+
+		// Tile boundaries and centers
+		std::vector<int> xEdge(tilesX + 1), yEdge(tilesY + 1);
+		for(int i = 0; i <= tilesX; i++) {
+			xEdge[i] = (int)((long long)width*i/tilesX); }
+		for(int i = 0; i <= tilesY; i++) {
+			yEdge[i] = (int)((long long)height*i/tilesY); }
+
+		// Make the clipped equalization mapping of every tile
+		Histogram<Type> range(bins, minValue, maxValue);
+		std::vector<double> maps((size_t)tilesX*tilesY*bins);
+		parallelFor(0, tilesX*tilesY, [&](int first, int last)
+		{
+			Histogram<Type> hist(bins, minValue, maxValue);
+			for(int tile = first; tile < last; tile++)
+			{
+				int tx = tile%tilesX, ty = tile/tilesX;
+				hist.compute(im, xEdge[tx], yEdge[ty], xEdge[tx + 1] - xEdge[tx], yEdge[ty + 1] - yEdge[ty]);
+				if(clipLimit > 0) {
+					hist.clip((int)(clipLimit*hist.total()/bins)); }
+
+				double *map = &maps[(size_t)tile*bins];
+				double scale = (maxValue - minValue)/hist.total();
+				int cumulative = 0;
+				for(int b = 0; b < bins; b++)
+				{
+					cumulative += hist[b];
+					map[b] = minValue + scale*cumulative;
+				}
+			}
+		});
+
+		// For each column and row, find the two nearest tile centers and the
+		// weight of the second one
+		std::vector<int>    xTile(width), yTile(height);
+		std::vector<double> xWeight(width), yWeight(height);
+		for(int x = 0, t = 0; x < width; x++)
+		{
+			while(t < tilesX - 1 && x >= (xEdge[t + 1] + xEdge[t + 2])/2.) {
+				t++; }
+			double c0 = (xEdge[t] + xEdge[t + 1])/2.;
+			double c1 = (t < tilesX - 1)?((xEdge[t + 1] + xEdge[t + 2])/2.):c0;
+			xTile[x]   = t;
+			xWeight[x] = (c1 > c0 && x > c0)?((x - c0)/(c1 - c0)):0.;
+		}
+		for(int y = 0, t = 0; y < height; y++)
+		{
+			while(t < tilesY - 1 && y >= (yEdge[t + 1] + yEdge[t + 2])/2.) {
+				t++; }
+			double c0 = (yEdge[t] + yEdge[t + 1])/2.;
+			double c1 = (t < tilesY - 1)?((yEdge[t + 1] + yEdge[t + 2])/2.):c0;
+			yTile[y]   = t;
+			yWeight[y] = (c1 > c0 && y > c0)?((y - c0)/(c1 - c0)):0.;
+		}
+
+		// Map every pixel by bilinear interpolation between the four tiles
+		Type *data = im.data();
+		parallelFor(0, height, [&](int first, int last)
+		{
+			for(int y = first; y < last; y++)
+			{
+				int ty0 = yTile[y], ty1 = (ty0 < tilesY - 1)?(ty0 + 1):ty0;
+				double wy = yWeight[y];
+				Type *row = data + (size_t)width*y;
+				for(int x = 0; x < width; x++)
+				{
+					int tx0 = xTile[x], tx1 = (tx0 < tilesX - 1)?(tx0 + 1):tx0;
+					double wx = xWeight[x];
+					size_t b = range.bin(row[x]);
+
+					double top    = maps[((size_t)ty0*tilesX + tx0)*bins + b]*(1. - wx) + maps[((size_t)ty0*tilesX + tx1)*bins + b]*wx;
+					double bottom = maps[((size_t)ty1*tilesX + tx0)*bins + b]*(1. - wx) + maps[((size_t)ty1*tilesX + tx1)*bins + b]*wx;
+					row[x] = histogram_cast<Type>(top*(1. - wy) + bottom*wy);
+				}
+			}
+		}, 16);
+	}
+}	//End namespace
+
+// Instantiate with common template types for library compilation
+#ifdef IMAGETL_LIBRARY_COMPILE
+namespace ImageTL
+{
+	template class Histogram<char>;
+	template class Histogram<unsigned char>;
+	template class Histogram<short>;
+	template class Histogram<unsigned short>;
+	template class Histogram<int>;
+	template class Histogram<long>;
+	template class Histogram<float>;
+	template class Histogram<double>;
+
+	template void HistogramEqualize(Image<char>&,   int, double, double);
+	template void HistogramEqualize(Image<unsigned char>&, int, double, double);
+	template void HistogramEqualize(Image<short>&,  int, double, double);
+	template void HistogramEqualize(Image<unsigned short>&, int, double, double);
+	template void HistogramEqualize(Image<int>&,    int, double, double);
+	template void HistogramEqualize(Image<long>&,   int, double, double);
+	template void HistogramEqualize(Image<float>&,  int, double, double);
+	template void HistogramEqualize(Image<double>&, int, double, double);
+
+	template void CLAHE(Image<char>&,   int, int, double, int, double, double);
+	template void CLAHE(Image<unsigned char>&, int, int, double, int, double, double);
+	template void CLAHE(Image<short>&,  int, int, double, int, double, double);
+	template void CLAHE(Image<unsigned short>&, int, int, double, int, double, double);
+	template void CLAHE(Image<int>&,    int, int, double, int, double, double);
+	template void CLAHE(Image<long>&,   int, int, double, int, double, double);
+	template void CLAHE(Image<float>&,  int, int, double, int, double, double);
+	template void CLAHE(Image<double>&, int, int, double, int, double, double);
+}
+#endif
+
+#endif
\ No newline at end of file
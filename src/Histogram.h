@@ -0,0 +1,132 @@
+#ifndef __HISTOGRAM_H__
+#define __HISTOGRAM_H__
+/** @file Histogram.h
+	Contains the histogram of an Image and the equalization functions built on
+	top of it.
+*/
+
+#include <vector>
+#include "Image.h"
+
+namespace ImageTL
+{
+	/** @class Histogram
+		Counts the pixels of an image in evenly spaced bins.
+		The centers of the bins are spread evenly from minValue() to
+		maxValue(), so the first and last bins are centered on the ends of the
+		range and each pixel is counted in the bin with the nearest center.
+		Pixels outside of the range are counted in the first or last bin.  With
+		the default of 256 bins over [0, 255] every integer value from 0 to 255
+		has its own bin.
+
+		The image is binned in parallel bands of rows.  Each band counts its
+		pixels in four interleaved sub-histograms, so that runs of equal pixels
+		do not wait on the previous increment of the same counter, and the
+		counts of every band are merged at the end.
+	*/
+	template<class Type> class Histogram
+	{
+	public:
+		/** Creates an empty histogram.
+			@param bins The number of bins.
+			@param minValue The center of the first bin.
+			@param maxValue The center of the last bin.
+		*/
+		Histogram(int bins = 256, double minValue = 0, double maxValue = 255);
+
+		/** Creates the histogram of <i>im</i>.
+			@see Histogram(int,double,double)
+		*/
+		Histogram(const Image<Type> &im, int bins = 256, double minValue = 0, double maxValue = 255);
+
+		/** Replaces the counts with the histogram of <i>im</i>.
+		*/
+		Histogram& compute(const Image<Type> &im);
+
+		/** Replaces the counts with the histogram of the <i>width</i> by
+			<i>height</i> region of <i>im</i> with its top left corner at
+			(<i>x</i>, <i>y</i>).  The region must lie inside the image.
+		*/
+		Histogram& compute(const Image<Type> &im, int x, int y, int width, int height);
+
+		int    bins()     const { return m_bins; }		///< Returns the number of bins.
+		double minValue() const { return m_min; }		///< Returns the center of the first bin.
+		double maxValue() const { return m_max; }		///< Returns the center of the last bin.
+		int    total()    const { return m_total; }		///< Returns the number of pixels counted.
+		int    operator[](int bin) const { return m_counts[bin]; }	///< Returns the count of a bin.
+
+		/** Returns the bin that <i>value</i> is counted in.
+		*/
+		int bin(Type value) const
+		{
+			double position = (double(value) - m_min)*m_scale + 0.5;
+			if(!(position > 0)) {
+				return 0; }
+			return (position < m_bins)?int(position):(m_bins - 1);
+		}
+
+		/** Returns the value at the center of <i>bin</i>.
+		*/
+		double value(int bin) const { return (m_bins > 1)?(m_min + (m_max - m_min)*bin/(m_bins - 1)):m_min; }
+
+		/** Limits every bin to <i>limit</i> counts and spreads the excess
+			evenly over all bins, as done by contrast limited equalization.
+		*/
+		void clip(int limit);
+
+		/** Returns the table that maps each bin to its equalized value.
+			The value of a bin is its position in the cumulative histogram
+			scaled to the range of the histogram.
+			@see apply()
+		*/
+		std::vector<Type> equalizationTable() const;
+
+		/** Replaces every pixel of <i>im</i> with the entry of <i>table</i>
+			for its bin.
+		*/
+		void apply(Image<Type> &im, const std::vector<Type> &table) const;
+
+		/** Equalizes <i>im</i> with the equalization table of this histogram.
+		*/
+		void equalize(Image<Type> &im) const { apply(im, equalizationTable()); }
+
+	protected:
+		void setRange(int bins, double minValue, double maxValue);
+		void count(const Image<Type> &im, int x, int y, int width, int height, int *counts) const;
+
+		std::vector<int> m_counts;	///< The count of each bin.
+		int    m_bins;				///< The number of bins.
+		int    m_total;				///< The sum of all counts.
+		double m_min;				///< The center of the first bin.
+		double m_max;				///< The center of the last bin.
+		double m_scale;				///< The number of bins per unit value.
+	};
+
+	/** Equalizes the histogram of <i>im</i>.
+		@see Histogram
+	*/
+	template<class Type> void HistogramEqualize(Image<Type> &im, int bins = 256, double minValue = 0, double maxValue = 255);
+
+	/** Performs contrast limited adaptive histogram equalization (CLAHE).
+		The image is divided into <i>tilesX</i> by <i>tilesY</i> tiles and an
+		equalization table is made from the histogram of each tile, with every
+		bin limited to <i>clipLimit</i> times the average count of a bin.  Each
+		pixel is mapped by bilinear interpolation between the tables of the
+		four nearest tiles.
+		@param im The image to equalize.
+		@param tilesX The number of tiles across the image.
+		@param tilesY The number of tiles down the image.
+		@param clipLimit The limit of each bin relative to the average count.
+			A value of zero or less disables the limit.
+		@see Histogram
+	*/
+	template<class Type> void CLAHE(Image<Type> &im, int tilesX = 8, int tilesY = 8, double clipLimit = 2.0,
+									int bins = 256, double minValue = 0, double maxValue = 255);
+}	// End namespace
+
+// Include the function definitions in the header if we aren't using a compiled library
+#ifdef IMAGETL_NO_LIBRARY
+#include "Histogram.cpp"
+#endif
+
+#endif
\ No newline at end of file
@@ -28,38 +28,186 @@ namespace ImageTL
 		return subimage;
 	}
 
-	template<class Type> void Image<Type>::writeToAscii(const char *fileName, int width, int precision)
+	template<class Type> void Image<Type>::writeToAscii(const char *fileName, int width, int precision) const
 	{
-		std::ofstream fout(fileName);
-		if(!fout)
+		writeToAscii(fileName, ascii_aligned, precision, width);
+	}
+
+	template<class Type> void Image<Type>::writeToAscii(const char *fileName, ascii_format format, int precision, int width) const
+	{
+		std::ofstream fout(fileName, std::ios::out | std::ios::binary | std::ios::trunc);
+		if(!fout) {
+			throw ImageException((std::string("Image::writeToAscii [Error opening ") + fileName) + " for writing]"); }
+
+		char separator = (format == ascii_csv)?',':((format == ascii_tsv)?'\t':' ');
+		if(format != ascii_aligned) {
+			width = 0; }
+
+		// Each row is formatted into its own slot of a shared buffer, so a band
+		// of rows can be formatted in parallel and written with a single call
+		int fieldLength = ((width > (int)ascii_traits<Type>::max_length)?width:(int)ascii_traits<Type>::max_length) + 1;
+		size_t rowLength = (size_t)m_width*fieldLength + 1;
+		int bandRows = (int)((1 << 23)/rowLength);
+		if(bandRows < threadCount()) {
+			bandRows = threadCount(); }
+		if(bandRows > m_height) {
+			bandRows = m_height; }
+
+		std::vector<char>   buffer(rowLength*bandRows);
+		std::vector<size_t> used(bandRows);
+		for(int band = 0; band < m_height; band += bandRows)
 		{
-			std::cout<<"Image: Error opening "<<fileName<<" for writing.";
-			return;
+			int rows = (m_height - band < bandRows)?(m_height - band):bandRows;
+			parallelFor(0, rows, [&](int first, int last)
+			{
+				char field[ascii_traits<Type>::max_length];
+				for(int row = first; row < last; row++)
+				{
+					char *out = &buffer[rowLength*row];
+					const Type *pixel = m_image + (size_t)m_width*(band + row);
+					for(int x = 0; x < m_width; x++)
+					{
+						if(width > 0)
+						{
+							int length = (int)(ascii_traits<Type>::format(field, pixel[x], precision) - field);
+							for(int pad = length; pad < width; pad++) {
+								*(out++) = ' '; }
+							memcpy(out, field, length);
+							out += length;
+						}
+						else {
+							out = ascii_traits<Type>::format(out, pixel[x], precision); }
+
+						*(out++) = (x == m_width - 1)?'\n':separator;
+					}
+					used[row] = out - &buffer[rowLength*row];
+				}
+			}, 16);
+
+			for(int row = 0; row < rows; row++) {
+				fout.write(&buffer[rowLength*row], used[row]); }
 		}
 
-		iterator iter = begin();
-		iterator e = end();
-		for(int i=1; iter != e; ++iter, i++)
+		if(!fout) {
+			throw ImageException((std::string("Image::writeToAscii [Error writing ") + fileName) + "]"); }
+	}
+
+	template<class Type> Image<Type>& Image<Type>::readFromAscii(const char *fileName)
+	{
+		std::ifstream fin(fileName, std::ios::in | std::ios::binary);
+		if(!fin) {
+			throw ImageException((std::string("Image::readFromAscii [Error opening ") + fileName) + "]"); }
+
+		fin.seekg(0, std::ios::end);
+		size_t fileLength = (size_t)fin.tellg();
+		fin.seekg(0, std::ios::beg);
+
+		std::vector<char> buffer(fileLength + 1);
+		fin.read(&buffer[0], fileLength);
+		buffer[fileLength] = 0;
+
+		// Find the start of every line that holds a value
+		std::vector<size_t> lines;
+		for(size_t i = 0; i < fileLength; )
+		{
+			size_t start = i;
+			bool empty = true;
+			for(; i < fileLength && buffer[i] != '\n'; i++) {
+				empty = empty && ascii_is_delimiter(buffer[i]); }
+			if(!empty) {
+				lines.push_back(start); }
+			i++;
+		}
+
+		// The first row defines the width of the image
+		int width = 0;
+		if(!lines.empty())
 		{
-			fout<<std::setfill(' ')<<std::setw(width)<<std::setprecision(precision)<<*iter;
-			if(i == m_width)
+			Type value;
+			const char *p = &buffer[lines[0]];
+			while(true)
 			{
-				i = 0;
-				fout<<std::endl;
+				while(ascii_is_delimiter(*p)) {
+					++p; }
+				if(*p == '\n' || *p == 0) {
+					break; }
+				if((p = ascii_traits<Type>::parse(p, value)) == NULL) {
+					throw ImageException("Image::readFromAscii [Invalid value on row 0]"); }
+				width++;
 			}
-			else {
-				fout<<" "; }
 		}
+
+		resize(width, (int)lines.size(), false);
+
+		parallelFor(0, m_height, [&](int first, int last)
+		{
+			for(int y = first; y < last; y++)
+			{
+				const char *p = &buffer[lines[y]];
+				Type *pixel = m_image + (size_t)m_width*y;
+				for(int x = 0; x <= m_width; x++)
+				{
+					while(ascii_is_delimiter(*p)) {
+						++p; }
+
+					bool rowEnd = (*p == '\n' || *p == 0);
+					if(x == m_width && rowEnd) {
+						break; }
+					if(x == m_width || rowEnd)
+					{
+						std::stringstream msg_stream;
+						msg_stream<<"Image::readFromAscii [Row "<<y<<" does not hold "<<m_width<<" values]";
+						throw ImageException(msg_stream.str());
+					}
+
+					if((p = ascii_traits<Type>::parse(p, pixel[x])) == NULL)
+					{
+						std::stringstream msg_stream;
+						msg_stream<<"Image::readFromAscii [Invalid value on row "<<y<<"]";
+						throw ImageException(msg_stream.str());
+					}
+				}
+			}
+		}, 64);
+
+		return *this;
 	}
 
 	template<class Type> Type& Image<Type>::getPixel(int x, int y)
 	{
-		if(x >= 0 && y >= 0 && x < m_width && y < m_height) {
-			return m_image[m_width*y + x]; }
+		if(x >= 0 && y >= 0 && x < m_width && y < m_height)
+		{
+			detach();
+			return m_image[m_width*y + x];
+		}
 
 		throw ImageException("Image::getPixel [Out of bounds]");
 	}
 
+	template<class Type> bool Image<Type>::tryGetPixel(int x, int y, Type &value) const
+	{
+		if(x >= 0 && y >= 0 && x < m_width && y < m_height)
+		{
+			value = m_image[m_width*y + x];
+			return true;
+		}
+		else if(m_edgeHandling == edge_zero)
+		{
+			value = Type(0);
+			return true;
+		}
+		else if(m_edgeHandling == edge_clamp)
+		{
+			x = (x < 0)?0:((x >= m_width)?(m_width - 1):x);
+			y = (y < 0)?0:((y >= m_height)?(m_height - 1):y);
+			value = m_image[m_width*y + x];
+			return true;
+		}
+		else if(m_edgeHandling == edge_skip) {
+			return false; }
+		else {
+			throw ImageException("Image::tryGetPixel [Invalid edge handling]"); }
+	}
 	template<class Type> Type Image<Type>::getPixel(int x, int y) const
 	{
 		bool xNeg = (x >= 0), xPos = (x < m_width), yNeg = (y >= 0), yPos = (y < m_height);
@@ -69,10 +217,10 @@ namespace ImageTL
 			return Type(0); }
 		else if(m_edgeHandling == edge_clamp)
 		{
-			x = !xNeg?x:0;
-			x = !xPos?x:m_width-1;
-			y = !yNeg?y:0;
-			y = !yPos?y:m_height-1;
+			x = xNeg?x:0;
+			x = xPos?x:m_width-1;
+			y = yNeg?y:0;
+			y = yPos?y:m_height-1;
 			return m_image[m_width*y + x];
 		}
 		else if(m_edgeHandling == edge_skip) {
@@ -86,6 +234,7 @@ namespace ImageTL
 		if(location<0 || location>=m_width*m_height) {
 			throw ImageException("Image::getPixel [Out of bounds]"); }
 
+		detach();
 		return m_image[location];
 	}
 
@@ -114,8 +263,8 @@ namespace ImageTL
 		else {
 			max = -std::numeric_limits<Type>::max(); }
 
-		iterator e = end();
-		for(iterator i = begin(); i != e; ++i) {
+		const_iterator e = end();
+		for(const_iterator i = begin(); i != e; ++i) {
 			if(*i > max) {
 				max = *i; } }
 		return max;
@@ -124,8 +273,8 @@ namespace ImageTL
 	template<class Type> Type Image<Type>::min() const
 	{
 		Type min = std::numeric_limits<Type>::max();
-		iterator e = end();
-		for(iterator i = begin(); i != e; ++i) {
+		const_iterator e = end();
+		for(const_iterator i = begin(); i != e; ++i) {
 			if(*i < min) {
 				min = *i; } }
 		return min;
@@ -134,8 +283,8 @@ namespace ImageTL
 	template<class Type> Type Image<Type>::sum() const
 	{
 		Type sum = Type(0);
-		iterator e = end();
-		for(iterator i = begin(); i != e; ++i) {
+		const_iterator e = end();
+		for(const_iterator i = begin(); i != e; ++i) {
 			sum += *i; }
 		return sum;
 	}
@@ -149,8 +298,8 @@ namespace ImageTL
 	template<class Type> Type Image<Type>::sd() const
 	{
 		Type sum = Type(0), m = mean(), diff;
-		iterator e = end();
-		for(iterator i = begin(); i != e; ++i)
+		const_iterator e = end();
+		for(const_iterator i = begin(); i != e; ++i)
 		{
 			diff = *i - m;
 			sum += diff*diff;
@@ -160,29 +309,12 @@ namespace ImageTL
 
 	template<class Type> Image<Type> Image<Type>::genericUnary(Type (*func)(Type)) const
 	{
-		Image<Type> temp(*this, false);
-
-		iterator e = end();
-		iterator i = begin();
-		iterator temp_i = temp.begin();
-		for(; i != e; ++i, ++temp_i) {
-			*temp_i = (*func)(*i); }
-
-		return temp;
+		return genericUnary<Type (*)(Type)>(func);
 	}
 
 	template<class Type> Image<Type> Image<Type>::genericBinary(const Image<Type> &im, Type (*func)(Type, Type)) const
 	{
-		Image<Type> temp(*this, false);
-
-		iterator e = end();
-		iterator i = begin();
-		iterator temp_i = temp.begin();
-		iterator im_i   = im.begin();
-		for(; i != e; ++i, ++temp_i, ++im_i) {
-			*temp_i = (*func)(*i, *im_i); }
-
-		return temp;
+		return genericBinary<Type (*)(Type, Type)>(im, func);
 	}
 
 	template<class Type> Image<Type> Image<Type>::genericConvolution(Template<Type>& tem,
@@ -220,27 +352,21 @@ namespace ImageTL
 	template<class Type> Image<Type> Image<Type>::operator+(Template<Type>& t) const
 	{
 		Image<Type> iNew(*this, false);
-
-		MulSumIterator<Type> iter(this, &t);
-		convolution_iterator iter_end = cend();
-		//iterator end = iNew.end();
-		for(iterator iterNew = iNew.begin(); iter != iter_end; ++iterNew, ++iter) {
-			*iterNew = *iter; }
+		convolve(*this, t, MulSumPolicy<Type>(), iNew);
 
 		return iNew;
 	}
 
 	template<class Type> Image<Type> Image<Type>::domainTransform(void (*func)(double&, double&))
 	{
-		Image<Type> temp = *this;
+		Image<Type> temp(*this, false);
 		int i = 0;
 		double xNew, yNew;
-		iterator e = end();
+		iterator e = temp.end();
 		for(iterator iter = temp.begin(); iter != e; ++iter, i++)
 		{
-			// ******** Need to confirm this code (xNew and yNew). There was a bug here originally.
 			xNew = i%m_width;
-			yNew = i/m_height;
+			yNew = i/m_width;
 			(*func)(xNew, yNew);
 			const Image<Type> *that = this;
 			*iter = that->getPixel(xNew, yNew);
@@ -251,13 +377,13 @@ namespace ImageTL
 
 	template<class Type> Image<Type> Image<Type>::domainTransform(void (*func)(int&, int&))
 	{
-		Image<Type> temp = *this;
+		Image<Type> temp(*this, false);
 		int xNew, yNew, i = 0;
-		iterator e = end();
+		iterator e = temp.end();
 		for(iterator iter = temp.begin(); iter != e; ++iter, i++)
 		{
 			xNew = i%m_width;
-			yNew = i/m_height;
+			yNew = i/m_width;
 			(*func)(xNew, yNew);
 			*iter = getPixel(xNew, yNew);
 		}
@@ -275,24 +401,83 @@ namespace ImageTL
 			m_image = allocateImage();
 			return (*this);
 		}
+		else {
+			return resize(width, height, filter_bilinear); }
+	}
+
+	template<class Type> Image<Type>& Image<Type>::resize(int width, int height, resample_filter filter)
+	{
+		if(m_image == NULL) {
+			return resize(width, height, false); }
+
+		Image<Type> iNew(width, height, m_edgeHandling);
+		resample(m_image, m_width, m_height, iNew.m_image, width, height, filter);
+		*this = iNew;
+		return (*this);
+	}
+
+	template<class Type> Image<Type>& Image<Type>::transpose()
+	{
+		if(m_image == NULL) {
+			return (*this); }
+
+		if(m_width == m_height)
+		{
+			detach();
+			transposeSquare(m_image, m_width);
+		}
 		else
 		{
-			const Image<Type>* const_this = this;
-			Image<Type> iNew(width, height, m_edgeHandling);
-			int newWidthMax  = width - 1,  oldWidthMax  = m_width - 2;
-			int newHeightMax = height - 1, oldHeightMax = m_height - 2;
-			for(int y=0; y<height; y++)
-			{
-				for(int x=0; x<width; x++)
-				{
-					iNew.getPixel(int(x), int(y)) =
-					const_this->getPixel( double(x*( oldWidthMax /(double)newWidthMax )),
-										  double(y*( oldHeightMax/(double)newHeightMax )) );
-				}
-			}
+			Image<Type> iNew(m_height, m_width, m_edgeHandling);
+			transposeCopy(m_image, m_width, m_height, iNew.m_image);
 			*this = iNew;
-			return (*this);
 		}
+		return (*this);
+	}
+
+	template<class Type> Image<Type>& Image<Type>::rotate90()
+	{
+		return transpose().flipH();
+	}
+
+	template<class Type> Image<Type>& Image<Type>::rotate180()
+	{
+		if(m_image != NULL)
+		{
+			detach();
+			std::reverse(m_image, m_image + (size_t)m_width*m_height);
+		}
+		return (*this);
+	}
+
+	template<class Type> Image<Type>& Image<Type>::rotate270()
+	{
+		return transpose().flipV();
+	}
+
+	template<class Type> Image<Type>& Image<Type>::flipH()
+	{
+		if(m_image == NULL) {
+			return (*this); }
+
+		detach();
+		parallelFor(0, m_height, [&](int first, int last)
+		{
+			for(int y = first; y < last; y++) {
+				std::reverse(m_image + (size_t)m_width*y, m_image + (size_t)m_width*(y + 1)); }
+		}, 64);
+		return (*this);
+	}
+
+	template<class Type> Image<Type>& Image<Type>::flipV()
+	{
+		if(m_image == NULL) {
+			return (*this); }
+
+		detach();
+		for(int y = 0; y < m_height/2; y++) {
+			std::swap_ranges(m_image + (size_t)m_width*y, m_image + (size_t)m_width*(y + 1), m_image + (size_t)m_width*(m_height - 1 - y)); }
+		return (*this);
 	}
 
 	//Constructors/Destructor
@@ -301,6 +486,7 @@ namespace ImageTL
 		m_width  = 0;
 		m_height = 0;
 		m_image  = NULL;
+		m_share  = NULL;
 		m_edgeHandling = eh;
 	}
 
@@ -308,6 +494,7 @@ namespace ImageTL
 	{
 		m_width  = width;
 		m_height = height;
+		m_share  = NULL;
 		m_image  = allocateImage();
 		m_edgeHandling = eh;
 	}
@@ -316,6 +503,7 @@ namespace ImageTL
 	{
 		m_width  = width;
 		m_height = height;
+		m_share  = NULL;
 		m_image  = allocateImage();
 		m_edgeHandling = eh;
 
@@ -329,9 +517,14 @@ namespace ImageTL
 	{
 		m_width  = i.m_width;
 		m_height = i.m_height;
-		m_image  = allocateImage();
+		m_image  = NULL;
+		m_share  = NULL;
 		m_edgeHandling = i.edgeHandling();
 
+		if(copy && shareImage(i)) {
+			return; }
+
+		m_image = allocateImage();
 		if(copy) {
 			copyImage(m_image, i.m_image); }
 	}
@@ -339,6 +532,7 @@ namespace ImageTL
 	template<class Type> Image<Type>::~Image()
 	{
 		freeImage(m_image);
+		releaseShare();
 	}
 
 	//Array memory allocation
@@ -348,6 +542,19 @@ namespace ImageTL
 		try
 		{
 			im = new Type[m_width*m_height];
+
+			// Only the array that becomes m_image is counted, so an array
+			// allocated while the current one is still in use is not shared
+			if(m_share == NULL)
+			{
+				try {
+					m_share = new image_share(im); }
+				catch(...)
+				{
+					delete[] im;
+					throw;
+				}
+			}
 		}
 		catch(std::bad_alloc &e)
 		{
@@ -362,10 +569,75 @@ namespace ImageTL
 
 	template<class Type> void Image<Type>::freeImage(Type *i)
 	{
-		if(i != NULL) {
+		if(i == NULL) {
+			return; }
+
+		if(m_share != NULL && m_share->pixels == i) {
+			releaseShare(); }
+		else {
 			delete[] i; }
 	}
 
+	//Shared arrays
+	template<class Type> void Image<Type>::releaseShare()
+	{
+		if(m_share == NULL) {
+			return; }
+
+		if(m_share->refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+		{
+			delete[] m_share->pixels;
+			delete m_share;
+		}
+		m_share = NULL;
+	}
+
+	template<class Type> bool Image<Type>::shareImage(const Image<Type> &im)
+	{
+		if(m_share != NULL && m_share == im.m_share && owned() && im.owned()) {
+			return true; }
+
+		// A derived class may have its own array, e.g. a mapped file
+		if(!copyOnWrite() || !im.owned() || (m_image != NULL && !owned())) {
+			return false; }
+
+		image_share *share = im.m_share;
+		share->refs.fetch_add(1, std::memory_order_relaxed);
+
+		freeImage(m_image);
+		releaseShare();
+
+		m_share  = share;
+		m_image  = share->pixels;
+		m_width  = im.m_width;
+		m_height = im.m_height;
+		return true;
+	}
+
+	template<class Type> void Image<Type>::unshare()
+	{
+		image_share *share = m_share;
+		m_share = NULL;
+
+		Type *im;
+		try {
+			im = allocateImage(); }
+		catch(...)
+		{
+			m_share = share;
+			throw;
+		}
+		copyImage(im, m_image);
+
+		// The other images may have let go of the array in the mean time
+		m_image = im;
+		if(share->refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+		{
+			delete[] share->pixels;
+			delete share;
+		}
+	}
+
 	//This returns true if the image passed is equal to the calling image
 	template<class Type> bool Image<Type>::equalTo(const Image<Type> &im) const
 	{
@@ -384,7 +656,7 @@ namespace ImageTL
 	//This returns true if every point in the image passed is equal to d
 	template<class Type> bool Image<Type>::equalTo(const Type& d) const
 	{
-		for(iterator i = begin(); i != end(); ++i) {
+		for(const_iterator i = begin(); i != end(); ++i) {
 			if(*i != d) {
 				return false; } }
 		return true;
@@ -393,17 +665,21 @@ namespace ImageTL
 	//Operators
 	template<class Type> Image<Type>& Image<Type>::operator=(const Image<Type> &im)
 	{
-		if(m_height != im.m_height || m_width != im.m_width)
+		if(!shareImage(im))
 		{
-			freeImage(m_image);
+			// Shared data is about to be overwritten, so it is not copied
+			if(m_height != im.m_height || m_width != im.m_width || shared())
+			{
+				freeImage(m_image);
 
-			m_height = im.m_height;
-			m_width  = im.m_width;
+				m_height = im.m_height;
+				m_width  = im.m_width;
 
-			m_image = allocateImage();
-		}
+				m_image = allocateImage();
+			}
 
-		copyImage(m_image, im.m_image);
+			copyImage(m_image, im.m_image);
+		}
 
 		m_edgeHandling = im.m_edgeHandling;
 
@@ -444,6 +720,7 @@ namespace ImageTL
 	{
 		if(m_height == im.m_height && m_width == im.m_width)
 		{
+			detach();
 			int loopLength = m_width*m_height;
 			for(int i=0; i<loopLength; i++) {
 				m_image[i] += im.m_image[i]; }
@@ -474,6 +751,7 @@ namespace ImageTL
 	{
 		if(m_height == im.m_height && m_width == im.m_width)
 		{
+			detach();
 			int loopLength = m_width*m_height;
 			for(int i=0; i<loopLength; i++) {
 				m_image[i] -= im.m_image[i]; }
@@ -504,6 +782,7 @@ namespace ImageTL
 	{
 		if(m_height == im.m_height && m_width == im.m_width)
 		{
+			detach();
 			int loopLength = m_width*m_height;
 			for(int i=0; i<loopLength; i++) {
 				m_image[i] *= im.m_image[i]; }
@@ -534,6 +813,7 @@ namespace ImageTL
 	{
 		if(m_height == im.m_height && m_width == im.m_width)
 		{
+			detach();
 			int loopLength = m_width*m_height;
 			for(int i=0; i<loopLength; i++)
 			{
@@ -830,12 +1110,7 @@ namespace ImageTL
 	template<class Type> Image<Type> Image<Type>::operator|(Template<Type> &t) const
 	{
 		Image<Type> iNew(*this, false);
-
-		MulMaxIterator<Type> iter(this, &t);
-		convolution_iterator iter_end = cend();
-		//iterator end = iNew.end();
-		for(iterator iterNew = iNew.begin(); iter != iter_end; ++iterNew, ++iter) {
-			*iterNew = *iter; }
+		convolve(*this, t, MulMaxPolicy<Type>(), iNew);
 
 		return iNew;
 	}
@@ -844,12 +1119,7 @@ namespace ImageTL
 	template<class Type> Image<Type> Image<Type>::operator&(Template<Type> &t) const
 	{
 		Image<Type> iNew(*this, false);
-
-		MulMinIterator<Type> iter(this, &t);
-		convolution_iterator iter_end = cend();
-		//iterator end = iNew.end();
-		for(iterator iterNew = iNew.begin(); iter != iter_end; ++iterNew, ++iter) {
-			*iterNew = *iter; }
+		convolve(*this, t, MulMinPolicy<Type>(), iNew);
 
 		return iNew;
 	}
@@ -858,6 +1128,7 @@ namespace ImageTL
 	{
 		if(m_height == im.m_height && m_width == im.m_width)
 		{
+			detach();
 			int loopLength = m_width*m_height;
 			for(int i=0; i<loopLength; i++) {
 				m_image[i] = (m_image[i] < im.m_image[i])?im.m_image[i]:m_image[i]; }
@@ -872,6 +1143,7 @@ namespace ImageTL
 	{
 		if(m_height == im.m_height && m_width == im.m_width)
 		{
+			detach();
 			int loopLength = m_width*m_height;
 			for(int i=0; i<loopLength; i++) {
 				m_image[i] = (m_image[i] > im.m_image[i])?im.m_image[i]:m_image[i]; }
@@ -1014,7 +1286,9 @@ namespace ImageTL
 namespace ImageTL
 {
 	template class Image<char>;
+	template class Image<unsigned char>;
 	template class Image<short>;
+	template class Image<unsigned short>;
 	template class Image<int>;
 	template class Image<long>;
 	template class Image<float>;
@@ -1027,6 +1301,13 @@ namespace ImageTL
 	template Image<char> operator|(const char& left, const Image<char>& right);
 	template Image<char> operator&(const char& left, const Image<char>& right);
 
+	template Image<unsigned char> operator+(const unsigned char& left, const Image<unsigned char>& right);
+	template Image<unsigned char> operator-(const unsigned char& left, const Image<unsigned char>& right);
+	template Image<unsigned char> operator*(const unsigned char& left, const Image<unsigned char>& right);
+	template Image<unsigned char> operator/(const unsigned char& left, const Image<unsigned char>& right);
+	template Image<unsigned char> operator|(const unsigned char& left, const Image<unsigned char>& right);
+	template Image<unsigned char> operator&(const unsigned char& left, const Image<unsigned char>& right);
+
 	template Image<short> operator+(const short& left, const Image<short>& right);
 	template Image<short> operator-(const short& left, const Image<short>& right);
 	template Image<short> operator*(const short& left, const Image<short>& right);
@@ -1034,6 +1315,13 @@ namespace ImageTL
 	template Image<short> operator|(const short& left, const Image<short>& right);
 	template Image<short> operator&(const short& left, const Image<short>& right);
 
+	template Image<unsigned short> operator+(const unsigned short& left, const Image<unsigned short>& right);
+	template Image<unsigned short> operator-(const unsigned short& left, const Image<unsigned short>& right);
+	template Image<unsigned short> operator*(const unsigned short& left, const Image<unsigned short>& right);
+	template Image<unsigned short> operator/(const unsigned short& left, const Image<unsigned short>& right);
+	template Image<unsigned short> operator|(const unsigned short& left, const Image<unsigned short>& right);
+	template Image<unsigned short> operator&(const unsigned short& left, const Image<unsigned short>& right);
+
 	template Image<int> operator+(const int& left, const Image<int>& right);
 	template Image<int> operator-(const int& left, const Image<int>& right);
 	template Image<int> operator*(const int& left, const Image<int>& right);
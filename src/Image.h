@@ -26,11 +26,20 @@ namespace ImageTL {	template<class Type> class Image; }
 #include <iostream>
 #include <iomanip>
 #include <cmath>
+#include <vector>
+#include <atomic>
 #include "ImageException.h"
+#include "ImageThreads.h"
+#include "AsciiFormat.h"
+#include "ImageLut.h"
 #include "Template.h"
 #include "ImageIterator.h"
 #include "ConvolutionIterator.h"
 #include "CommonIterators.h"
+#include "ConvolutionPolicies.h"
+#include "FixedTemplate.h"
+#include "ImageResample.h"
+#include "ImageTranspose.h"
 
 /** @namespace ImageTL
 	Contains all the classes and functions of the %Image Processing Library.
@@ -66,6 +75,30 @@ namespace ImageTL
 					zero.*/
 	};
 
+	/** Returns a reference to the copy-on-write setting of the library.
+		@see copyOnWrite(), setCopyOnWrite()
+	*/
+	inline std::atomic<bool>& copyOnWriteSetting()
+	{
+		static std::atomic<bool> setting(false);
+		return setting;
+	}
+
+	/** Turns copy-on-write image copies on or off.
+		While it is on, copying an Image with the copy constructor or the
+		equals operator shares the pixel data of the original instead of
+		copying it.  The data is only copied when one of the images sharing it
+		is given mutable access to its pixels.  Images that already share data
+		keep sharing it when the setting is turned off.
+		@param enable True to share the pixel data of copies.
+	*/
+	inline void setCopyOnWrite(bool enable) { copyOnWriteSetting().store(enable); }
+
+	/** Returns true if copies of an Image share their pixel data.
+		@see setCopyOnWrite()
+	*/
+	inline bool copyOnWrite() { return copyOnWriteSetting().load(); }
+
 	/** @class Image
 		The core of the %Image Processing Library.
 		The purpose of this class is to hide the implementation of every
@@ -81,6 +114,17 @@ namespace ImageTL
 			relationship between | and & with boolean algebra, where | is a
 			symbol for union (v) and & is a symbol for intersection (^).
 
+		@section image_sharing Shared Pixel Data
+		When setCopyOnWrite() is turned on, copies of an image made with the
+		copy constructor or the equals operator share one reference counted
+		array of pixels.  The array is copied the first time one of the images
+		is given mutable access to it through data(), begin(), end(),
+		getPixel(int,int), the assignment operators or the in-place
+		transformations.  The const members never copy and only hand out
+		read-only pointers and iterators, so a shared image can be read by
+		several threads at once, but call data() before handing an
+		image that may be shared to several threads that write to it.
+
 		@section image_type Template Type Restrictions
 		There are a few restrictions to the type that is allowed to be used with
 		the Image class and all its derived classes.
@@ -105,6 +149,7 @@ namespace ImageTL
 	public:
 		typedef Type value_type;					///< The type passed as the template argument.
 		typedef ImageIterator<Type> iterator;		///< The iterator type to be used with this class.
+		typedef ImageIterator<const Type> const_iterator;	///< The read-only iterator returned by the const members.
 		typedef ConvolutionIterator<Type> convolution_iterator;	///< The convolution iterator type to be used with this class
 
 		Image(edge_handling eh = edge_clamp);		///< The default constructor.
@@ -134,6 +179,8 @@ namespace ImageTL
 			@param copy If copy is true the image data will be copied from
 				<i>im</i> to the new image.  Otherwise the new image will be
 				initialized to the same size as <i>im</i>.
+			@note With copyOnWrite() the data of <i>im</i> is shared rather
+				than copied.
 		*/
 		Image(const Image &im, bool copy = true);
 
@@ -166,9 +213,38 @@ namespace ImageTL
 			@param fileName The name of the file.
 			@param width The number of characters for each pixel of the output.
 			@param precision The number of digits for each pixel of the output.
-			@see ImageIO::write()
+			@see ImageIO::write(), readFromAscii()
+		*/
+		void writeToAscii(const char* fileName, int width = 14, int precision = 8) const;
+
+		/** Writes the contents of the image to an ASCII file in the given
+			format.
+			Each row of the image is written on its own line.  The rows are
+			formatted in bands on threadCount() threads and written with a few
+			large writes.
+			@param fileName The name of the file.
+			@param format The layout of the file.
+			@param precision The number of significant digits for each pixel of
+				a real image.  If this is zero the shortest representation that
+				reads back to the same value is used.
+			@param width The minimum number of characters for each pixel when
+				<i>format</i> is ascii_aligned.
+			@throw ImageException If the file cannot be written.
+			@see readFromAscii()
+		*/
+		void writeToAscii(const char* fileName, ascii_format format, int precision = 0, int width = 0) const;
+
+		/** Replaces the image with the contents of an ASCII file.
+			Values on a row may be separated by spaces, tabs, commas or
+			semicolons, so any file written by writeToAscii() can be read.
+			Every non-empty line is a row of the image and every row must hold
+			the same number of values.
+			@param fileName The name of the file.
+			@return A reference to the altered image.
+			@throw ImageException If the file cannot be read or is malformed.
+			@see writeToAscii()
 		*/
-		void writeToAscii(const char* fileName, int width = 14, int precision = 8);
+		Image& readFromAscii(const char* fileName);
 
 		/** Returns an ConvolutionIterator positioned at the beginning of the image.
 			The result of convolving the template with the image at the current
@@ -202,13 +278,21 @@ namespace ImageTL
 		convolution_iterator cend()	const
 			{ return convolution_iterator(this); }
 
-		/** Returns an ImageIterator positioned at the beginning of the image.
-			The iterator will progress through the image pixel by pixel.
+		/** Returns a read-only ImageIterator positioned at the beginning of
+			the image.
+			The iterator will progress through the image pixel by pixel.  It
+			cannot write to the pixels, which may be shared with other images.
 
 			@return An iterator positioned on the first pixel of the image.
 			@see end(), ImageIterator
 		*/
-		iterator begin() const { return iterator(m_image); }
+		const_iterator begin() const { return const_iterator(m_image); }
+
+		/** Returns an ImageIterator positioned at the beginning of the image,
+			first giving the image its own copy of any pixel data it shares.
+			@see begin() const, shared()
+		*/
+		iterator begin() { detach(); return iterator(m_image); }
 
 		/** Returns an ImageIterator positioned at the end of the image.
 			The result of this function should only be used to detect when an
@@ -216,7 +300,32 @@ namespace ImageTL
 			@return An iterator positioned one pixel past the end of the image.
 			@see begin(), ImageIterator
 		*/
-		iterator end() const { return iterator( m_image + m_width*m_height ); }
+		const_iterator end() const { return const_iterator( m_image + m_width*m_height ); }
+
+		/** Returns an ImageIterator positioned one pixel past the end of the
+			image, first giving the image its own copy of any pixel data it
+			shares.
+			@see end() const, shared()
+		*/
+		iterator end() { detach(); return iterator( m_image + m_width*m_height ); }
+
+		/** Returns a pointer to the first pixel of the image.
+			The pixels are stored row by row, so pixel (x, y) is at
+			data()[width()*y + x].  If the pixel data is shared with another
+			image it is copied first, so the pointer can always be written
+			through.
+		*/
+		Type* data() { detach(); return m_image; }
+
+		/** Returns a read-only pointer to the first pixel of the image.
+			@see data()
+		*/
+		const Type* data() const { return m_image; }
+
+		/** Returns true if the pixel data is shared with another image.
+			@see setCopyOnWrite()
+		*/
+		bool shared() const { return owned() && m_share->refs.load(std::memory_order_acquire) > 1; }
 
 		/** Returns the maximum pixel value in the image.
 			@see min(), mean(), sd(), sum()
@@ -256,6 +365,7 @@ namespace ImageTL
 			the domain of the image the function returns zero.  For
 			compatibility reasons you can set the value of a pixel not in the
 			domain of the image, but this action would be meaningless.
+			Shared pixel data is copied first.
 
 			@param x The x-coordinate of the pixel to be accessed.
 			@param y The y-coordinate of the pixel to be accessed.
@@ -267,10 +377,23 @@ namespace ImageTL
 		Type& getPixel(int x, int y);
 		Type  getPixel(int x, int y) const;
 
+		/** Reads the pixel at (<i>x</i>, <i>y</i>) following the edge
+			handling of the image, without throwing for edge_skip.
+			@param x The x-coordinate of the pixel.
+			@param y The y-coordinate of the pixel.
+			@param value Set to the pixel value if one exists.
+			@retval false If the pixel is outside the image and the edge
+				handling is edge_skip.
+			@retval true Otherwise.
+			@see getPixel(int,int) const
+		*/
+		bool  tryGetPixel(int x, int y, Type &value) const;
+
 		/** Returns the pixel value at (<i>location%width</i>,<i>location/width</i>).
 			This function returns a reference to the pixel value, therefore the
 			pixel value can also be set using this function. If <i>location</i>
 			is not in the domain of the image the function throws an exception.
+			Shared pixel data is copied first.
 
 			@param location The 1-D mapped pixel location.
 			@return A reference to the pixel at
@@ -321,14 +444,27 @@ namespace ImageTL
 
 		/** Applies <i>func</i> to each pixel in the image, replacing the image
 			with the result.
+			For 8 and 16 bit images that have more pixels than possible values,
+			<i>func</i> is evaluated once for each value that occurs in the
+			image and the result is applied as a lookup table.
 			@param func A function pointer to the function that is to be applied
 				to every pixel.
 			@return The new image.
 
-			@see genericBinary(), genericConvolution()
+			@see genericBinary(), genericConvolution(), lut_traits
 		*/
 		Image genericUnary(Type (*func)(Type)) const;
 
+		/** Applies the callable <i>func</i> to each pixel in the image,
+			replacing the image with the result.
+			Since the type of <i>func</i> is a template parameter, a functor or
+			lambda is inlined into the loop over the pixels.  The lookup table
+			of genericUnary(Type (*)(Type)) is used for 8 and 16 bit images.
+			@param func Any object that can be called as <tt>Type func(Type)</tt>.
+			@return The new image.
+		*/
+		template<class Func> Image genericUnary(Func func) const;
+
 		/** Applies <i>func</i> for each pixel in the image and <i>im</i>,
 			replacing the image with the result.
 			This function replaces each pixel with func(image(x,y), im(x,y)).
@@ -345,6 +481,17 @@ namespace ImageTL
 		*/
 		Image genericBinary(const Image &im, Type (*func)(Type, Type)) const;
 
+		/** Applies the callable <i>func</i> for each pixel in the image and
+			<i>im</i>, replacing the image with the result.
+			Since the type of <i>func</i> is a template parameter, a functor or
+			lambda is inlined into the loop over the pixels.
+			@param im An image with the same dimensions as the calling image.
+			@param func Any object that can be called as
+				<tt>Type func(Type, Type)</tt>.
+			@return The new image.
+		*/
+		template<class Func> Image genericBinary(const Image &im, Func func) const;
+
 		/** Calculates the convolution of the image and <i>tem</i> based on the
 			merge and unity functions passed.
 			@param tem A reference to the template that will be used to
@@ -375,6 +522,29 @@ namespace ImageTL
 		*/
 		Image genericConvolution(convolution_iterator& c_iter) const;
 
+		/** Calculates the convolution of the image and <i>tem</i> based on a
+			compile-time merge and unity policy, such as MulSumPolicy or
+			AddMaxPolicy.
+			The merge and unity steps are inlined into a loop that streams
+			over the taps, so no list of merged values is built.
+			@param tem A reference to the template that will be used to
+				calculate the convolution.
+			@param policy The policy that merges and unifies each tap.
+			@param tiling The size of the tiles the output is computed in, where
+				a size of zero is chosen from cacheSize().
+			@return The new image.
+
+			@see convolve(), ConvolutionPolicies.h
+		*/
+		template<class Policy> Image genericConvolution(Template<Type>& tem, const Policy &policy,
+														const convolution_tiling &tiling = convolution_tiling()) const;
+
+		/** Calculates the convolution of the image and the fixed-size
+			template <i>tem</i> based on a compile-time merge and unity policy.
+			@see convolve(), FixedTemplate
+		*/
+		template<class Policy, int W, int H> Image genericConvolution(const FixedTemplate<Type, W, H>& tem, const Policy &policy) const;
+
 		/** Applies a domain transform based on a bilinear approximation of the
 			image.
 			For each pixel in the image, func(x,y) is called.  The <i>func</i>
@@ -383,6 +553,9 @@ namespace ImageTL
 			@param func A function pointer to the function that will calculate
 				the transform.
 			@return The new image.
+			@note For affine and projective transforms, warpAffine() and
+				warpPerspective() in ImageRemap.h step the coordinates across
+				each row instead of calling a function for every pixel.
 
 			@see getPixel(double,double) const
 		*/
@@ -404,25 +577,42 @@ namespace ImageTL
 			@param width The new width of the image.
 			@param height The new height of the image.
 			@param retain If this is true the image data will be retained and
-				resized to match the new dimensions using a bilinear
-				approximation.  If this is false the image will be resized and
-				<b>all data will be lost</b>!
+				resampled to the new dimensions with filter_bilinear, which
+				averages the covered pixels when shrinking.  If this is false
+				the image will be resized and <b>all data will be lost</b>!
 			@return A reference to the altered image.
 			@note This function <b>will</b> alter the calling image.
 
-			@see getPixel(double,double) const
+			@see resize(int,int,resample_filter), resample()
 		*/
 		Image& resize(int width, int height, bool retain = true);
 
-		// Cast operator to let you cast a Image<T1> to an Image<T2>
-		/*operator Image<float>()
-		{
-			Image<float> newImage(m_width, m_height);
-			Image<float>::iterator iterNew = newImage.begin();
-			for(iterator iter = begin(); !iter.end(); ++iter, ++iterNew) {
-				*iterNew = float(*iter); }
-			return newImage;
-		}*/
+		/** Resizes the image to the new dimensions provided, resampling the
+			image data with <i>filter</i>.
+			filter_area gives the best thumbnails for the cost, and
+			filter_lanczos3 the sharpest enlargements.
+			@return A reference to the altered image.
+			@note This function <b>will</b> alter the calling image.
+
+			@see resample()
+		*/
+		Image& resize(int width, int height, resample_filter filter);
+
+		/** Transposes the image, swapping its width and height.
+			A square image is transposed in place, swapping blocks across the
+			diagonal, and any other image through one new buffer.  Both work
+			through the image in cache-sized tiles of SIMD blocks.
+			@return A reference to the altered image.
+			@note This function <b>will</b> alter the calling image.
+		*/
+		Image& transpose();
+		Image& rotate90();		///< Rotates the image a quarter turn clockwise.  @see transpose()
+		Image& rotate180();		///< Rotates the image a half turn, in place.
+		Image& rotate270();		///< Rotates the image a quarter turn anticlockwise.  @see transpose()
+		Image& flipH();			///< Mirrors the image left to right, in place.
+		Image& flipV();			///< Mirrors the image top to bottom, in place.
+
+		// Conversions between element types are done by convert() in ImageConvert.h
 
 		// Friendly Operators
 		friend Image operator|<Type>(const Type& left, const Image& right);		///< Pixel-wise maximun.
@@ -436,6 +626,12 @@ namespace ImageTL
 		Image operator+(Template<Type>& right) const;			///< Right linear convolution product.
 		Image operator|(Template<Type>& right) const;			///< Right multiplicative maximum convolution product.
 		Image operator&(Template<Type>& right) const;			///< Right multiplicative minimun convolution product.
+		template<int W, int H> Image operator+(const FixedTemplate<Type, W, H>& right) const	///< Right linear convolution product.
+			{ return genericConvolution(right, MulSumPolicy<Type>()); }
+		template<int W, int H> Image operator|(const FixedTemplate<Type, W, H>& right) const	///< Right multiplicative maximum convolution product.
+			{ return genericConvolution(right, MulMaxPolicy<Type>()); }
+		template<int W, int H> Image operator&(const FixedTemplate<Type, W, H>& right) const	///< Right multiplicative minimun convolution product.
+			{ return genericConvolution(right, MulMinPolicy<Type>()); }
 
 		//These are min and max functions.
 		//The resoning behind using these operators is from boolean algrebra
@@ -561,6 +757,9 @@ namespace ImageTL
 			This function deallocates an array of memory pointed to by
 			<i>im.</i>.  It is a virtual function, so if a derived class uses a
 			different form of allocation it can override this function to match.
+			An override must pass any array it did not allocate itself on to
+			Image::freeImage(), since arrays allocated by the base class can be
+			shared with other images.
 
 			@param im A pointer to an image array.
 
@@ -581,12 +780,99 @@ namespace ImageTL
 		*/
 		virtual void  copyImage(Type *to, const Type *from) { memcpy(to, from, sizeof(Type)*m_height*m_width); }
 
+		/** @class image_share
+			The reference count of an array allocated by allocateImage().
+		*/
+		struct image_share
+		{
+			image_share(Type *im) : refs(1), pixels(im) {}
+			std::atomic<int> refs;					///< The number of images using the array.
+			Type* pixels;							///< The array.
+		};
+
+		/** Returns true if m_image was allocated by allocateImage(), and so
+			can be shared.
+		*/
+		bool owned() const { return m_share != NULL && m_share->pixels == m_image; }
+
+		/** Makes the image share the pixel data of <i>im</i>.
+			This is only done if copyOnWrite() is on and both arrays were
+			allocated by allocateImage().
+			@return True if the data is shared, otherwise nothing is changed.
+		*/
+		bool shareImage(const Image &im);
+
+		/** Gives the image its own copy of the pixel data if it is shared.
+			Call this before writing to m_image.
+		*/
+		void detach() { if(m_share != NULL && m_share->refs.load(std::memory_order_acquire) > 1 && m_share->pixels == m_image) { unshare(); } }
+
+		void unshare();								///< Copies shared pixel data.  @see detach()
+		void releaseShare();						///< Drops the reference to m_share, deleting the array if it was the last one.
+
 		//Data members
 		int   m_height;								///< The height of the image.
 		int   m_width;								///< The width of the image.
 		Type* m_image;								///< An m_width x m_height array used to store the image data.
+		image_share* m_share;						///< The reference count of the array last allocated, or NULL.
 		edge_handling m_edgeHandling;				///< The edge handling settings. @note This property is not inherited with the equals operator.
 	};
+
+	// Member templates are defined here so they can be used with the compiled library
+	template<class Type> template<class Func> Image<Type> Image<Type>::genericUnary(Func func) const
+	{
+		Image<Type> temp(*this, false);
+
+		size_t length = (size_t)m_width*m_height;
+		if(lut_traits<Type>::enabled && length >= (size_t)lut_traits<Type>::size)
+		{
+			std::vector<Type> table;
+			lut_build(table, func, m_image, length);
+			lut_apply(m_image, temp.m_image, length, &table[0]);
+		}
+		else
+		{
+			const Type *src = m_image;
+			Type *dest = temp.m_image;
+			for(size_t i = 0; i < length; i++) {
+				dest[i] = func(src[i]); }
+		}
+
+		return temp;
+	}
+
+	template<class Type> template<class Func> Image<Type> Image<Type>::genericBinary(const Image<Type> &im, Func func) const
+	{
+		if(m_height != im.m_height || m_width != im.m_width) {
+			throw ImageException("Image::genericBinary [Unmatched dimensions for operator]"); }
+
+		Image<Type> temp(*this, false);
+
+		size_t length = (size_t)m_width*m_height;
+		const Type *left = m_image, *right = im.m_image;
+		Type *dest = temp.m_image;
+		for(size_t i = 0; i < length; i++) {
+			dest[i] = func(left[i], right[i]); }
+
+		return temp;
+	}
+
+	template<class Type> template<class Policy> Image<Type> Image<Type>::genericConvolution(Template<Type>& tem, const Policy &policy,
+																							const convolution_tiling &tiling) const
+	{
+		Image<Type> temp(*this, false);
+		convolve(*this, tem, policy, temp, tiling);
+
+		return temp;
+	}
+
+	template<class Type> template<class Policy, int W, int H> Image<Type> Image<Type>::genericConvolution(const FixedTemplate<Type, W, H>& tem, const Policy &policy) const
+	{
+		Image<Type> temp(*this, false);
+		convolve(*this, tem, policy, temp);
+
+		return temp;
+	}
 }	// end namespace
 
 // Include the function definitions in the header if we aren't using a compiled library
@@ -0,0 +1,162 @@
+#ifndef __IMAGEBATCH_CPP__
+#define __IMAGEBATCH_CPP__
+/** @file ImageBatch.cpp
+	Contains function definitions that are declared in ImageBatch.h
+*/
+
+#include "ImageBatch.h"
+#include "ImageTranspose.h"
+
+namespace ImageTL
+{
+	// Constructor
+	template<class Type> ImageBatch<Type>::ImageBatch(int count, int width, int height, batch_layout layout, edge_handling eh)
+		: m_count(count), m_width(width), m_height(height), m_layout(layout), m_edgeHandling(eh)
+	{
+		if(count < 0 || width < 0 || height < 0) {
+			throw ImageException("ImageBatch::ImageBatch [The dimensions cannot be negative]"); }
+		m_data.assign((size_t)count*width*height, Type(0));
+	}
+
+	template<class Type> int ImageBatch<Type>::checked(int index, const char *name) const
+	{
+		if(index < 0 || index >= m_count)
+		{
+			std::stringstream msg_stream;
+			msg_stream<<"ImageBatch::"<<name<<" [There is no image "<<index<<"]";
+			throw ImageException(msg_stream.str());
+		}
+		return index;
+	}
+
+	template<class Type> void ImageBatch<Type>::checkMatch(const ImageBatch<Type> &batch, const char *name) const
+	{
+		if(batch.m_count != m_count || batch.m_width != m_width || batch.m_height != m_height)
+		{
+			std::stringstream msg_stream;
+			msg_stream<<"ImageBatch::"<<name<<" [Unmatched dimensions for operator]";
+			throw ImageException(msg_stream.str());
+		}
+		if(batch.m_layout != m_layout)
+		{
+			std::stringstream msg_stream;
+			msg_stream<<"ImageBatch::"<<name<<" [Unmatched layouts for operator]";
+			throw ImageException(msg_stream.str());
+		}
+	}
+
+	// Images
+	template<class Type> void ImageBatch<Type>::set(int index, const Image<Type> &im)
+	{
+		checked(index, "set");
+		if(im.width() != m_width || im.height() != m_height) {
+			throw ImageException("ImageBatch::set [The image is not the size of the batch]"); }
+
+		const size_t pixels = (size_t)m_width*m_height;
+		const Type *in = im.data();
+		if(m_layout == batch_planar) {
+			std::copy(in, in + pixels, m_data.begin() + pixels*index); }
+		else
+		{
+			Type *out = m_data.data() + index;
+			for(size_t k = 0; k < pixels; k++) {
+				out[k*m_count] = in[k]; }
+		}
+	}
+
+	template<class Type> void ImageBatch<Type>::get(int index, Image<Type> &im) const
+	{
+		checked(index, "get");
+		if(im.width() != m_width || im.height() != m_height) {
+			im.resize(m_width, m_height, false); }
+		im.edgeHandling() = m_edgeHandling;
+
+		const size_t pixels = (size_t)m_width*m_height;
+		Type *out = im.data();
+		if(m_layout == batch_planar) {
+			std::copy(m_data.begin() + pixels*index, m_data.begin() + pixels*(index + 1), out); }
+		else
+		{
+			const Type *in = m_data.data() + index;
+			for(size_t k = 0; k < pixels; k++) {
+				out[k] = in[k*m_count]; }
+		}
+	}
+
+	// A planar batch is a count x pixels matrix and an interleaved batch is
+	// its transpose
+	template<class Type> ImageBatch<Type>& ImageBatch<Type>::setLayout(batch_layout layout)
+	{
+		if(layout == m_layout || m_data.empty())
+		{
+			m_layout = layout;
+			return *this;
+		}
+
+		const int pixels = m_width*m_height;
+		std::vector<Type> moved(m_data.size());
+		if(layout == batch_interleaved) {
+			transposeCopy(m_data.data(), pixels, m_count, moved.data()); }
+		else {
+			transposeCopy(m_data.data(), m_count, pixels, moved.data()); }
+		m_data.swap(moved);
+		m_layout = layout;
+		return *this;
+	}
+
+	// Pixel-wise operators
+	template<class Type> ImageBatch<Type>& ImageBatch<Type>::operator+=(const ImageBatch<Type> &batch)
+		{ checkMatch(batch, "operator+="); pixelwise(batch, [](Type &a, const Type &b) { a += b; }); return *this; }
+	template<class Type> ImageBatch<Type>& ImageBatch<Type>::operator-=(const ImageBatch<Type> &batch)
+		{ checkMatch(batch, "operator-="); pixelwise(batch, [](Type &a, const Type &b) { a -= b; }); return *this; }
+	template<class Type> ImageBatch<Type>& ImageBatch<Type>::operator*=(const ImageBatch<Type> &batch)
+		{ checkMatch(batch, "operator*="); pixelwise(batch, [](Type &a, const Type &b) { a *= b; }); return *this; }
+	template<class Type> ImageBatch<Type>& ImageBatch<Type>::operator/=(const ImageBatch<Type> &batch)
+		{ checkMatch(batch, "operator/="); pixelwise(batch, [](Type &a, const Type &b) { a = (b != Type(0))?Type(a/b):Type(0); }); return *this; }
+
+	template<class Type> ImageBatch<Type>& ImageBatch<Type>::operator+=(const Type &n) { pixelwise([n](Type &a) { a += n; }); return *this; }
+	template<class Type> ImageBatch<Type>& ImageBatch<Type>::operator-=(const Type &n) { pixelwise([n](Type &a) { a -= n; }); return *this; }
+	template<class Type> ImageBatch<Type>& ImageBatch<Type>::operator*=(const Type &n) { pixelwise([n](Type &a) { a *= n; }); return *this; }
+	template<class Type> ImageBatch<Type>& ImageBatch<Type>::operator/=(const Type &n) { pixelwise([n](Type &a) { a /= n; }); return *this; }
+
+	// Reductions
+	template<class Type> std::vector<Type> ImageBatch<Type>::max() const
+	{
+		return reduce(std::numeric_limits<Type>::lowest(), [](const Type &a, const Type &b) { return (b > a)?b:a; });
+	}
+
+	template<class Type> std::vector<Type> ImageBatch<Type>::min() const
+	{
+		return reduce(std::numeric_limits<Type>::max(), [](const Type &a, const Type &b) { return (b < a)?b:a; });
+	}
+
+	template<class Type> std::vector<Type> ImageBatch<Type>::sum() const
+	{
+		return reduce(Type(0), [](const Type &a, const Type &b) { return Type(a + b); });
+	}
+
+	template<class Type> std::vector<Type> ImageBatch<Type>::mean() const
+	{
+		std::vector<Type> s = sum();
+		for(size_t i = 0; i < s.size(); i++) {
+			s[i] = s[i]/(m_width*m_height); }
+		return s;
+	}
+}	//End namespace
+
+// Instantiate with common template types for library compilation
+#ifdef IMAGETL_LIBRARY_COMPILE
+namespace ImageTL
+{
+	template class ImageBatch<char>;
+	template class ImageBatch<unsigned char>;
+	template class ImageBatch<short>;
+	template class ImageBatch<unsigned short>;
+	template class ImageBatch<int>;
+	template class ImageBatch<long>;
+	template class ImageBatch<float>;
+	template class ImageBatch<double>;
+}
+#endif
+
+#endif
\ No newline at end of file
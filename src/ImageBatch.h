@@ -0,0 +1,462 @@
+#ifndef __IMAGEBATCH_H__
+#define __IMAGEBATCH_H__
+/** @file ImageBatch.h
+	Contains the ImageBatch class, a set of images of one size stored in a
+	single allocation and processed together.
+*/
+
+#include <vector>
+#include <mutex>
+#include <cstddef>
+#include "Image.h"
+#include "FixedTemplate.h"
+
+namespace ImageTL
+{
+	/** How the pixels of an ImageBatch are laid out. */
+	enum batch_layout
+	{
+		batch_planar,		///< Each image is stored whole, one after another.
+		batch_interleaved	///< Each pixel is stored for every image, one after another.
+	};
+
+	/** @class batch_kernel
+		Computes <i>n</i> contiguous outputs of a convolution of a batch,
+		where output <i>i</i> reduces <tt>in[i + offsets[t]]</tt> with
+		coefficient <i>t</i> for every tap.  The taps of an output are
+		reduced in registers, so no accumulators are stored.  The linear
+		products of float and double batches have SSE2 versions.
+	*/
+	template<class Type, class Policy> struct batch_kernel
+	{
+		static void row(const Type *in, const ptrdiff_t *offsets, const Type *c, int taps, const Policy &policy, Type *out, size_t n)
+		{
+			for(size_t i = 0; i < n; i++)
+			{
+				typename Policy::accumulator a = policy.init();
+				const Type *s = in + i;
+				for(int t = 0; t < taps; t++) {
+					policy.reduce(a, policy.merge(s[offsets[t]], c[t])); }
+				out[i] = policy.result(a, taps);
+			}
+		}
+	};
+
+#ifdef __SSE2__
+	// Linear products of double batches, four outputs in two registers per block
+	template<> struct batch_kernel<double, MulSumPolicy<double> >
+	{
+		static void row(const double *in, const ptrdiff_t *offsets, const double *c, int taps, const MulSumPolicy<double> &policy, double *out, size_t n)
+		{
+			size_t i = 0;
+			for(; i + 4 <= n; i += 4)
+			{
+				__m128d a0 = _mm_setzero_pd(), a1 = _mm_setzero_pd();
+				for(int t = 0; t < taps; t++)
+				{
+					const double *p = in + i + offsets[t];
+					const __m128d k = _mm_set1_pd(c[t]);
+					a0 = _mm_add_pd(a0, _mm_mul_pd(_mm_loadu_pd(p),     k));
+					a1 = _mm_add_pd(a1, _mm_mul_pd(_mm_loadu_pd(p + 2), k));
+				}
+				_mm_storeu_pd(out + i,     a0);
+				_mm_storeu_pd(out + i + 2, a1);
+			}
+			if(i < n) {
+				batch_kernel<double, ConvolutionPolicy<double, merge_mul<double>, unity_sum<double> > >::row(in + i, offsets, c, taps, policy, out + i, n - i); }
+		}
+	};
+
+	// Linear products of float batches, eight outputs in two registers per block
+	template<> struct batch_kernel<float, MulSumPolicy<float> >
+	{
+		static void row(const float *in, const ptrdiff_t *offsets, const float *c, int taps, const MulSumPolicy<float> &policy, float *out, size_t n)
+		{
+			size_t i = 0;
+			for(; i + 8 <= n; i += 8)
+			{
+				__m128 a0 = _mm_setzero_ps(), a1 = _mm_setzero_ps();
+				for(int t = 0; t < taps; t++)
+				{
+					const float *p = in + i + offsets[t];
+					const __m128 k = _mm_set1_ps(c[t]);
+					a0 = _mm_add_ps(a0, _mm_mul_ps(_mm_loadu_ps(p),     k));
+					a1 = _mm_add_ps(a1, _mm_mul_ps(_mm_loadu_ps(p + 4), k));
+				}
+				_mm_storeu_ps(out + i,     a0);
+				_mm_storeu_ps(out + i + 4, a1);
+			}
+			if(i < n) {
+				batch_kernel<float, ConvolutionPolicy<float, merge_mul<float>, unity_sum<float> > >::row(in + i, offsets, c, taps, policy, out + i, n - i); }
+		}
+	};
+#endif
+
+	/** @class ImageBatch
+		A batch of images of the same size stored contiguously, for workloads
+		of many small images where the cost of each call on an Image, its
+		allocation and its threads, outweighs the work on its pixels.
+		Every operation covers the whole batch in one call.  The pixel-wise
+		operators run over the batch as one flat array and are split between
+		the threads by range.  Convolutions are split between the threads by
+		rows of every image, and when the batch is interleaved the same pixel
+		of every image is contiguous, so the innermost loop of a convolution
+		runs across the batch and is vectorized over it.
+
+		The operators follow those of Image: they are pixel-wise, they do not
+		saturate, and division by a zero pixel gives zero.  Both operands of a
+		binary operator must have the same count, size and layout.
+		@code
+		ImageBatch<float> patches(4096, 64, 64, batch_interleaved);
+		for(int i = 0; i < patches.count(); i++) {
+			patches.set(i, im.subImage(x[i], y[i], 64, 64)); }
+		ImageBatch<float> smooth = patches + gauss;
+		std::vector<float> energy = (smooth*smooth).sum();
+		@endcode
+	*/
+	template<class Type> class ImageBatch
+	{
+	public:
+		/** Creates a batch of <i>count</i> images of <i>width</i> x
+			<i>height</i> pixels, all zero.
+			@throw ImageException If any dimension is negative.
+		*/
+		ImageBatch(int count = 0, int width = 0, int height = 0, batch_layout layout = batch_planar, edge_handling eh = edge_clamp);
+
+		int count()  const { return m_count; }					///< Returns the number of images.
+		int width()  const { return m_width; }					///< Returns the width of each image.
+		int height() const { return m_height; }					///< Returns the height of each image.
+		batch_layout layout() const { return m_layout; }		///< Returns the layout of the pixels.
+		edge_handling& edgeHandling() { return m_edgeHandling; }		///< Returns the edge handling used by convolutions.
+		edge_handling  edgeHandling() const { return m_edgeHandling; }	///< Returns the edge handling used by convolutions.
+
+		Type*       data()       { return m_data.data(); }		///< Returns the pixels of the batch.
+		const Type* data() const { return m_data.data(); }		///< Returns the pixels of the batch.
+
+		/** Returns pixel (<i>x</i>,<i>y</i>) of image <i>index</i>, which
+			must be inside the batch.
+		*/
+		Type&       pixel(int index, int x, int y)       { return m_data[offset(index, x, y)]; }
+		const Type& pixel(int index, int x, int y) const { return m_data[offset(index, x, y)]; }	///< @copydoc pixel(int,int,int)
+
+		/** Copies <i>im</i> into image <i>index</i>.
+			@throw ImageException If there is no such image or <i>im</i> is the
+				wrong size.
+		*/
+		void set(int index, const Image<Type> &im);
+
+		/** Copies image <i>index</i> into <i>im</i>, resizing it if needed.
+			@throw ImageException If there is no such image.
+		*/
+		void get(int index, Image<Type> &im) const;
+
+		/** Rearranges the pixels into <i>layout</i> with a blocked transpose.
+		*/
+		ImageBatch& setLayout(batch_layout layout);
+
+		//Pixel-wise operators
+		ImageBatch& operator+=(const ImageBatch &batch);		///< Pixel-wise addition.
+		ImageBatch& operator-=(const ImageBatch &batch);		///< Pixel-wise subtraction.
+		ImageBatch& operator*=(const ImageBatch &batch);		///< Pixel-wise multiplication.
+		ImageBatch& operator/=(const ImageBatch &batch);		///< Pixel-wise division.
+		ImageBatch& operator+=(const Type &n);					///< Pixel-wise addition.
+		ImageBatch& operator-=(const Type &n);					///< Pixel-wise subtraction.
+		ImageBatch& operator*=(const Type &n);					///< Pixel-wise multiplication.
+		ImageBatch& operator/=(const Type &n);					///< Pixel-wise division.
+
+		ImageBatch operator+(const ImageBatch &batch) const { ImageBatch b(*this); return b += batch; }	///< Pixel-wise addition.
+		ImageBatch operator-(const ImageBatch &batch) const { ImageBatch b(*this); return b -= batch; }	///< Pixel-wise subtraction.
+		ImageBatch operator*(const ImageBatch &batch) const { ImageBatch b(*this); return b *= batch; }	///< Pixel-wise multiplication.
+		ImageBatch operator/(const ImageBatch &batch) const { ImageBatch b(*this); return b /= batch; }	///< Pixel-wise division.
+		ImageBatch operator+(const Type &n) const { ImageBatch b(*this); return b += n; }				///< Pixel-wise addition.
+		ImageBatch operator-(const Type &n) const { ImageBatch b(*this); return b -= n; }				///< Pixel-wise subtraction.
+		ImageBatch operator*(const Type &n) const { ImageBatch b(*this); return b *= n; }				///< Pixel-wise multiplication.
+		ImageBatch operator/(const Type &n) const { ImageBatch b(*this); return b /= n; }				///< Pixel-wise division.
+
+		//Reductions, one value for each image
+		std::vector<Type> max()  const;		///< Returns the largest pixel of each image.
+		std::vector<Type> min()  const;		///< Returns the smallest pixel of each image.
+		std::vector<Type> sum()  const;		///< Returns the sum of the pixels of each image.
+		std::vector<Type> mean() const;		///< Returns the mean of the pixels of each image.
+
+		/** Convolves every image with <i>tem</i> using <i>policy</i>.
+			Border pixels follow edgeHandling() as for convolve().
+			@see convolve(), ConvolutionPolicies.h
+		*/
+		template<class Policy> ImageBatch genericConvolution(Template<Type> &tem, const Policy &policy) const;
+		template<class Policy, int W, int H> ImageBatch genericConvolution(const FixedTemplate<Type, W, H> &tem, const Policy &policy) const	///< @copydoc genericConvolution()
+		{
+			ImageBatch dest(m_count, m_width, m_height, m_layout, m_edgeHandling);
+			convolution(tem.data(), W, H, policy, dest);
+			return dest;
+		}
+
+		ImageBatch operator+(Template<Type> &right) const { return genericConvolution(right, MulSumPolicy<Type>()); }	///< Right linear convolution product.
+		ImageBatch operator|(Template<Type> &right) const { return genericConvolution(right, MulMaxPolicy<Type>()); }	///< Right multiplicative maximum convolution product.
+		ImageBatch operator&(Template<Type> &right) const { return genericConvolution(right, MulMinPolicy<Type>()); }	///< Right multiplicative minimum convolution product.
+		template<int W, int H> ImageBatch operator+(const FixedTemplate<Type, W, H> &right) const	///< Right linear convolution product.
+			{ return genericConvolution(right, MulSumPolicy<Type>()); }
+		template<int W, int H> ImageBatch operator|(const FixedTemplate<Type, W, H> &right) const	///< Right multiplicative maximum convolution product.
+			{ return genericConvolution(right, MulMaxPolicy<Type>()); }
+		template<int W, int H> ImageBatch operator&(const FixedTemplate<Type, W, H> &right) const	///< Right multiplicative minimum convolution product.
+			{ return genericConvolution(right, MulMinPolicy<Type>()); }
+
+	protected:
+		// The images stored whole, and the images stored side by side in each pixel
+		int images() const { return (m_layout == batch_planar)?m_count:1; }
+		int lanes()  const { return (m_layout == batch_planar)?1:m_count; }
+		size_t offset(int index, int x, int y) const
+		{
+			const size_t p = (size_t)m_width*y + x;
+			return (m_layout == batch_planar)?((size_t)m_width*m_height*index + p):(p*m_count + index);
+		}
+		int checked(int index, const char *name) const;
+		void checkMatch(const ImageBatch &batch, const char *name) const;
+
+		// Calls func(a, b) for every pixel a of this batch and b of batch
+		template<class Func> void pixelwise(const ImageBatch &batch, Func func);
+		// Calls func(a) for every pixel
+		template<class Func> void pixelwise(Func func);
+		// Folds the pixels of each image with func, from init
+		template<class Func> std::vector<Type> reduce(Type init, Func func) const;
+		// Convolves with coefficients, or with tem at each pixel if coeff is NULL
+		template<class Policy> void convolution(const Type *coeff, int tWidth, int tHeight, const Policy &policy,
+												ImageBatch &dest, Template<Type> *tem = NULL) const;
+
+		int m_count;
+		int m_width;
+		int m_height;
+		batch_layout m_layout;
+		edge_handling m_edgeHandling;
+		std::vector<Type> m_data;
+	};
+
+	template<class Type> template<class Func> void ImageBatch<Type>::pixelwise(const ImageBatch<Type> &batch, Func func)
+	{
+		Type *a = m_data.data();
+		const Type *b = batch.m_data.data();
+		parallelFor(0, (int)m_data.size(), [&](int first, int last)
+		{
+			for(int i = first; i < last; i++) {
+				func(a[i], b[i]); }
+		}, 65536);
+	}
+
+	template<class Type> template<class Func> void ImageBatch<Type>::pixelwise(Func func)
+	{
+		Type *a = m_data.data();
+		parallelFor(0, (int)m_data.size(), [&](int first, int last)
+		{
+			for(int i = first; i < last; i++) {
+				func(a[i]); }
+		}, 65536);
+	}
+
+	template<class Type> template<class Func> std::vector<Type> ImageBatch<Type>::reduce(Type init, Func func) const
+	{
+		std::vector<Type> result(m_count, init);
+		const size_t pixels = (size_t)m_width*m_height;
+		const Type *in = m_data.data();
+		if(m_layout == batch_planar)
+		{
+			parallelFor(0, m_count, [&](int first, int last)
+			{
+				for(int i = first; i < last; i++)
+				{
+					Type acc = init;
+					const Type *p = in + pixels*i;
+					for(size_t k = 0; k < pixels; k++) {
+						acc = func(acc, p[k]); }
+					result[i] = acc;
+				}
+			}, std::max(1, (int)(65536/(pixels + 1))));
+			return result;
+		}
+
+		// Interleaved pixels are folded a lane per image, and the bands of
+		// pixels that the threads folded are combined once they finish
+		std::mutex lock;
+		parallelFor(0, (int)pixels, [&](int first, int last)
+		{
+			std::vector<Type> acc(m_count, init);
+			for(int k = first; k < last; k++)
+			{
+				const Type *p = in + (size_t)m_count*k;
+				for(int i = 0; i < m_count; i++) {
+					acc[i] = func(acc[i], p[i]); }
+			}
+			std::lock_guard<std::mutex> guard(lock);
+			for(int i = 0; i < m_count; i++) {
+				result[i] = func(result[i], acc[i]); }
+		}, std::max(1, 65536/std::max(1, m_count)));
+		return result;
+	}
+
+	template<class Type> template<class Policy> ImageBatch<Type> ImageBatch<Type>::genericConvolution(Template<Type> &tem, const Policy &policy) const
+	{
+		ImageBatch<Type> dest(m_count, m_width, m_height, m_layout, m_edgeHandling);
+		convolution(tem.coefficients(), tem.width(), tem.height(), policy, dest, &tem);
+		return dest;
+	}
+
+	template<class Type> template<class Policy> void ImageBatch<Type>::convolution(const Type *coeff, int tWidth, int tHeight, const Policy &policy,
+																				   ImageBatch<Type> &dest, Template<Type> *tem) const
+	{
+		typedef typename Policy::accumulator accumulator;
+
+		const int width = m_width, height = m_height, lanes = this->lanes();
+		const int negX = (tWidth - 1)/2, posX = tWidth/2;
+		const int negY = (tHeight - 1)/2, posY = tHeight/2;
+		const size_t plane = (size_t)width*height*lanes;
+		if(m_data.empty()) {
+			return; }
+
+		const int x0 = (negX < width)?negX:width;
+		const int x1 = (width - posX > x0)?(width - posX):x0;
+		const int y0 = (negY < height)?negY:height;
+		const int y1 = (height - posY > y0)?(height - posY):y0;
+		const int taps = tWidth*tHeight;
+		const edge_handling eh = m_edgeHandling;
+
+		// The lanes of a border pixel are worked through in chunks, so the
+		// accumulators of a chunk stay in the first level cache however large
+		// the batch is
+		const int chunk = 512;
+
+		// Computes every lane of one pixel with bounds checked taps
+		auto border = [&](const Type *in, int x, int y, Type *out, accumulator *a)
+		{
+			for(int l0 = 0; l0 < lanes; l0 += chunk)
+			{
+				const int m = std::min(chunk, lanes - l0);
+				int count = 0;
+				for(int i = 0; i < m; i++) {
+					a[i] = policy.init(); }
+				for(int ty = 0; ty < tHeight; ty++)
+				{
+					for(int tx = 0; tx < tWidth; tx++)
+					{
+						const int px = x - negX + tx, py = y - negY + ty;
+						const Type c = coeff?coeff[tx + tWidth*ty]:(*tem)(px, py);
+						int sx = px, sy = py;
+						if(sx < 0 || sy < 0 || sx >= width || sy >= height)
+						{
+							if(eh == edge_skip) {
+								continue; }
+							else if(eh == edge_zero)
+							{
+								for(int i = 0; i < m; i++) {
+									policy.reduce(a[i], policy.merge(Type(0), c)); }
+								count++;
+								continue;
+							}
+							sx = (sx < 0)?0:((sx >= width)?(width - 1):sx);
+							sy = (sy < 0)?0:((sy >= height)?(height - 1):sy);
+						}
+						const Type *s = in + ((size_t)width*sy + sx)*lanes + l0;
+						for(int i = 0; i < m; i++) {
+							policy.reduce(a[i], policy.merge(s[i], c)); }
+						count++;
+					}
+				}
+				for(int i = 0; i < m; i++) {
+					out[l0 + i] = policy.result(a[i], count); }
+			}
+		};
+
+		if(coeff == NULL)
+		{
+			// The template has to be centered on each pixel, so this is serial
+			std::vector<accumulator> acc(chunk);
+			for(int i = 0; i < images(); i++) {
+				for(int y = 0; y < height; y++) {
+					for(int x = 0; x < width; x++)
+					{
+						tem->setCenter(x, y);
+						border(m_data.data() + plane*i, x, y, dest.m_data.data() + plane*i + ((size_t)width*y + x)*lanes, &acc[0]);
+					} } }
+			return;
+		}
+
+		// Planar images whose border is clamped or zero are copied with a
+		// padded border into a buffer, so every row of the image is interior
+		if(lanes == 1 && eh != edge_skip)
+		{
+			const int padWidth = width + tWidth - 1, padHeight = height + tHeight - 1;
+			std::vector<ptrdiff_t> offsets(taps);
+			for(int t = 0; t < taps; t++) {
+				offsets[t] = (ptrdiff_t)padWidth*(t/tWidth) + t%tWidth; }
+
+			parallelFor(0, images(), [&](int first, int last)
+			{
+				std::vector<Type> padded((size_t)padWidth*padHeight);
+				for(int image = first; image < last; image++)
+				{
+					const Type *in = m_data.data() + plane*image;
+					for(int py = 0; py < padHeight; py++)
+					{
+						Type *p = &padded[(size_t)padWidth*py];
+						const int sy = py - negY;
+						if(eh == edge_zero && (sy < 0 || sy >= height))
+						{
+							std::fill(p, p + padWidth, Type(0));
+							continue;
+						}
+						const Type *row = in + (size_t)width*((sy < 0)?0:((sy >= height)?(height - 1):sy));
+						std::fill(p, p + negX, (eh == edge_zero)?Type(0):row[0]);
+						std::copy(row, row + width, p + negX);
+						std::fill(p + negX + width, p + padWidth, (eh == edge_zero)?Type(0):row[width - 1]);
+					}
+
+					Type *out = dest.m_data.data() + plane*image;
+					for(int y = 0; y < height; y++) {
+						batch_kernel<Type, Policy>::row(&padded[(size_t)padWidth*y], &offsets[0], coeff, taps, policy, out + (size_t)width*y, width); }
+				}
+			}, std::max(1, (int)(16384/((size_t)width*height*taps + 1))));
+			return;
+		}
+
+		// Otherwise every row of every image is a unit of work.  The interior of a row
+		// is one contiguous span of pixels times lanes, which the kernel works
+		// through a block of outputs at a time, across the pixels and the
+		// batch alike.
+		std::vector<ptrdiff_t> offsets(taps);
+		for(int t = 0; t < taps; t++) {
+			offsets[t] = ((ptrdiff_t)width*(t/tWidth) + t%tWidth)*lanes; }
+		const int rows = images()*height;
+		const int grain = std::max(1, (int)(16384/((size_t)width*lanes*taps + 1)));
+		parallelFor(0, rows, [&](int first, int last)
+		{
+			std::vector<accumulator> acc(chunk);
+			accumulator *a = &acc[0];
+			for(int r = first; r < last; r++)
+			{
+				const int image = r/height, y = r%height;
+				const Type *in = m_data.data() + plane*image;
+				Type *outRow = dest.m_data.data() + plane*image + (size_t)width*lanes*y;
+
+				if(y < y0 || y >= y1 || x1 <= x0)
+				{
+					for(int x = 0; x < width; x++) {
+						border(in, x, y, outRow + (size_t)x*lanes, a); }
+					continue;
+				}
+
+				const Type *span = in + ((size_t)width*(y - negY) + (x0 - negX))*lanes;
+				batch_kernel<Type, Policy>::row(span, &offsets[0], coeff, taps, policy, outRow + (size_t)x0*lanes, (size_t)(x1 - x0)*lanes);
+
+				for(int x = 0; x < x0; x++) {
+					border(in, x, y, outRow + (size_t)x*lanes, a); }
+				for(int x = x1; x < width; x++) {
+					border(in, x, y, outRow + (size_t)x*lanes, a); }
+			}
+		}, grain);
+	}
+}	// end namespace
+
+// Include the function definitions in the header if we aren't using a compiled library
+#ifdef IMAGETL_NO_LIBRARY
+#include "ImageBatch.cpp"
+#endif
+
+#endif
\ No newline at end of file
@@ -0,0 +1,360 @@
+#ifndef __IMAGECONVERT_H__
+#define __IMAGECONVERT_H__
+/** @file ImageConvert.h
+	Contains convert(), which converts an image from one element type to
+	another with an optional linear scaling, and the vectorised kernels it
+	uses for the common conversions between float and 8, 16 and 32 bit
+	integer images.
+*/
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+#include "Image.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace ImageTL
+{
+	/** How convert() rounds a real value to an integer type. */
+	enum convert_rounding
+	{
+		round_nearest,		///< Rounds to the nearest integer, with ties to even.
+		round_truncate,		///< Rounds toward zero.
+		round_floor,		///< Rounds toward negative infinity.
+		round_ceil			///< Rounds toward positive infinity.
+	};
+
+	/** @class convert_work
+		The type that convert() scales pixels in.
+		Conversions between float and any type other than double are scaled
+		in float, which lets them be vectorised four pixels to a register, and
+		every other conversion is scaled in double.
+	*/
+	template<class Dst, class Src> struct convert_work
+	{
+		typedef typename std::conditional<(std::is_same<Src, float>::value || std::is_same<Dst, float>::value) &&
+										  !std::is_same<Src, double>::value && !std::is_same<Dst, double>::value, float, double>::type type;
+	};
+
+	// Rounds a real value to an integer value of the same type
+	template<class Work> inline Work convert_round(Work value, convert_rounding rounding)
+	{
+		switch(rounding)
+		{
+		case round_truncate: return std::trunc(value);
+		case round_floor:    return std::floor(value);
+		case round_ceil:     return std::ceil(value);
+		default:             return std::nearbyint(value);
+		}
+	}
+
+	// Converts a rounded real value to an integer type, clamping it or
+	// letting it wrap, where NaN becomes zero
+	template<class Dst, class Work> inline Dst convert_integer(Work value, bool saturate)
+	{
+		typedef std::numeric_limits<Dst> limits;
+		if(value != value) {
+			return Dst(0); }
+		if(saturate)
+		{
+			if(value <= (Work)limits::min()) {
+				return limits::min(); }
+			if(value >= (Work)limits::max()) {
+				return limits::max(); }
+			return Dst((long long)value);
+		}
+		if(value <= (Work)std::numeric_limits<long long>::min()) {
+			return Dst(std::numeric_limits<long long>::min()); }
+		if(value >= (Work)std::numeric_limits<long long>::max()) {
+			return Dst(std::numeric_limits<long long>::max()); }
+		return Dst((long long)value);
+	}
+
+	/** @class convert_pixel
+		Converts one pixel.  The specializations cover the four combinations
+		of integer and real source and destination types.
+	*/
+	template<class Dst, class Src, bool DstInteger = std::numeric_limits<Dst>::is_integer,
+			 bool SrcInteger = std::numeric_limits<Src>::is_integer> struct convert_pixel
+	{
+		typedef typename convert_work<Dst, Src>::type work;
+
+		// Real to real
+		static Dst plain(const Src &n, convert_rounding, bool) { return Dst(n); }
+		static Dst scaled(const Src &n, work scale, work offset, convert_rounding, bool) { return Dst(work(n)*scale + offset); }
+	};
+
+	template<class Dst, class Src> struct convert_pixel<Dst, Src, false, true>
+	{
+		typedef typename convert_work<Dst, Src>::type work;
+
+		// Integer to real
+		static Dst plain(const Src &n, convert_rounding, bool) { return Dst(n); }
+		static Dst scaled(const Src &n, work scale, work offset, convert_rounding, bool) { return Dst(work(n)*scale + offset); }
+	};
+
+	template<class Dst, class Src> struct convert_pixel<Dst, Src, true, false>
+	{
+		typedef typename convert_work<Dst, Src>::type work;
+
+		// Real to integer
+		static Dst plain(const Src &n, convert_rounding rounding, bool saturate) { return convert_integer<Dst>(convert_round(work(n), rounding), saturate); }
+		static Dst scaled(const Src &n, work scale, work offset, convert_rounding rounding, bool saturate)
+			{ return convert_integer<Dst>(convert_round(work(n)*scale + offset, rounding), saturate); }
+	};
+
+	template<class Dst, class Src> struct convert_pixel<Dst, Src, true, true>
+	{
+		typedef typename convert_work<Dst, Src>::type work;
+
+		// Integer to integer, where an unscaled conversion never rounds
+		static Dst plain(const Src &n, convert_rounding, bool saturate) { return saturate?saturate_cast<Dst>(n):Dst(n); }
+		static Dst scaled(const Src &n, work scale, work offset, convert_rounding rounding, bool saturate)
+			{ return convert_integer<Dst>(convert_round(work(n)*scale + offset, rounding), saturate); }
+	};
+
+	/** @class convert_simd
+		Converts the first pixels of a span with SSE2, returning the number of
+		pixels converted.  The general version converts none.
+	*/
+	template<class Dst, class Src> struct convert_simd
+	{
+		static size_t run(const Src *, Dst *, size_t, float, float, convert_rounding, bool) { return 0; }
+	};
+
+#ifdef __SSE2__
+	// The 16 bit and 8 bit views of char, which is signed wherever SSE2 is
+	// available unless the compiler is told otherwise
+	template<class Type> struct convert_lane_type { typedef Type type; };
+	template<> struct convert_lane_type<char>     { typedef std::conditional<std::numeric_limits<char>::is_signed, signed char, unsigned char>::type type; };
+
+	// Stores 8 saturated 32 bit lanes as the integer type
+	template<class Type> struct convert_store;
+	template<> struct convert_store<int>
+	{
+		static void run(int *p, __m128i lo, __m128i hi) { _mm_storeu_si128((__m128i*)p, lo); _mm_storeu_si128((__m128i*)(p + 4), hi); }
+	};
+	template<> struct convert_store<short>
+	{
+		static void run(short *p, __m128i lo, __m128i hi) { _mm_storeu_si128((__m128i*)p, _mm_packs_epi32(lo, hi)); }
+	};
+	template<> struct convert_store<unsigned short>
+	{
+		// There is no unsigned 32 to 16 bit pack, so the lanes are biased
+		// into the signed range and back
+		static void run(unsigned short *p, __m128i lo, __m128i hi)
+		{
+			const __m128i bias32 = _mm_set1_epi32(32768), bias16 = _mm_set1_epi16(-32768);
+			__m128i w = _mm_packs_epi32(_mm_sub_epi32(lo, bias32), _mm_sub_epi32(hi, bias32));
+			_mm_storeu_si128((__m128i*)p, _mm_xor_si128(w, bias16));
+		}
+	};
+	template<> struct convert_store<signed char>
+	{
+		static void run(signed char *p, __m128i lo, __m128i hi) { __m128i w = _mm_packs_epi32(lo, hi); _mm_storel_epi64((__m128i*)p, _mm_packs_epi16(w, w)); }
+	};
+	template<> struct convert_store<unsigned char>
+	{
+		static void run(unsigned char *p, __m128i lo, __m128i hi) { __m128i w = _mm_packs_epi32(lo, hi); _mm_storel_epi64((__m128i*)p, _mm_packus_epi16(w, w)); }
+	};
+
+	// Loads 8 pixels of an integer type as 32 bit lanes
+	template<class Type> struct convert_load;
+	template<> struct convert_load<int>
+	{
+		static void run(const int *p, __m128i &lo, __m128i &hi) { lo = _mm_loadu_si128((const __m128i*)p); hi = _mm_loadu_si128((const __m128i*)(p + 4)); }
+	};
+	template<> struct convert_load<short>
+	{
+		static void run(const short *p, __m128i &lo, __m128i &hi)
+			{ __m128i v = _mm_loadu_si128((const __m128i*)p); lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16); hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16); }
+	};
+	template<> struct convert_load<unsigned short>
+	{
+		static void run(const unsigned short *p, __m128i &lo, __m128i &hi)
+			{ __m128i v = _mm_loadu_si128((const __m128i*)p), z = _mm_setzero_si128(); lo = _mm_unpacklo_epi16(v, z); hi = _mm_unpackhi_epi16(v, z); }
+	};
+	template<> struct convert_load<signed char>
+	{
+		static void run(const signed char *p, __m128i &lo, __m128i &hi)
+		{
+			__m128i v = _mm_loadl_epi64((const __m128i*)p);
+			__m128i w = _mm_srai_epi16(_mm_unpacklo_epi8(v, v), 8);
+			lo = _mm_srai_epi32(_mm_unpacklo_epi16(w, w), 16);
+			hi = _mm_srai_epi32(_mm_unpackhi_epi16(w, w), 16);
+		}
+	};
+	template<> struct convert_load<unsigned char>
+	{
+		static void run(const unsigned char *p, __m128i &lo, __m128i &hi)
+		{
+			__m128i z = _mm_setzero_si128(), w = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)p), z);
+			lo = _mm_unpacklo_epi16(w, z);
+			hi = _mm_unpackhi_epi16(w, z);
+		}
+	};
+
+	// Rounds four floats to 32 bit integers.  The values must already be
+	// clamped to [-2^31, 2^31], where 2^31 becomes INT_MAX.
+	inline __m128i convert_round_ps(__m128 v, convert_rounding rounding)
+	{
+		__m128i r;
+		if(rounding == round_nearest) {
+			r = _mm_cvtps_epi32(v); }
+		else
+		{
+			// Truncate, then step the lanes that were rounded the wrong way
+			r = _mm_cvttps_epi32(v);
+			__m128 t = _mm_cvtepi32_ps(r);
+			if(rounding == round_floor) {
+				r = _mm_add_epi32(r, _mm_castps_si128(_mm_cmplt_ps(v, t))); }
+			else if(rounding == round_ceil) {
+				r = _mm_sub_epi32(r, _mm_castps_si128(_mm_cmpgt_ps(v, t))); }
+		}
+		// Lanes at 2^31 overflowed, so they are replaced with INT_MAX
+		__m128i over = _mm_castps_si128(_mm_cmpge_ps(v, _mm_set1_ps(2147483648.f)));
+		return _mm_or_si128(_mm_andnot_si128(over, r), _mm_and_si128(over, _mm_set1_epi32(0x7FFFFFFF)));
+	}
+
+	// Float to a saturated integer type, eight pixels per block
+	template<class Dst> struct convert_simd_from_float
+	{
+		static size_t run(const float *src, Dst *dest, size_t n, float scale, float offset, convert_rounding rounding, bool saturate)
+		{
+			typedef typename convert_lane_type<Dst>::type lane;
+			if(!saturate) {
+				return 0; }
+
+			const __m128 s = _mm_set1_ps(scale), o = _mm_set1_ps(offset);
+			const __m128 low  = _mm_set1_ps(std::is_same<lane, int>::value?-2147483648.f:(float)std::numeric_limits<lane>::min());
+			const __m128 high = _mm_set1_ps(std::is_same<lane, int>::value?2147483648.f:(float)std::numeric_limits<lane>::max());
+			size_t i = 0;
+			for(; i + 8 <= n; i += 8)
+			{
+				__m128 a = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(src + i), s), o);
+				__m128 b = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(src + i + 4), s), o);
+
+				// NaN becomes zero, then clamp to the range of the type
+				a = _mm_and_ps(a, _mm_cmpord_ps(a, a));
+				b = _mm_and_ps(b, _mm_cmpord_ps(b, b));
+				a = _mm_min_ps(_mm_max_ps(a, low), high);
+				b = _mm_min_ps(_mm_max_ps(b, low), high);
+				convert_store<lane>::run((lane*)(dest + i), convert_round_ps(a, rounding), convert_round_ps(b, rounding));
+			}
+			return i;
+		}
+	};
+
+	// An integer type to float, eight pixels per block
+	template<class Src> struct convert_simd_to_float
+	{
+		static size_t run(const Src *src, float *dest, size_t n, float scale, float offset, convert_rounding, bool)
+		{
+			typedef typename convert_lane_type<Src>::type lane;
+			const __m128 s = _mm_set1_ps(scale), o = _mm_set1_ps(offset);
+			size_t i = 0;
+			for(; i + 8 <= n; i += 8)
+			{
+				__m128i lo, hi;
+				convert_load<lane>::run((const lane*)(src + i), lo, hi);
+				_mm_storeu_ps(dest + i,     _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(lo), s), o));
+				_mm_storeu_ps(dest + i + 4, _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(hi), s), o));
+			}
+			return i;
+		}
+	};
+
+	template<> struct convert_simd<char, float>           : public convert_simd_from_float<char>           {};
+	template<> struct convert_simd<unsigned char, float>  : public convert_simd_from_float<unsigned char>  {};
+	template<> struct convert_simd<short, float>          : public convert_simd_from_float<short>          {};
+	template<> struct convert_simd<unsigned short, float> : public convert_simd_from_float<unsigned short> {};
+	template<> struct convert_simd<int, float>            : public convert_simd_from_float<int>            {};
+
+	template<> struct convert_simd<float, char>           : public convert_simd_to_float<char>           {};
+	template<> struct convert_simd<float, unsigned char>  : public convert_simd_to_float<unsigned char>  {};
+	template<> struct convert_simd<float, short>          : public convert_simd_to_float<short>          {};
+	template<> struct convert_simd<float, unsigned short> : public convert_simd_to_float<unsigned short> {};
+	template<> struct convert_simd<float, int>            : public convert_simd_to_float<int>            {};
+#endif
+
+	/** Converts <i>src</i> to the element type of <i>dest</i>, storing
+		<tt>src*scale + offset</tt> at each pixel.
+		<i>dest</i> is resized to the dimensions of <i>src</i> if needed and
+		takes its edge handling, so it can be a preallocated image that is
+		reused for every frame.
+		@param src The image to convert.
+		@param dest The converted image.
+		@param scale The factor each pixel is multiplied by.
+		@param offset The value added to each pixel after scaling.
+		@param rounding How real values are rounded to an integer type.
+		@param saturate If true, values outside the range of an integer type
+			are clamped to it.  If false, they wrap like a cast.  NaN always
+			becomes zero.
+
+		The scaling is done in the type given by convert_work.  An unscaled
+		conversion between integer types is exact, and an unscaled
+		conversion between identical types is a copy.  <i>src</i> and
+		<i>dest</i> may be the same image, in which case each pixel is scaled
+		in place.  With SSE2, float is
+		converted to saturated 8, 16 and 32 bit integers with cvtps2dq and
+		packs/packus, and those integers are converted to float with
+		cvtdq2ps, eight pixels at a time.  Rows are converted in parallel.
+	*/
+	template<class Dst, class Src> void convert(const Image<Src> &src, Image<Dst> &dest, double scale = 1., double offset = 0.,
+												convert_rounding rounding = round_nearest, bool saturate = true)
+	{
+		typedef typename convert_work<Dst, Src>::type work;
+		typedef convert_pixel<Dst, Src> pixel;
+
+		if(dest.width() != src.width() || dest.height() != src.height()) {
+			dest.resize(src.width(), src.height(), false); }
+		dest.edgeHandling() = src.edgeHandling();
+
+		const bool identity = (scale == 1. && offset == 0.);
+		const size_t width = src.width();
+		if(identity && std::is_same<Dst, Src>::value)
+		{
+			if(width*src.height() > 0 && (const void*)&src != (const void*)&dest) {
+				memcpy((void*)dest.data(), (const void*)src.data(), width*src.height()*sizeof(Src)); }
+			return;
+		}
+
+		const work s = work(scale), o = work(offset);
+		Dst *const output = dest.data();
+		parallelFor(0, src.height(), [&](int first, int last)
+		{
+			const Src *in = src.data() + width*first;
+			Dst *out = output + width*first;
+			const size_t n = width*(last - first);
+
+			size_t i = convert_simd<Dst, Src>::run(in, out, n, float(s), float(o), rounding, saturate);
+			if(identity) {
+				for(; i < n; i++) {
+					out[i] = pixel::plain(in[i], rounding, saturate); } }
+			else {
+				for(; i < n; i++) {
+					out[i] = pixel::scaled(in[i], s, o, rounding, saturate); } }
+		}, 64);
+	}
+
+	/** Returns <i>src</i> converted to the element type <i>Dst</i>.
+		@code
+		Image<float> normalized = convert<float>(camera, 1./255.);
+		Image<unsigned char> display = convert<unsigned char>(normalized, 255.);
+		@endcode
+		@see convert(const Image<Src>&, Image<Dst>&, double, double, convert_rounding, bool)
+	*/
+	template<class Dst, class Src> Image<Dst> convert(const Image<Src> &src, double scale = 1., double offset = 0.,
+													  convert_rounding rounding = round_nearest, bool saturate = true)
+	{
+		Image<Dst> dest(src.width(), src.height(), src.edgeHandling());
+		convert(src, dest, scale, offset, rounding, saturate);
+		return dest;
+	}
+}	// end namespace
+
+#endif
\ No newline at end of file
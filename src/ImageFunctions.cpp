@@ -24,7 +24,7 @@ namespace ImageTL
 	}
 
 	// Algorithms
-	void GaussianTemplates(ConstantTemplate<double>* &x, ConstantTemplate<double>* &y, double sigma, int gaussWidth)
+	std::vector<double> GaussianKernel(double sigma, int gaussWidth)
 	{
 		if(gaussWidth <= 0) {
 			gaussWidth = (int)(sigma*6); }
@@ -36,21 +36,56 @@ namespace ImageTL
 			gaussWidth++; }
 
 		int bound = (gaussWidth-1)/2;
-		double *gauss = new double[gaussWidth];
+		std::vector<double> gauss(gaussWidth);
 		double c = 1./(sqrt(2*PI)*sigma), sum = 0;
 		for(int i = -bound; i<=bound; i++)
 		{
 			gauss[i + bound] = c*exp((-i*i)/(2*sigma*sigma));
 			sum += gauss[i + bound];
 		}
-		ConstantTemplate<double>* gaussian_x = new ConstantTemplate<double>(gauss, gaussWidth, 1);
-		ConstantTemplate<double>* gaussian_y = new ConstantTemplate<double>(gauss, 1, gaussWidth);
-		delete[] gauss;
-		(*gaussian_x) /= sum;
-		(*gaussian_x) /= sum;
-
-		x = gaussian_x;
-		y = gaussian_y;
+		for(int i = 0; i < gaussWidth; i++) {
+			gauss[i] /= sum; }
+		return gauss;
+	}
+
+	void GaussianTemplates(ConstantTemplate<double>* &x, ConstantTemplate<double>* &y, double sigma, int gaussWidth)
+	{
+		std::vector<double> gauss = GaussianKernel(sigma, gaussWidth);
+		x = new ConstantTemplate<double>(&gauss[0], (int)gauss.size(), 1);
+		y = new ConstantTemplate<double>(&gauss[0], 1, (int)gauss.size());
+	}
+
+	void StructureTensor(const Image<double>& input, Image<double>& J_11, Image<double>& J_12, Image<double>& J_22, double sigma, double rho)
+	{
+		// *** Smooth the input
+		Image<double> input_gauss;
+		if(sigma > 0)
+		{
+			ConstantTemplate<double> *gaussian_x, *gaussian_y;
+			GaussianTemplates(gaussian_x, gaussian_y, sigma);
+			input_gauss = (input + *gaussian_x) + *gaussian_y;
+			delete gaussian_x;
+			delete gaussian_y;
+		}
+		else {
+			input_gauss = input; }
+
+		// *** Get the products of the x and y derivatives in one sweep
+		const FixedTemplate<double, 3, 3> derivs[2] = {fixed_deriv_x, fixed_deriv_y};
+		Image<double>* const products[3] = {&J_11, &J_12, &J_22};
+		convolveFused(input_gauss, derivs, products, fused_tensor_products());
+
+		// *** Smooth the products
+		if(rho > 0)
+		{
+			ConstantTemplate<double> *gaussian_x, *gaussian_y;
+			GaussianTemplates(gaussian_x, gaussian_y, rho);
+			J_11 = (J_11 + *gaussian_x) + *gaussian_y;
+			J_12 = (J_12 + *gaussian_x) + *gaussian_y;
+			J_22 = (J_22 + *gaussian_x) + *gaussian_y;
+			delete gaussian_x;
+			delete gaussian_y;
+		}
 	}
 
 	void MarrHildrethEdges(Image<double>& input, double sigma, int debug)
@@ -77,16 +112,14 @@ namespace ImageTL
 			}
 		}
 
-		ConstantTemplate<double> Laplacian(laplacian, laplacian_w, laplacian_h);
-		ConstantTemplate<double> Moore(moore, moore_w, moore_h);
+		input = input + fixed_laplacian;
 
-		input = input + Laplacian;
+		// The zero crossings are found on bit masks
+		BinaryImage c1 = BinaryImage::compare(input, compare_greater, 0.);
+		BinaryImage d1 = c1.dilate(fixed_moore) & ~c1;
 
-		PgmImage<double> c1 = (input>0);
-		PgmImage<double> d1 = (c1 | Moore) & (1. - c1);
-
-		PgmImage<double> c2 = (input<0);
-		PgmImage<double> d2 = c2 & ((1. - c2) | Moore);
+		BinaryImage c2 = BinaryImage::compare(input, compare_less, 0.);
+		BinaryImage d2 = c2 & (~c2).dilate(fixed_moore);
 
 		if(debug >= 1)
 		{
@@ -94,16 +127,16 @@ namespace ImageTL
 			output.depthHandling() = lower_abs | upper_scale | upper2_stretch;
 			output.write("debug_output\\laplacian.pgm", 255);
 
-			output = d1;
+			output = d1.toImage<double>();
 			output.depthHandling() = lower_translate | upper_scale | upper2_stretch;
 			output.write("debug_output\\d1.pgm", 1);
 
-			output = d2;
+			output = d2.toImage<double>();
 			output.depthHandling() = lower_translate | upper_scale | upper2_stretch;
 			output.write("debug_output\\d2.pgm", 1);
 		}
 
-		input = d1 & d2;
+		input = (d1 & d2).toImage<double>();
 	}
 
 	void CoherenceEnhancingDiffusion(Image<double>& input, int    steps, double stepSize,
@@ -116,29 +149,14 @@ namespace ImageTL
 			// This is used to store the debug choice
 			char option = 0;
 
-			// *** Make derivative templates
-			const double deriv_x[9] = { -3, 0,  3,
-									   -10, 0, 10,
-									    -3, 0,  3};
-			ConstantTemplate<double> dx_t(deriv_x, 3, 3);
-			dx_t /= 32.;
-
-			const double deriv_y[9] = {3,  10,  3,
-									   0,   0,  0,
-									  -3, -10, -3};
-			ConstantTemplate<double> dy_t(deriv_y, 3, 3);
-			dy_t /= 32.;
-
-			// Calculate the gaussian template for sigma (used for smoothing the input image)
-			ConstantTemplate<double> *gaussian_sigma_x, *gaussian_sigma_y;
-			GaussianTemplates(gaussian_sigma_x, gaussian_sigma_y, sigma);
-
-			// Calculate the gaussian template for rho (used for smoothing J)
-			ConstantTemplate<double> *gaussian_rho_x, *gaussian_rho_y;
-			GaussianTemplates(gaussian_rho_x, gaussian_rho_y, rho);
+			// *** Derivative templates
+			const FixedTemplate<double, 3, 3> &dx_t = fixed_deriv_x;
+			const FixedTemplate<double, 3, 3> &dy_t = fixed_deriv_y;
+			const FixedTemplate<double, 3, 3> derivs[2] = {dx_t, dy_t};
 
 			// Declare images needed for the loop
-			Image<double> input_gauss, Ux, Uy;
+			Image<double> Ux, Uy;
+			Image<double>* const gradient[2] = {&Ux, &Uy};
 			Image<double> J_11, J_12, J_22;
 			Image<double> b, discrim, eigenvalue1(input, false), eigenvalue2(input, false);
 			Image<double> eigenvector1_x, eigenvector1_y, eigenvector2_x, eigenvector2_y, norm;
@@ -150,29 +168,8 @@ namespace ImageTL
 				if(debug >= 1) {
 					std::cout<<std::endl<<i<<std::endl<<"----"; }
 
-				input_gauss = (input + *gaussian_sigma_x) + *gaussian_sigma_y;
-
-				// *** Get the x and y derivatives of the input
-				Ux = input_gauss + dx_t;
-				Uy = input_gauss + dy_t;
-
-				// *** Calculate J(1,1)
-				J_11 = Ux * Ux;
-				J_11 = (J_11 + *gaussian_rho_x) + *gaussian_rho_y;
-
-				// *** Calculate J(1,2)
-				J_12 = Ux * Uy;
-				J_12 = (J_12 + *gaussian_rho_x) + *gaussian_rho_y;
-
-				// *** Calculate J(2,2)
-				J_22 = Uy * Uy;
-				J_22 = (J_22 + *gaussian_rho_x) + *gaussian_rho_y;
-
-				// Done with the gaussians
-				delete gaussian_sigma_x;
-				delete gaussian_sigma_y;
-				delete gaussian_rho_x;
-				delete gaussian_rho_y;
+				// *** Calculate the structure tensor J
+				StructureTensor(input, J_11, J_12, J_22, sigma, rho);
 
 				// *** Calculate the eigenvalues of J, (mu1 >= mu2)
 				b = J_11 + J_22;
@@ -242,8 +239,7 @@ namespace ImageTL
 					   eigenvector2_y * eigenvector2_y * lambda2;
 
 				// *** Calculate the main diffusion filter image
-				Ux = input + dx_t;
-				Uy = input + dy_t;
+				convolveFused(input, derivs, gradient);
 
 				filter = ((D_11*Ux + D_12*Uy) + dx_t) + ((D_12*Ux + D_22*Uy) + dy_t);
 
@@ -5,6 +5,14 @@
 
 #include "Image.h"
 #include "PgmImage.h"
+#include "LazyImage.h"
+#include "BinaryImage.h"
+#include "ImageRoi.h"
+#include "FixedPointTemplate.h"
+#include "ImageConvert.h"
+#include "ImageRemap.h"
+#include "DistanceTransform.h"
+#include "ConnectedComponents.h"
 
 #define PI 3.141592653589793238462643383279502884197169399375105820974944592
 
@@ -27,11 +35,20 @@ namespace ImageTL
 
 	// ***** Algorithms *****
 	// **********************
+	// Returns the normalised 1D Gaussian that GaussianTemplates() is made from
+	// If gaussWidth is <=0 the width is calculated based on sigma
+	std::vector<double> GaussianKernel(double sigma, int gaussWidth = 0);
+
 	// Creates the x and y component templates used to perform gaussian filtering
 	// If gaussWidth is <=0 the width is calculated based on sigma
 	void GaussianTemplates(ConstantTemplate<double>*& x, ConstantTemplate<double>*& y,
 						   double sigma, int gaussWidth = 0);
 
+	// Calculates the components of the structure tensor of input, where sigma
+	// smooths the input and rho smooths the products of the derivatives
+	void StructureTensor(const Image<double>& input, Image<double>& J_11, Image<double>& J_12, Image<double>& J_22,
+						 double sigma = 0.5, double rho = 4.);
+
 	// Performs Marr-Hilsreth Edge detection on the given image using sigma as
 	// a Gaussian smoothing parameter
 	void MarrHildrethEdges(Image<double>& input, double sigma = 4, int debug = 0);
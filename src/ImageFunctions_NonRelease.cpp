@@ -71,7 +71,7 @@ namespace ImageTL
 			param = param<<1;
 		}
 
-		input.domainTransform(transpose);
+		input.transpose();
 		input.domainTransform(bitReversal);
 
 		param = 1;
@@ -82,7 +82,7 @@ namespace ImageTL
 			param = param<<1;
 		}
 
-		input.domainTransform(transpose);
+		input.transpose();
 
 		if(direction < 0)
 		{
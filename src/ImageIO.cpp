@@ -119,52 +119,49 @@ namespace ImageTL
 
 	template<class Type> void ImageIO<Type>::histogram()
 	{
-		writePrepare();
+		Histogram<Type> hist(*this, m_depth + 1, 0, m_depth);
+
 		if(m_hist != NULL) {
 			delete[] m_hist; }
 		m_hist = new int[m_depth + 1];
-		memset(m_hist, 0, sizeof(int)*(m_depth + 1));
-
-		typename Image<Type>::iterator e = this->end();
-		for(typename Image<Type>::iterator i = this->begin(); i != e; ++i) {
-			m_hist[(int)*i]++; }
+		for(int i = 0; i <= m_depth; i++) {
+			m_hist[i] = hist[i]; }
 	}
 
 	template<class Type> void ImageIO<Type>::histogramEqualize()
 	{
-		histogram();
-
-		double c = (double)m_depth/(this->m_width*this->m_height);
-		int *cummHist = new int[m_depth + 1];
-		cummHist[0] = m_hist[0];
-		for(int i = 1; i<=m_depth; i++) {
-			cummHist[i] = cummHist[i - 1] + m_hist[i]; }
+		Histogram<Type> hist(*this, m_depth + 1, 0, m_depth);
 
-		typename Image<Type>::iterator e = this->end();
-		for(typename Image<Type>::iterator i = this->begin(); i != e; ++i) {
-			*i = Type(c*cummHist[(int)*i]); }
+		if(m_hist != NULL) {
+			delete[] m_hist; }
+		m_hist = new int[m_depth + 1];
+		for(int i = 0; i <= m_depth; i++) {
+			m_hist[i] = hist[i]; }
 
-		delete[] cummHist;
+		hist.equalize(*this);
 	}
 
 	template<class Type> ImageIO<Type>& ImageIO<Type>::operator=(const ImageIO<Type>& im)
 	{
-		if(this->m_height != im.m_height || this->m_width != im.m_width)
+		if(!this->shareImage(im))
 		{
-			this->freeImage(this->m_image);
+			if(this->m_height != im.m_height || this->m_width != im.m_width || this->shared())
+			{
+				this->freeImage(this->m_image);
 
-			this->m_height = im.m_height;
-			this->m_width  = im.m_width;
+				this->m_height = im.m_height;
+				this->m_width  = im.m_width;
 
-			this->m_image = this->allocateImage();
+				this->m_image = this->allocateImage();
+			}
+
+			this->copyImage(this->m_image, im.m_image);
 		}
 
 		m_depth = im.m_depth;
 		m_headerLength = 0;
 		m_depth_h = im.m_depth_h;
 
-		this->copyImage(this->m_image, im.m_image);
-
 		return *this;
 	}
 
@@ -213,7 +210,9 @@ namespace ImageTL
 namespace ImageTL
 {
 	template class ImageIO<char>;
+	template class ImageIO<unsigned char>;
 	template class ImageIO<short>;
+	template class ImageIO<unsigned short>;
 	template class ImageIO<int>;
 	template class ImageIO<long>;
 	template class ImageIO<float>;
@@ -6,6 +6,7 @@
 #include <cstring>
 #include <cmath>
 #include "Image.h"
+#include "Histogram.h"
 
 namespace ImageTL
 {
@@ -78,14 +79,16 @@ namespace ImageTL
 		int& depth() { return m_depth; }
 		depth_handling& depthHandling() { return m_depth_h; }
 
-		//This allocates and populates the histogram structure in the class.
-		//Note that the pixel depth check is forced when this function is called.
+		//This allocates and populates the histogram structure in the class with
+		//one bin for each integer value from 0 to the depth.  Pixels are rounded
+		//to the nearest bin and the image is not altered.
 		void histogram();
 
 		//Data manipulation functions that DO alter the image
 		//This forces the pixel depth and then rounds the image to integers
 		void writePrepare();
-		//First calls the histogram() function and then uses that to equalize the image
+		//Equalizes the image over the range 0 to the depth with a lookup table
+		//made from histogram()
 		void histogramEqualize();
 
 		//Data manipulation functions that MIGHT alter the image
@@ -22,11 +22,22 @@ namespace ImageTL
 namespace ImageTL
 {
 	template class ImageIterator<char>;
+	template class ImageIterator<unsigned char>;
 	template class ImageIterator<short>;
+	template class ImageIterator<unsigned short>;
 	template class ImageIterator<int>;
 	template class ImageIterator<long>;
 	template class ImageIterator<float>;
 	template class ImageIterator<double>;
+
+	template class ImageIterator<const char>;
+	template class ImageIterator<const unsigned char>;
+	template class ImageIterator<const short>;
+	template class ImageIterator<const unsigned short>;
+	template class ImageIterator<const int>;
+	template class ImageIterator<const long>;
+	template class ImageIterator<const float>;
+	template class ImageIterator<const double>;
 }
 #endif
 
@@ -29,7 +29,9 @@ namespace ImageTL
 				  dereferencing operator.
 
 		@note In order to properly use the ImageIterator class, the
-			Image::begin() and Image::end() functions should be used.
+			Image::begin() and Image::end() functions should be used.  The
+			const versions return an ImageIterator<const Type>, which can only
+			read the pixels.
 	*/
 	template<class Type> class ImageIterator
 	{
@@ -0,0 +1,114 @@
+#ifndef __IMAGELUT_H__
+#define __IMAGELUT_H__
+/** @file ImageLut.h
+	Contains the lookup tables used to apply pixel functions to images with
+	small integer types.
+	An 8 or 16 bit pixel can only hold 256 or 65536 values, so a function of
+	a single pixel can be evaluated once for each value in an image and then
+	applied to a large image as a table lookup.
+*/
+
+#include <cstddef>
+#include <vector>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+namespace ImageTL
+{
+	/** @class lut_traits
+		Describes how the pixels of a type index a lookup table.
+		The general version is disabled, so functions are applied directly for
+		every type without a specialization.
+	*/
+	template<class Type> struct lut_traits
+	{
+		enum { enabled = 0, size = 0 };
+		static int  index(Type)  { return 0; }
+		static Type value(int)   { return Type(); }
+	};
+
+	template<class Type, int Size> struct lut_integer_traits
+	{
+		enum { enabled = 1, size = Size };
+		static int  index(Type n) { return int(n) & (Size - 1); }	///< The table entry of a pixel value.
+		static Type value(int i)  { return Type(i); }				///< The pixel value of a table entry.
+	};
+
+	template<> struct lut_traits<char>           : public lut_integer_traits<char, 256>             {};
+	template<> struct lut_traits<signed char>    : public lut_integer_traits<signed char, 256>      {};
+	template<> struct lut_traits<unsigned char>  : public lut_integer_traits<unsigned char, 256>    {};
+	template<> struct lut_traits<short>          : public lut_integer_traits<short, 65536>          {};
+	template<> struct lut_traits<unsigned short> : public lut_integer_traits<unsigned short, 65536> {};
+
+	/** Fills <i>table</i> with func(value) for each value that occurs in the
+		<i>length</i> pixels of <i>src</i>.  Entries for the other values are
+		left as zero, so <i>func</i> is never called with a value the pixels
+		do not hold.  The table is padded so that it can be read with 32 bit
+		gathers.
+	*/
+	template<class Type, class Func> void lut_build(std::vector<Type> &table, Func &func, const Type *src, size_t length)
+	{
+		std::vector<unsigned char> present(lut_traits<Type>::size, 0);
+		for(size_t i = 0; i < length; i++) {
+			present[lut_traits<Type>::index(src[i])] = 1; }
+
+		table.assign(lut_traits<Type>::size + 4/sizeof(Type), Type());
+		for(int i = 0; i < (int)lut_traits<Type>::size; i++) {
+			if(present[i]) {
+				table[i] = func(lut_traits<Type>::value(i)); } }
+	}
+
+	/** Replaces each of the <i>length</i> pixels of <i>src</i> with its table
+		entry and stores the result in <i>dest</i>.  The two arrays may be the
+		same.
+	*/
+	template<class Type> void lut_apply(const Type *src, Type *dest, size_t length, const Type *table)
+	{
+		size_t i = 0;
+#ifdef __AVX2__
+		// Gather the table entries eight at a time and pack them back down
+		if(sizeof(Type) <= 2)
+		{
+			const __m256i mask = _mm256_set1_epi32((sizeof(Type) == 1)?0xFF:0xFFFF);
+			for(; i + 8 <= length; i += 8)
+			{
+				__m256i index, entries;
+				if(sizeof(Type) == 1)
+				{
+					index   = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(src + i)));
+					entries = _mm256_i32gather_epi32((const int*)table, index, 1);
+				}
+				else
+				{
+					index   = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)(src + i)));
+					entries = _mm256_i32gather_epi32((const int*)table, index, 2);
+				}
+
+				__m256i packed = _mm256_packus_epi32(_mm256_and_si256(entries, mask), _mm256_setzero_si256());
+				__m128i words  = _mm256_castsi256_si128(_mm256_permute4x64_epi64(packed, 0xD8));
+				if(sizeof(Type) == 1) {
+					_mm_storel_epi64((__m128i*)(dest + i), _mm_packus_epi16(words, words)); }
+				else {
+					_mm_storeu_si128((__m128i*)(dest + i), words); }
+			}
+		}
+#endif
+		for(; i + 4 <= length; i += 4)
+		{
+			Type a = table[lut_traits<Type>::index(src[i])];
+			Type b = table[lut_traits<Type>::index(src[i + 1])];
+			Type c = table[lut_traits<Type>::index(src[i + 2])];
+			Type d = table[lut_traits<Type>::index(src[i + 3])];
+			dest[i]     = a;
+			dest[i + 1] = b;
+			dest[i + 2] = c;
+			dest[i + 3] = d;
+		}
+		for(; i < length; i++) {
+			dest[i] = table[lut_traits<Type>::index(src[i])]; }
+	}
+}	// end namespace
+
+#endif
\ No newline at end of file
@@ -0,0 +1,255 @@
+#ifndef __IMAGEPYRAMID_CPP__
+#define __IMAGEPYRAMID_CPP__
+/** @file ImagePyramid.cpp
+	Contains function definitions that are declared in ImagePyramid.h
+*/
+
+#include <algorithm>
+#include "ImagePyramid.h"
+
+namespace ImageTL
+{
+	// The taps of one phase of a filter, as offsets from the source pixel
+	// under the destination pixel
+	template<class Work> struct pyramid_taps
+	{
+		std::vector<int> offset;
+		std::vector<Work> weight;
+	};
+
+	// Makes the taps of the blur and decimation, which has one phase, or of
+	// the expansion, which has one phase for even and one for odd pixels.
+	// Expanding inserts zeros between the pixels and blurs, so each phase
+	// only uses every second tap and is normalised on its own.
+	template<class Work> static void pyramid_phases(const std::vector<double> &kernel, bool expand, pyramid_taps<Work> phases[2])
+	{
+		const int size = (int)kernel.size(), radius = (size - 1)/2;
+		for(int phase = 0; phase < (expand?2:1); phase++)
+		{
+			double sum = 0.;
+			phases[phase].offset.clear();
+			phases[phase].weight.clear();
+			for(int j = 0; j < size; j++)
+			{
+				int p = phase + j - radius;
+				if(expand && (p & 1)) {
+					continue; }
+				phases[phase].offset.push_back(expand?(p/2):(j - radius));
+				phases[phase].weight.push_back(Work(kernel[j]));
+				sum += kernel[j];
+			}
+			for(size_t k = 0; k < phases[phase].weight.size(); k++) {
+				phases[phase].weight[k] = Work(phases[phase].weight[k]/sum); }
+		}
+	}
+
+	// Filters the rows then the columns of a level into out.  Reducing, pixel
+	// u of the result is over pixel 2u of the source, and expanding over
+	// pixel u/2.  Each row of the result filters the source rows it needs into
+	// a buffer that is padded with the clamped border pixels, so the
+	// horizontal taps are never bounds checked.
+	template<class Type, class Work> static void pyramid_filter(const Type *in, int inWidth, int inHeight, Work *out, int outWidth, int outHeight,
+																const std::vector<double> &kernel, bool expand)
+	{
+		pyramid_taps<Work> phases[2];
+		pyramid_phases(kernel, expand, phases);
+		int margin = 0;
+		for(int phase = 0; phase < (expand?2:1); phase++) {
+			for(size_t k = 0; k < phases[phase].offset.size(); k++) {
+				margin = std::max(margin, std::abs(phases[phase].offset[k])); } }
+
+		parallelFor(0, outHeight, [&](int first, int last)
+		{
+			std::vector<Work> buffer(inWidth + 2*margin);
+			Work *row = &buffer[margin];
+			for(int y = first; y < last; y++)
+			{
+				const pyramid_taps<Work> &down = phases[expand?(y & 1):0];
+				const int baseY = expand?(y >> 1):(2*y);
+				std::fill(row, row + inWidth, Work(0));
+				for(size_t k = 0; k < down.offset.size(); k++)
+				{
+					const int sy = std::min(std::max(baseY + down.offset[k], 0), inHeight - 1);
+					const Type *s = in + (size_t)inWidth*sy;
+					const Work w = down.weight[k];
+					for(int x = 0; x < inWidth; x++) {
+						row[x] += w*Work(s[x]); }
+				}
+				for(int i = 1; i <= margin; i++)
+				{
+					row[-i] = row[0];
+					row[inWidth - 1 + i] = row[inWidth - 1];
+				}
+
+				Work *o = out + (size_t)outWidth*y;
+				for(int x = 0; x < outWidth; x++)
+				{
+					const pyramid_taps<Work> &across = phases[expand?(x & 1):0];
+					const Work *s = row + (expand?(x >> 1):(2*x));
+					Work sum = Work(0);
+					for(size_t k = 0; k < across.offset.size(); k++) {
+						sum += across.weight[k]*s[across.offset[k]]; }
+					o[x] = sum;
+				}
+			}
+		}, 16);
+	}
+
+	// Constructor
+	template<class Type> ImagePyramid<Type>::ImagePyramid(const Image<Type> &base, int levels, double sigma)
+		: m_gaussianBuilt(1), m_edgeHandling(base.edgeHandling())
+	{
+		if(base.width() <= 0 || base.height() <= 0) {
+			throw ImageException("ImagePyramid::ImagePyramid [The image is empty]"); }
+
+		int width = base.width(), height = base.height();
+		size_t offset = 0;
+		for(;;)
+		{
+			m_width.push_back(width);
+			m_height.push_back(height);
+			m_offset.push_back(offset);
+			offset += (size_t)width*height;
+			if((levels > 0 && (int)m_width.size() == levels) || width == 1 || height == 1) {
+				break; }
+			width  = (width + 1)/2;
+			height = (height + 1)/2;
+		}
+		m_laplacianBuilt.assign(m_width.size(), 0);
+
+		m_gaussian.resize(offset);
+		std::copy(base.data(), base.data() + (size_t)base.width()*base.height(), m_gaussian.begin());
+
+		// The same Gaussian that the rest of the library smooths with
+		m_kernel = GaussianKernel(sigma);
+	}
+
+	template<class Type> int ImagePyramid<Type>::checked(int level) const
+	{
+		if(level < 0 || level >= levels())
+		{
+			std::stringstream msg_stream;
+			msg_stream<<"ImagePyramid [There is no level "<<level<<"]";
+			throw ImageException(msg_stream.str());
+		}
+		return level;
+	}
+
+	// Levels
+	template<class Type> const Type* ImagePyramid<Type>::gaussian(int level)
+	{
+		typedef typename pyramid_traits<Type>::work work;
+		checked(level);
+
+		std::vector<work> reduced;
+		for(; m_gaussianBuilt <= level; m_gaussianBuilt++)
+		{
+			const int k = m_gaussianBuilt;
+			reduced.resize((size_t)m_width[k]*m_height[k]);
+			pyramid_filter(this->level(m_gaussian, k - 1), m_width[k - 1], m_height[k - 1], &reduced[0], m_width[k], m_height[k], m_kernel, false);
+
+			Type *out = this->level(m_gaussian, k);
+			for(size_t i = 0; i < reduced.size(); i++) {
+				out[i] = saturate_cast<Type>(reduced[i]); }
+		}
+		return this->level(m_gaussian, level);
+	}
+
+	template<class Type> typename ImagePyramid<Type>::band_type* ImagePyramid<Type>::laplacian(int level)
+	{
+		typedef typename pyramid_traits<Type>::work work;
+		checked(level);
+		if(m_laplacian.empty()) {
+			m_laplacian.resize(m_gaussian.size()); }
+		if(m_laplacianBuilt[level]) {
+			return this->level(m_laplacian, level); }
+
+		const int top = levels() - 1;
+		const size_t size = (size_t)m_width[level]*m_height[level];
+		gaussian(std::min(level + 1, top));
+		const Type *fine = this->level(m_gaussian, level);
+		work *out = this->level(m_laplacian, level);
+		if(level == top) {
+			std::copy(fine, fine + size, out); }
+		else
+		{
+			std::vector<work> expanded(size);
+			pyramid_filter(this->level(m_gaussian, level + 1), m_width[level + 1], m_height[level + 1],
+						   &expanded[0], m_width[level], m_height[level], m_kernel, true);
+			// The expansion is rounded to the type before it is subtracted, so
+			// reconstruct() can add exactly the same value back
+			for(size_t i = 0; i < size; i++) {
+				out[i] = work(fine[i]) - work(saturate_cast<Type>(expanded[i])); }
+		}
+
+		m_laplacianBuilt[level] = 1;
+		return out;
+	}
+
+	template<class Type> void ImagePyramid<Type>::gaussian(int level, Image<Type> &dest)
+	{
+		const Type *in = gaussian(level);
+		if(dest.width() != m_width[level] || dest.height() != m_height[level]) {
+			dest.resize(m_width[level], m_height[level], false); }
+		dest.edgeHandling() = m_edgeHandling;
+		std::copy(in, in + (size_t)m_width[level]*m_height[level], dest.data());
+	}
+
+	template<class Type> void ImagePyramid<Type>::laplacian(int level, Image<band_type> &dest)
+	{
+		const band_type *in = laplacian(level);
+		if(dest.width() != m_width[level] || dest.height() != m_height[level]) {
+			dest.resize(m_width[level], m_height[level], false); }
+		dest.edgeHandling() = m_edgeHandling;
+		std::copy(in, in + (size_t)m_width[level]*m_height[level], dest.data());
+	}
+
+	// Reconstruction
+	template<class Type> void ImagePyramid<Type>::reconstruct(Image<Type> &dest)
+	{
+		typedef typename pyramid_traits<Type>::work work;
+		const int top = levels() - 1;
+		for(int k = 0; k <= top; k++) {
+			laplacian(k); }
+
+		const work *last = laplacian(top);
+		std::vector<Type> current((size_t)m_width[top]*m_height[top]), next;
+		for(size_t i = 0; i < current.size(); i++) {
+			current[i] = saturate_cast<Type>(last[i]); }
+		std::vector<work> expanded;
+		for(int k = top - 1; k >= 0; k--)
+		{
+			const size_t size = (size_t)m_width[k]*m_height[k];
+			expanded.resize(size);
+			pyramid_filter(&current[0], m_width[k + 1], m_height[k + 1], &expanded[0], m_width[k], m_height[k], m_kernel, true);
+
+			const work *band = this->level(m_laplacian, k);
+			next.resize(size);
+			for(size_t i = 0; i < size; i++) {
+				next[i] = saturate_cast<Type>(work(band[i]) + work(saturate_cast<Type>(expanded[i]))); }
+			current.swap(next);
+		}
+
+		if(dest.width() != m_width[0] || dest.height() != m_height[0]) {
+			dest.resize(m_width[0], m_height[0], false); }
+		dest.edgeHandling() = m_edgeHandling;
+		std::copy(current.begin(), current.end(), dest.data());
+	}
+}	//End namespace
+
+// Instantiate with common template types for library compilation
+#ifdef IMAGETL_LIBRARY_COMPILE
+namespace ImageTL
+{
+	template class ImagePyramid<char>;
+	template class ImagePyramid<unsigned char>;
+	template class ImagePyramid<short>;
+	template class ImagePyramid<unsigned short>;
+	template class ImagePyramid<int>;
+	template class ImagePyramid<long>;
+	template class ImagePyramid<float>;
+	template class ImagePyramid<double>;
+}
+#endif
+
+#endif
\ No newline at end of file
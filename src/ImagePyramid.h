@@ -0,0 +1,113 @@
+#ifndef __IMAGEPYRAMID_H__
+#define __IMAGEPYRAMID_H__
+/** @file ImagePyramid.h
+	Contains the ImagePyramid class, which builds Gaussian and Laplacian
+	pyramids of an image.
+*/
+
+#include <vector>
+#include <type_traits>
+#include "ImageFunctions.h"
+
+namespace ImageTL
+{
+	/** @class pyramid_traits
+		The type that the levels of a pyramid are filtered in, which is also
+		the signed type that the Laplacian levels are stored in.
+	*/
+	template<class Type> struct pyramid_traits
+	{
+		typedef typename std::conditional<(sizeof(Type) <= 2 || std::is_same<Type, float>::value), float, double>::type work;
+	};
+
+	/** @class ImagePyramid
+		The Gaussian and Laplacian pyramids of an image.
+		Level 0 is the image itself, and each level after it is the level
+		before blurred with the Gaussian of GaussianTemplates() and decimated
+		by two, rounding the dimensions up.  The blur and the decimation are
+		one pass that only computes the pixels that are kept.  Level <i>k</i>
+		of the Laplacian pyramid is Gaussian level <i>k</i> less Gaussian
+		level <i>k+1</i> expanded to its size, and the last level of both
+		pyramids is the same.
+
+		The levels of each pyramid are stored one after another in a single
+		allocation, and are only built when they are first asked for.  Pixels
+		past the border of a level are clamped.
+
+		The Laplacian levels are stored in pyramid_traits<Type>::work, so
+		they hold the negative differences of unsigned types.  For integer
+		types the expanded level is rounded to the type before the difference
+		is taken, so reconstruct() gives back the image exactly.
+		@code
+		ImagePyramid<float> pyramid(im);
+		for(int k = 0; k < pyramid.levels(); k++)
+		{
+			Image<float> band;
+			pyramid.laplacian(k, band);
+			// ... detect features at scale 2^k
+		}
+		@endcode
+	*/
+	template<class Type> class ImagePyramid
+	{
+	public:
+		typedef typename pyramid_traits<Type>::work band_type;	///< The type of the Laplacian levels.
+
+		/** Prepares the pyramids of <i>base</i>, which is copied.
+			@param base The image at level 0.
+			@param levels The number of levels, or 0 or less to continue until
+				a level is 1 pixel wide or high.  At most that many levels are
+				made.
+			@param sigma The standard deviation of the Gaussian blur.
+			@throw ImageException If <i>base</i> is empty.
+		*/
+		explicit ImagePyramid(const Image<Type> &base, int levels = 0, double sigma = 1.);
+
+		int levels() const { return (int)m_width.size(); }					///< Returns the number of levels.
+		int width(int level) const  { return m_width[checked(level)]; }		///< Returns the width of a level.
+		int height(int level) const { return m_height[checked(level)]; }	///< Returns the height of a level.
+
+		/** Returns the pixels of Gaussian level <i>level</i> in row-major
+			order, building it and the levels before it if needed.
+			@throw ImageException If there is no such level.
+		*/
+		const Type* gaussian(int level);
+
+		/** Returns the pixels of Laplacian level <i>level</i> in row-major
+			order, building it if needed.  They may be changed before calling
+			reconstruct(), for example to blend two pyramids.
+			@throw ImageException If there is no such level.
+		*/
+		band_type* laplacian(int level);
+
+		void gaussian(int level, Image<Type> &dest);		///< Copies Gaussian level <i>level</i> into <i>dest</i>.
+		void laplacian(int level, Image<band_type> &dest);	///< Copies Laplacian level <i>level</i> into <i>dest</i>.
+
+		/** Rebuilds level 0 from the Laplacian pyramid into <i>dest</i>,
+			expanding each level and adding the level below it from the top
+			down.  Levels that were never built are built first.
+		*/
+		void reconstruct(Image<Type> &dest);
+
+	protected:
+		int checked(int level) const;
+		template<class T> T* level(std::vector<T> &pyramid, int level) { return &pyramid[m_offset[level]]; }
+
+		std::vector<int> m_width;
+		std::vector<int> m_height;
+		std::vector<size_t> m_offset;		///< The offset of each level in the pyramids.
+		std::vector<double> m_kernel;		///< The normalised 1D Gaussian.
+		std::vector<Type> m_gaussian;
+		std::vector<band_type> m_laplacian;	///< Empty until a Laplacian level is asked for.
+		int m_gaussianBuilt;				///< The number of Gaussian levels built.
+		std::vector<char> m_laplacianBuilt;
+		edge_handling m_edgeHandling;
+	};
+}	// end namespace
+
+// Include the function definitions in the header if we aren't using a compiled library
+#ifdef IMAGETL_NO_LIBRARY
+#include "ImagePyramid.cpp"
+#endif
+
+#endif
\ No newline at end of file
@@ -0,0 +1,529 @@
+#ifndef __IMAGEREMAP_CPP__
+#define __IMAGEREMAP_CPP__
+/** @file ImageRemap.cpp
+	Contains function definitions that are declared in ImageRemap.h
+*/
+
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#include <type_traits>
+#include "ImageRemap.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace ImageTL
+{
+	// Coordinates further out than this are clamped before they are floored
+	static const float remap_limit = 1e8f;
+
+	// The side of the square tiles that warps are computed in
+	static const int warp_tile = 64;
+
+	/** @class remap_traits
+		The type that samples of a pixel type are interpolated in.
+	*/
+	template<class Type> struct remap_traits
+	{
+		typedef typename std::conditional<(sizeof(Type) <= 2 || std::is_same<Type, float>::value), float, double>::type work;
+		static Type result(work value) { return saturate_cast<Type>(value); }
+	};
+
+	// The taps and weights of one axis of a sample
+	template<class Work> struct remap_axis
+	{
+		int first;			// The first pixel under the kernel
+		Work weight[4];		// The weights of the pixels, where unused weights are zero
+	};
+
+	inline int remap_taps(interpolation interp)
+	{
+		return (interp == interpolate_nearest)?1:((interp == interpolate_bilinear)?2:4);
+	}
+
+	template<class Work> inline void remap_weights(float coord, interpolation interp, remap_axis<Work> &axis)
+	{
+		if(interp == interpolate_nearest)
+		{
+			axis.first = (int)std::floor(coord + 0.5f);
+			axis.weight[0] = Work(1);
+			axis.weight[1] = axis.weight[2] = axis.weight[3] = Work(0);
+			return;
+		}
+
+		float base = std::floor(coord);
+		Work t = Work(coord - base);
+		if(interp == interpolate_bilinear)
+		{
+			axis.first = (int)base;
+			axis.weight[0] = Work(1) - t;
+			axis.weight[1] = t;
+			axis.weight[2] = axis.weight[3] = Work(0);
+			return;
+		}
+
+		// Keys cubic convolution with a = -0.5
+		const Work a = Work(-0.5);
+		Work d0 = t + 1, d1 = t, d2 = 1 - t, d3 = 2 - t;
+		axis.first = (int)base - 1;
+		axis.weight[0] = ((a*d0 - 5*a)*d0 + 8*a)*d0 - 4*a;
+		axis.weight[1] = ((a + 2)*d1 - (a + 3))*d1*d1 + 1;
+		axis.weight[2] = ((a + 2)*d2 - (a + 3))*d2*d2 + 1;
+		axis.weight[3] = ((a*d3 - 5*a)*d3 + 8*a)*d3 - 4*a;
+	}
+
+	// Sums the taps of a sample that lies entirely inside the image
+	template<class Type, class Work> inline Work remap_inside(const Image<Type> &src, const remap_axis<Work> &ax, const remap_axis<Work> &ay, int taps)
+	{
+		const int width = src.width();
+		const Type *p = src.data() + (size_t)width*ay.first + ax.first;
+		Work sum = Work(0);
+		for(int ty = 0; ty < taps; ty++, p += width)
+		{
+			Work row = Work(0);
+			for(int tx = 0; tx < taps; tx++) {
+				row += ax.weight[tx]*Work(p[tx]); }
+			sum += ay.weight[ty]*row;
+		}
+		return sum;
+	}
+
+	// Reads a pixel as tryGetPixel() does, with the given edge handling
+	template<class Type> inline bool remap_fetch(const Image<Type> &src, int x, int y, edge_handling eh, Type &value)
+	{
+		const int width = src.width(), height = src.height();
+		if(x < 0 || y < 0 || x >= width || y >= height)
+		{
+			if(eh == edge_skip) {
+				return false; }
+			if(eh == edge_zero)
+			{
+				value = Type(0);
+				return true;
+			}
+			x = (x < 0)?0:((x >= width)?(width - 1):x);
+			y = (y < 0)?0:((y >= height)?(height - 1):y);
+		}
+		value = src.data()[(size_t)width*y + x];
+		return true;
+	}
+
+	// Samples one pixel at (x, y), returning false if the pixel is left unchanged
+	template<class Type> static bool remap_sample(const Image<Type> &src, float x, float y, interpolation interp, edge_handling eh, Type &out)
+	{
+		typedef typename remap_traits<Type>::work work;
+		const int taps = remap_taps(interp);
+
+		if(!(x >= -remap_limit && x <= remap_limit && y >= -remap_limit && y <= remap_limit))
+		{
+			// NaN coordinates have no pixel, and others are clamped
+			if(x != x || y != y)
+			{
+				if(eh == edge_skip) {
+					return false; }
+				out = Type(0);
+				return true;
+			}
+			x = (x < -remap_limit)?-remap_limit:((x > remap_limit)?remap_limit:x);
+			y = (y < -remap_limit)?-remap_limit:((y > remap_limit)?remap_limit:y);
+		}
+
+		remap_axis<work> ax, ay;
+		remap_weights(x, interp, ax);
+		remap_weights(y, interp, ay);
+
+		work sum = work(0);
+		if(ax.first >= 0 && ay.first >= 0 && ax.first + taps <= src.width() && ay.first + taps <= src.height()) {
+			sum = remap_inside(src, ax, ay, taps); }
+		else
+		{
+			// Taps with no weight are ignored, so a sample on the last row or
+			// column does not need the pixels past it
+			Type value;
+			for(int ty = 0; ty < taps; ty++)
+			{
+				for(int tx = 0; tx < taps; tx++)
+				{
+					work w = ax.weight[tx]*ay.weight[ty];
+					if(w == work(0)) {
+						continue; }
+					if(!remap_fetch(src, ax.first + tx, ay.first + ty, eh, value)) {
+						return false; }
+					sum += w*work(value);
+				}
+			}
+		}
+
+		out = remap_traits<Type>::result(sum);
+		return true;
+	}
+
+	// Samples a span of a row, checking every sample against the bounds
+	template<class Type> static void remap_row_generic(const Image<Type> &src, const float *xs, const float *ys, interpolation interp, edge_handling eh, Type *out, int n)
+	{
+		for(int i = 0; i < n; i++) {
+			remap_sample(src, xs[i], ys[i], interp, eh, out[i]); }
+	}
+
+	// Samples a span of a row whose taps all lie inside the image
+	template<class Type> static void remap_interior_generic(const Image<Type> &src, const float *xs, const float *ys, interpolation interp, Type *out, int n)
+	{
+		typedef typename remap_traits<Type>::work work;
+		const int taps = remap_taps(interp);
+		remap_axis<work> ax, ay;
+		for(int i = 0; i < n; i++)
+		{
+			remap_weights(xs[i], interp, ax);
+			remap_weights(ys[i], interp, ay);
+			out[i] = remap_traits<Type>::result(remap_inside(src, ax, ay, taps));
+		}
+	}
+
+	/** @class remap_kernel
+		Samples a span of a row.  row() checks every sample against the bounds
+		of the image, while interior() is only given samples whose taps all lie
+		inside the image.
+	*/
+	template<class Type> struct remap_kernel
+	{
+		static void row(const Image<Type> &src, const float *xs, const float *ys, interpolation interp, edge_handling eh, Type *out, int n)
+			{ remap_row_generic(src, xs, ys, interp, eh, out, n); }
+		static void interior(const Image<Type> &src, const float *xs, const float *ys, interpolation interp, Type *out, int n)
+			{ remap_interior_generic(src, xs, ys, interp, out, n); }
+	};
+
+	// Bilinear interpolation of 8 bit pixels with 11 bit fixed-point weights,
+	// where the product of the two weights is a 22 bit fraction
+	template<class Type> struct remap_kernel_8bit
+	{
+		static Type bilinear(const Type *data, int width, float x, float y)
+		{
+			const int one = 1 << 11;
+			int x0 = (int)x, y0 = (int)y;
+			int wx = (int)((x - x0)*one + 0.5f), wy = (int)((y - y0)*one + 0.5f);
+			const Type *p = data + (size_t)width*y0 + x0;
+			int top    = p[0]*(one - wx)     + p[1]*wx;
+			int bottom = p[width]*(one - wx) + p[width + 1]*wx;
+			return Type((top*(one - wy) + bottom*wy + (1 << 21)) >> 22);
+		}
+
+		static void row(const Image<Type> &src, const float *xs, const float *ys, interpolation interp, edge_handling eh, Type *out, int n)
+		{
+			if(interp != interpolate_bilinear)
+			{
+				remap_row_generic(src, xs, ys, interp, eh, out, n);
+				return;
+			}
+
+			const int width = src.width();
+			const float lastX = float(width - 1), lastY = float(src.height() - 1);
+			for(int i = 0; i < n; i++)
+			{
+				const float x = xs[i], y = ys[i];
+				if(x >= 0.f && y >= 0.f && x < lastX && y < lastY) {
+					out[i] = bilinear(src.data(), width, x, y); }
+				else {
+					remap_sample(src, x, y, interp, eh, out[i]); }
+			}
+		}
+
+		static void interior(const Image<Type> &src, const float *xs, const float *ys, interpolation interp, Type *out, int n)
+		{
+			if(interp != interpolate_bilinear)
+			{
+				remap_interior_generic(src, xs, ys, interp, out, n);
+				return;
+			}
+
+			for(int i = 0; i < n; i++) {
+				out[i] = bilinear(src.data(), src.width(), xs[i], ys[i]); }
+		}
+	};
+
+	template<> struct remap_kernel<unsigned char> : public remap_kernel_8bit<unsigned char> {};
+	template<> struct remap_kernel<char>          : public remap_kernel_8bit<char>          {};
+
+#ifdef __SSE2__
+	// Bilinear interpolation of four float samples that lie inside the image.
+	// The coordinates are not negative, so truncation is floor.  SSE2 has no
+	// gather, so the four neighbours of each sample are loaded individually.
+	inline __m128 remap_bilinear_ps(const float *data, int width, __m128 x, __m128 y)
+	{
+		const __m128 one = _mm_set1_ps(1.f);
+		__m128i xi = _mm_cvttps_epi32(x), yi = _mm_cvttps_epi32(y);
+		__m128 fx = _mm_sub_ps(x, _mm_cvtepi32_ps(xi)), fy = _mm_sub_ps(y, _mm_cvtepi32_ps(yi));
+
+		int xa[4], ya[4];
+		_mm_storeu_si128((__m128i*)xa, xi);
+		_mm_storeu_si128((__m128i*)ya, yi);
+		float a[4], b[4], c[4], d[4];
+		for(int k = 0; k < 4; k++)
+		{
+			const float *p = data + (size_t)width*ya[k] + xa[k];
+			a[k] = p[0];
+			b[k] = p[1];
+			c[k] = p[width];
+			d[k] = p[width + 1];
+		}
+
+		__m128 top    = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(a), _mm_sub_ps(one, fx)), _mm_mul_ps(_mm_loadu_ps(b), fx));
+		__m128 bottom = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(c), _mm_sub_ps(one, fx)), _mm_mul_ps(_mm_loadu_ps(d), fx));
+		return _mm_add_ps(_mm_mul_ps(top, _mm_sub_ps(one, fy)), _mm_mul_ps(bottom, fy));
+	}
+
+	// Bilinear interpolation of float pixels four at a time, where blocks with
+	// any sample near the border fall back to remap_sample()
+	template<> struct remap_kernel<float>
+	{
+		static void row(const Image<float> &src, const float *xs, const float *ys, interpolation interp, edge_handling eh, float *out, int n)
+		{
+			if(interp != interpolate_bilinear)
+			{
+				remap_row_generic(src, xs, ys, interp, eh, out, n);
+				return;
+			}
+
+			const int width = src.width();
+			const __m128 zero = _mm_setzero_ps();
+			const __m128 lastX = _mm_set1_ps(float(width - 1)), lastY = _mm_set1_ps(float(src.height() - 1));
+			int i = 0;
+			for(; i + 4 <= n; i += 4)
+			{
+				__m128 x = _mm_loadu_ps(xs + i), y = _mm_loadu_ps(ys + i);
+				__m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(x, zero), _mm_cmpge_ps(y, zero)),
+										   _mm_and_ps(_mm_cmplt_ps(x, lastX), _mm_cmplt_ps(y, lastY)));
+				if(_mm_movemask_ps(inside) == 0xF) {
+					_mm_storeu_ps(out + i, remap_bilinear_ps(src.data(), width, x, y)); }
+				else {
+					for(int k = i; k < i + 4; k++) {
+						remap_sample(src, xs[k], ys[k], interp, eh, out[k]); } }
+			}
+			for(; i < n; i++) {
+				remap_sample(src, xs[i], ys[i], interp, eh, out[i]); }
+		}
+
+		static void interior(const Image<float> &src, const float *xs, const float *ys, interpolation interp, float *out, int n)
+		{
+			int i = 0;
+			if(interp == interpolate_bilinear) {
+				for(; i + 4 <= n; i += 4) {
+					_mm_storeu_ps(out + i, remap_bilinear_ps(src.data(), src.width(), _mm_loadu_ps(xs + i), _mm_loadu_ps(ys + i))); } }
+			remap_interior_generic(src, xs + i, ys + i, interp, out + i, n - i);
+		}
+	};
+#endif
+
+	// Remapping
+	template<class Type> void remap(const Image<Type> &src, const Image<float> &mapX, const Image<float> &mapY, Image<Type> &dest, interpolation interp)
+	{
+		if(mapX.width() != mapY.width() || mapX.height() != mapY.height()) {
+			throw ImageException("remap [The coordinate maps have different dimensions]"); }
+		if(&dest == &src) {
+			throw ImageException("remap [The source cannot also be the destination]"); }
+
+		const int width = mapX.width(), height = mapX.height();
+		if(dest.width() != width || dest.height() != height) {
+			dest.resize(width, height, false); }
+		dest.edgeHandling() = src.edgeHandling();
+		if(src.width() == 0 || src.height() == 0) {
+			return; }
+
+		const edge_handling eh = src.edgeHandling();
+		Type *const output = dest.data();
+		parallelFor(0, height, [&](int first, int last)
+		{
+			for(int y = first; y < last; y++)
+			{
+				size_t offset = (size_t)width*y;
+				remap_kernel<Type>::row(src, mapX.data() + offset, mapY.data() + offset, interp, eh, output + offset, width);
+			}
+		}, 16);
+	}
+
+	template<class Type> void remap(const Image<Type> &src, const double matrix[9], Image<Type> &dest, interpolation interp)
+	{
+		if(&dest == &src) {
+			throw ImageException("remap [The source cannot also be the destination]"); }
+		warpPerspective(src, matrix, dest, interp, src.edgeHandling());
+	}
+
+	// Warping
+
+	// Narrows [first, last] to the values of k for which alpha + beta*k >= 0
+	inline void warp_constrain(double alpha, double beta, double &first, double &last)
+	{
+		if(beta > 0.) {
+			first = std::max(first, -alpha/beta); }
+		else if(beta < 0.) {
+			last = std::min(last, -alpha/beta); }
+		else if(!(alpha >= 0.)) {
+			last = first - 1.; }
+	}
+
+	// Computes the source coordinates of a span of a destination row, adding
+	// a constant step per pixel, and returns the part [first, last) of the
+	// span whose taps all lie inside the image.  (nx, ny, nw) are the
+	// homogeneous coordinates of the first pixel and (dx, dy, dw) the step.
+	static void warp_span(double nx, double ny, double nw, double dx, double dy, double dw, bool affine,
+						  const double lo[2], const double hi[2], float *xs, float *ys, int n, int &first, int &last)
+	{
+		if(affine)
+		{
+			double x = nx, y = ny;
+			for(int k = 0; k < n; k++, x += dx, y += dy)
+			{
+				xs[k] = float(x);
+				ys[k] = float(y);
+			}
+		}
+		else
+		{
+			double x = nx, y = ny, w = nw;
+			for(int k = 0; k < n; k++, x += dx, y += dy, w += dw)
+			{
+				double inv = 1./w;
+				xs[k] = float(x*inv);
+				ys[k] = float(y*inv);
+			}
+		}
+
+		// lo*w <= x <= hi*w is linear in k while w keeps its sign, so the
+		// interior is the intersection of four half-lines
+		const double w0 = nw, w1 = nw + dw*(n - 1), s = (w0 > 0.)?1.:-1.;
+		double from = 0., to = n - 1.;
+		if(!(w0*w1 > 0.)) {
+			to = -1.; }
+		else
+		{
+			warp_constrain(s*(nx - lo[0]*nw), s*(dx - lo[0]*dw), from, to);
+			warp_constrain(s*(hi[0]*nw - nx), s*(hi[0]*dw - dx), from, to);
+			warp_constrain(s*(ny - lo[1]*nw), s*(dy - lo[1]*dw), from, to);
+			warp_constrain(s*(hi[1]*nw - ny), s*(hi[1]*dw - dy), from, to);
+		}
+		first = (from <= to)?(int)std::ceil(from):0;
+		last  = (from <= to)?(int)std::floor(to) + 1:0;
+
+		// The coordinates are monotonic along the span, so checking the ends
+		// that were actually computed guards the whole span against rounding
+		auto inside = [&](int k)
+		{
+			return xs[k] >= lo[0] && xs[k] <= hi[0] && ys[k] >= lo[1] && ys[k] <= hi[1];
+		};
+		while(first < last && !inside(first)) {
+			first++; }
+		while(first < last && !inside(last - 1)) {
+			last--; }
+	}
+
+	template<class Type> static void warp(const Image<Type> &src, const double matrix[9], bool affine, Image<Type> &dest,
+										  interpolation interp, edge_handling eh)
+	{
+		if(dest.width() == 0 || dest.height() == 0) {
+			dest.resize(src.width(), src.height(), false); }
+		dest.edgeHandling() = eh;
+		const int width = dest.width(), height = dest.height();
+		if(src.width() == 0 || src.height() == 0) {
+			return; }
+
+		// The coordinates whose taps all lie inside the image, less a margin for
+		// rounding the coordinates to float
+		const double margin = 1./64.;
+		const double below = (interp == interpolate_nearest)?-0.5:((interp == interpolate_bilinear)?0.:1.);
+		const double above = (interp == interpolate_nearest)?0.5:((interp == interpolate_bilinear)?1.:2.);
+		const double lo[2] = {below + margin, below + margin};
+		const double hi[2] = {src.width() - above - margin, src.height() - above - margin};
+
+		// Each thread works through bands of tiles, so the source pixels that a
+		// tile reads stay in cache however the transform turns the rows
+		const int tilesX = (width + warp_tile - 1)/warp_tile, tilesY = (height + warp_tile - 1)/warp_tile;
+		Type *const output = dest.data();
+		parallelFor(0, tilesY, [&](int firstBand, int lastBand)
+		{
+			float xs[warp_tile], ys[warp_tile];
+			for(int band = firstBand; band < lastBand; band++)
+			{
+				const int y0 = band*warp_tile, y1 = std::min(y0 + warp_tile, height);
+				for(int tile = 0; tile < tilesX; tile++)
+				{
+					const int x0 = tile*warp_tile, n = std::min(warp_tile, width - x0);
+					for(int y = y0; y < y1; y++)
+					{
+						int first, last;
+						warp_span(matrix[0]*x0 + matrix[1]*y + matrix[2], matrix[3]*x0 + matrix[4]*y + matrix[5],
+								  matrix[6]*x0 + matrix[7]*y + matrix[8], matrix[0], matrix[3], matrix[6],
+								  affine, lo, hi, xs, ys, n, first, last);
+
+						Type *out = output + (size_t)width*y + x0;
+						remap_kernel<Type>::row(src, xs, ys, interp, eh, out, first);
+						remap_kernel<Type>::interior(src, xs + first, ys + first, interp, out + first, last - first);
+						remap_kernel<Type>::row(src, xs + last, ys + last, interp, eh, out + last, n - last);
+					}
+				}
+			}
+		});
+	}
+
+	template<class Type> void warpAffine(const Image<Type> &src, const double matrix[6], Image<Type> &dest, interpolation interp, edge_handling eh)
+	{
+		if(&dest == &src) {
+			throw ImageException("warpAffine [The source cannot also be the destination]"); }
+
+		const double projective[9] = {matrix[0], matrix[1], matrix[2], matrix[3], matrix[4], matrix[5], 0., 0., 1.};
+		warp(src, projective, true, dest, interp, eh);
+	}
+
+	template<class Type> void warpPerspective(const Image<Type> &src, const double matrix[9], Image<Type> &dest, interpolation interp, edge_handling eh)
+	{
+		if(&dest == &src) {
+			throw ImageException("warpPerspective [The source cannot also be the destination]"); }
+
+		const bool affine = (matrix[6] == 0. && matrix[7] == 0. && matrix[8] == 1.);
+		warp(src, matrix, affine, dest, interp, eh);
+	}
+}	//End namespace
+
+// Instantiate with common template types for library compilation
+#ifdef IMAGETL_LIBRARY_COMPILE
+namespace ImageTL
+{
+	template void remap(const Image<char>&,           const Image<float>&, const Image<float>&, Image<char>&,           interpolation);
+	template void remap(const Image<unsigned char>&,  const Image<float>&, const Image<float>&, Image<unsigned char>&,  interpolation);
+	template void remap(const Image<short>&,          const Image<float>&, const Image<float>&, Image<short>&,          interpolation);
+	template void remap(const Image<unsigned short>&, const Image<float>&, const Image<float>&, Image<unsigned short>&, interpolation);
+	template void remap(const Image<int>&,            const Image<float>&, const Image<float>&, Image<int>&,            interpolation);
+	template void remap(const Image<long>&,           const Image<float>&, const Image<float>&, Image<long>&,           interpolation);
+	template void remap(const Image<float>&,          const Image<float>&, const Image<float>&, Image<float>&,          interpolation);
+	template void remap(const Image<double>&,         const Image<float>&, const Image<float>&, Image<double>&,         interpolation);
+
+	template void remap(const Image<char>&,           const double[9], Image<char>&,           interpolation);
+	template void remap(const Image<unsigned char>&,  const double[9], Image<unsigned char>&,  interpolation);
+	template void remap(const Image<short>&,          const double[9], Image<short>&,          interpolation);
+	template void remap(const Image<unsigned short>&, const double[9], Image<unsigned short>&, interpolation);
+	template void remap(const Image<int>&,            const double[9], Image<int>&,            interpolation);
+	template void remap(const Image<long>&,           const double[9], Image<long>&,           interpolation);
+	template void remap(const Image<float>&,          const double[9], Image<float>&,          interpolation);
+	template void remap(const Image<double>&,         const double[9], Image<double>&,         interpolation);
+
+	template void warpAffine(const Image<char>&,           const double[6], Image<char>&,           interpolation, edge_handling);
+	template void warpAffine(const Image<unsigned char>&,  const double[6], Image<unsigned char>&,  interpolation, edge_handling);
+	template void warpAffine(const Image<short>&,          const double[6], Image<short>&,          interpolation, edge_handling);
+	template void warpAffine(const Image<unsigned short>&, const double[6], Image<unsigned short>&, interpolation, edge_handling);
+	template void warpAffine(const Image<int>&,            const double[6], Image<int>&,            interpolation, edge_handling);
+	template void warpAffine(const Image<long>&,           const double[6], Image<long>&,           interpolation, edge_handling);
+	template void warpAffine(const Image<float>&,          const double[6], Image<float>&,          interpolation, edge_handling);
+	template void warpAffine(const Image<double>&,         const double[6], Image<double>&,         interpolation, edge_handling);
+
+	template void warpPerspective(const Image<char>&,           const double[9], Image<char>&,           interpolation, edge_handling);
+	template void warpPerspective(const Image<unsigned char>&,  const double[9], Image<unsigned char>&,  interpolation, edge_handling);
+	template void warpPerspective(const Image<short>&,          const double[9], Image<short>&,          interpolation, edge_handling);
+	template void warpPerspective(const Image<unsigned short>&, const double[9], Image<unsigned short>&, interpolation, edge_handling);
+	template void warpPerspective(const Image<int>&,            const double[9], Image<int>&,            interpolation, edge_handling);
+	template void warpPerspective(const Image<long>&,           const double[9], Image<long>&,           interpolation, edge_handling);
+	template void warpPerspective(const Image<float>&,          const double[9], Image<float>&,          interpolation, edge_handling);
+	template void warpPerspective(const Image<double>&,         const double[9], Image<double>&,         interpolation, edge_handling);
+}
+#endif
+
+#endif
\ No newline at end of file
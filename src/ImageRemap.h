@@ -0,0 +1,126 @@
+#ifndef __IMAGEREMAP_H__
+#define __IMAGEREMAP_H__
+/** @file ImageRemap.h
+	Contains remap(), which resamples an image at coordinates given by a pair
+	of coordinate maps, and warpAffine() and warpPerspective(), which resample
+	it with a matrix.
+*/
+
+#include "Image.h"
+
+namespace ImageTL
+{
+	/** The interpolations that remap() can use. */
+	enum interpolation
+	{
+		interpolate_nearest,	///< The nearest pixel.
+		interpolate_bilinear,	///< A bilinear interpolation of the 2x2 nearest pixels.
+		interpolate_bicubic		///< A cubic convolution (Keys, a = -0.5) of the 4x4 nearest pixels.
+	};
+
+	/** Resamples <i>src</i> at the coordinates in <i>mapX</i> and
+		<i>mapY</i>, so that <tt>dest(x,y) = src(mapX(x,y), mapY(x,y))</tt>.
+		<i>dest</i> is resized to the dimensions of the maps if needed and
+		takes the edge handling of <i>src</i>.  Samples that need pixels
+		outside of <i>src</i> follow its edge_handling, where edge_skip leaves
+		the destination pixel unchanged, so a preallocated <i>dest</i> can hold
+		a background.
+
+		Rows are resampled in parallel.  Samples whose taps all lie inside the
+		image read the pixels directly without bounds checks, and only the
+		rest go through tryGetPixel().  8 bit images are interpolated
+		bilinearly with 11 bit fixed-point weights, and float images
+		bilinearly four pixels at a time with SSE2.  Integer results are
+		rounded to the nearest value.
+		@throw ImageException If the maps have different dimensions, or if
+			<i>dest</i> is <i>src</i>.
+	*/
+	template<class Type> void remap(const Image<Type> &src, const Image<float> &mapX, const Image<float> &mapY, Image<Type> &dest,
+									interpolation interp = interpolate_bilinear);
+
+	/** Resamples <i>src</i> with a projective matrix, following the edge
+		handling of <i>src</i>.
+		This is warpPerspective() with <tt>src.edgeHandling()</tt>.
+		@throw ImageException If <i>dest</i> is <i>src</i>.
+	*/
+	template<class Type> void remap(const Image<Type> &src, const double matrix[9], Image<Type> &dest,
+									interpolation interp = interpolate_bilinear);
+
+	/** Resamples <i>src</i> with an affine matrix, so that
+		<tt>dest(x,y) = src(x', y')</tt> where
+		<tt>(x', y') = matrix*(x, y, 1)</tt>.
+		<i>matrix</i> is 2x3 in row-major order and maps destination
+		coordinates to source coordinates, as the function given to
+		Image::domainTransform() does.  <i>dest</i> keeps its dimensions, or
+		takes those of <i>src</i> if it is empty, and takes the edge handling
+		<i>eh</i>, which decides the samples that need pixels outside of
+		<i>src</i>.  With edge_skip those pixels of <i>dest</i> are left
+		unchanged.  Bilinear samples are those of
+		getPixel(double,double) const, with the weights kept in floating point
+		for integer pixels.
+
+		The destination is computed in 64x64 tiles so that the source pixels
+		a tile reads stay in cache for any rotation.  Across each row of a
+		tile the source coordinates are stepped by a constant, and the span
+		of the row whose taps all lie inside <i>src</i> is found beforehand,
+		so only the pixels outside of it are bounds checked.
+		@code
+		// Rotate by 30 degrees about the centre
+		double c = cos(M_PI/6), s = sin(M_PI/6), cx = im.width()/2., cy = im.height()/2.;
+		double matrix[6] = {c, -s, cx - c*cx + s*cy,
+		                    s,  c, cy - s*cx - c*cy};
+		Image<float> rotated;
+		warpAffine(im, matrix, rotated, interpolate_bicubic, edge_zero);
+		@endcode
+		@throw ImageException If <i>dest</i> is <i>src</i>.
+	*/
+	template<class Type> void warpAffine(const Image<Type> &src, const double matrix[6], Image<Type> &dest,
+										 interpolation interp = interpolate_bilinear, edge_handling eh = edge_zero);
+
+	/** Resamples <i>src</i> with a projective matrix, so that
+		<tt>dest(x,y) = src(x'/w', y'/w')</tt> where
+		<tt>(x', y', w') = matrix*(x, y, 1)</tt>.
+		<i>matrix</i> is 3x3 in row-major order and maps destination
+		coordinates to source coordinates.  The homogeneous coordinates are
+		stepped across each row, and everything else is as warpAffine().
+		@throw ImageException If <i>dest</i> is <i>src</i>.
+	*/
+	template<class Type> void warpPerspective(const Image<Type> &src, const double matrix[9], Image<Type> &dest,
+											  interpolation interp = interpolate_bilinear, edge_handling eh = edge_zero);
+
+	/** Fills <i>mapX</i> and <i>mapY</i>, resized to <i>width</i> x
+		<i>height</i>, with the source coordinates that <i>matrix</i> gives
+		for each destination pixel, so that a transform that is applied to
+		many frames is only computed once.
+		@see remap(), warpPerspective()
+	*/
+	inline void projectiveMaps(int width, int height, const double matrix[9], Image<float> &mapX, Image<float> &mapY)
+	{
+		if(mapX.width() != width || mapX.height() != height) {
+			mapX.resize(width, height, false); }
+		if(mapY.width() != width || mapY.height() != height) {
+			mapY.resize(width, height, false); }
+
+		float *const xData = mapX.data(), *const yData = mapY.data();
+		parallelFor(0, height, [&](int first, int last)
+		{
+			for(int y = first; y < last; y++)
+			{
+				float *xs = xData + (size_t)width*y, *ys = yData + (size_t)width*y;
+				for(int x = 0; x < width; x++)
+				{
+					double w = 1./(matrix[6]*x + matrix[7]*y + matrix[8]);
+					xs[x] = float((matrix[0]*x + matrix[1]*y + matrix[2])*w);
+					ys[x] = float((matrix[3]*x + matrix[4]*y + matrix[5])*w);
+				}
+			}
+		}, 16);
+	}
+}	// end namespace
+
+// Include the function definitions in the header if we aren't using a compiled library
+#ifdef IMAGETL_NO_LIBRARY
+#include "ImageRemap.cpp"
+#endif
+
+#endif
\ No newline at end of file
@@ -0,0 +1,244 @@
+#ifndef __IMAGERESAMPLE_CPP__
+#define __IMAGERESAMPLE_CPP__
+/** @file ImageResample.cpp
+	Contains function definitions that are declared in ImageResample.h
+*/
+
+#include <cmath>
+#include <vector>
+#include <complex>
+#include <algorithm>
+#include <type_traits>
+#include "ImageResample.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace ImageTL
+{
+	/** @class resample_traits
+		The type that a pixel type is filtered in, and the type of the
+		weights.
+	*/
+	template<class Type> struct resample_traits
+	{
+		typedef typename std::conditional<(sizeof(Type) <= 2 || std::is_same<Type, float>::value), float,
+				typename std::conditional<std::is_arithmetic<Type>::value, double, Type>::type>::type work;
+		typedef typename std::conditional<std::is_same<work, float>::value, float, double>::type weight;
+	};
+
+	// The half width of each filter, in source pixels when enlarging
+	inline double resample_support(resample_filter filter)
+	{
+		switch(filter)
+		{
+		case filter_area:     return 0.5;
+		case filter_bilinear: return 1.;
+		case filter_bicubic:  return 2.;
+		default:              return 3.;
+		}
+	}
+
+	inline double resample_sinc(double x)
+	{
+		const double pi = 3.14159265358979323846;
+		return (x == 0.)?1.:std::sin(pi*x)/(pi*x);
+	}
+
+	inline double resample_kernel(resample_filter filter, double x)
+	{
+		x = std::fabs(x);
+		switch(filter)
+		{
+		case filter_area:
+			return (x < 0.5)?1.:((x == 0.5)?0.5:0.);
+		case filter_bilinear:
+			return (x < 1.)?(1. - x):0.;
+		case filter_bicubic:
+			{
+				const double a = -0.5;
+				if(x < 1.) {
+					return ((a + 2.)*x - (a + 3.))*x*x + 1.; }
+				if(x < 2.) {
+					return ((a*x - 5.*a)*x + 8.*a)*x - 4.*a; }
+				return 0.;
+			}
+		default:
+			return (x < 3.)?resample_sinc(x)*resample_sinc(x/3.):0.;
+		}
+	}
+
+	/** @class resample_axis
+		The weight table of one axis.  Destination pixel <i>i</i> is the sum
+		of source pixels first[i] to first[i] + count[i] - 1 times
+		weights[i*taps] onwards.  The rows of the table are padded with zero
+		weights to a multiple of four, but only the first count[i] weights of
+		a row are ever applied.
+	*/
+	template<class Weight> struct resample_axis
+	{
+		int taps;
+		std::vector<int> first;
+		std::vector<int> count;
+		std::vector<Weight> weights;
+
+		resample_axis(int srcSize, int destSize, resample_filter filter)
+		{
+			const double scale = (double)srcSize/destSize, stretch = std::max(scale, 1.);
+			const double support = resample_support(filter)*stretch;
+			taps = ((int)std::ceil(support)*2 + 1 + 3) & ~3;
+
+			first.resize(destSize);
+			count.resize(destSize);
+			weights.assign((size_t)destSize*taps, Weight(0));
+			std::vector<double> w(taps);
+			for(int i = 0; i < destSize; i++)
+			{
+				// Pixel i covers [i, i + 1) of the destination, so its centre
+				// is at (i + 0.5)*scale in the source
+				const double centre = (i + 0.5)*scale;
+				int lo = std::max((int)std::floor(centre - support + 0.5), 0);
+				int hi = std::min((int)std::floor(centre + support + 0.5), srcSize);
+				hi = std::min(hi, lo + taps);
+
+				double sum = 0.;
+				for(int j = lo; j < hi; j++)
+				{
+					w[j - lo] = resample_kernel(filter, (j + 0.5 - centre)/stretch);
+					sum += w[j - lo];
+				}
+
+				// A destination pixel always has a source pixel, even when the
+				// filter misses them all
+				if(hi <= lo || sum == 0.)
+				{
+					lo = std::min(std::max((int)std::floor(centre), 0), srcSize - 1);
+					hi = lo + 1;
+					w[0] = sum = 1.;
+				}
+
+				first[i] = lo;
+				count[i] = hi - lo;
+				for(int j = 0; j < hi - lo; j++) {
+					weights[(size_t)i*taps + j] = Weight(w[j]/sum); }
+			}
+		}
+	};
+
+	// The dot product of n pixels and weights
+	template<class Work, class Weight> inline Work resample_dot(const Work *pixels, const Weight *weights, int n)
+	{
+		Work sum = Work(0);
+		for(int k = 0; k < n; k++) {
+			sum += pixels[k]*weights[k]; }
+		return sum;
+	}
+
+	// Adds weight times a row to an accumulator
+	template<class Work, class Weight> inline void resample_axpy(Work *acc, const Work *row, Weight weight, int n)
+	{
+		for(int x = 0; x < n; x++) {
+			acc[x] += row[x]*weight; }
+	}
+
+#ifdef __SSE2__
+	inline float resample_dot(const float *pixels, const float *weights, int n)
+	{
+		__m128 sum = _mm_setzero_ps();
+		int k = 0;
+		for(; k + 4 <= n; k += 4) {
+			sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(pixels + k), _mm_loadu_ps(weights + k))); }
+		sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+		sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+		float total = _mm_cvtss_f32(sum);
+		for(; k < n; k++) {
+			total += pixels[k]*weights[k]; }
+		return total;
+	}
+
+	inline void resample_axpy(float *acc, const float *row, float weight, int n)
+	{
+		const __m128 w = _mm_set1_ps(weight);
+		int x = 0;
+		for(; x + 4 <= n; x += 4) {
+			_mm_storeu_ps(acc + x, _mm_add_ps(_mm_loadu_ps(acc + x), _mm_mul_ps(_mm_loadu_ps(row + x), w))); }
+		for(; x < n; x++) {
+			acc[x] += row[x]*weight; }
+	}
+#endif
+
+	template<class Type> void resample(const Type *src, int srcWidth, int srcHeight, Type *dest, int destWidth, int destHeight, resample_filter filter)
+	{
+		typedef typename resample_traits<Type>::work work;
+		typedef typename resample_traits<Type>::weight weight;
+
+		if(destWidth <= 0 || destHeight <= 0) {
+			return; }
+		if(srcWidth <= 0 || srcHeight <= 0)
+		{
+			std::fill(dest, dest + (size_t)destWidth*destHeight, Type(0));
+			return;
+		}
+		if(srcWidth == destWidth && srcHeight == destHeight)
+		{
+			std::copy(src, src + (size_t)srcWidth*srcHeight, dest);
+			return;
+		}
+
+		const resample_axis<weight> across(srcWidth, destWidth, filter), down(srcHeight, destHeight, filter);
+		std::vector<work> middle((size_t)destWidth*srcHeight);
+
+		// Filter each source row into the intermediate image.  The dot products
+		// only cover the taps inside the source, so a non-finite pixel is never
+		// multiplied by the zero weights that pad the table.
+		parallelFor(0, srcHeight, [&](int first, int last)
+		{
+			std::vector<work> row(srcWidth);
+			for(int y = first; y < last; y++)
+			{
+				const Type *in = src + (size_t)srcWidth*y;
+				for(int x = 0; x < srcWidth; x++) {
+					row[x] = work(in[x]); }
+
+				work *out = &middle[(size_t)destWidth*y];
+				for(int x = 0; x < destWidth; x++) {
+					out[x] = resample_dot(&row[across.first[x]], &across.weights[(size_t)x*across.taps], across.count[x]); }
+			}
+		}, 16);
+
+		// Filter the columns of the intermediate image a row at a time
+		parallelFor(0, destHeight, [&](int first, int last)
+		{
+			std::vector<work> acc(destWidth);
+			for(int y = first; y < last; y++)
+			{
+				std::fill(acc.begin(), acc.end(), work(0));
+				for(int k = 0; k < down.count[y]; k++) {
+					resample_axpy(&acc[0], &middle[(size_t)destWidth*(down.first[y] + k)], down.weights[(size_t)y*down.taps + k], destWidth); }
+
+				Type *out = dest + (size_t)destWidth*y;
+				for(int x = 0; x < destWidth; x++) {
+					out[x] = saturate_cast<Type>(acc[x]); }
+			}
+		}, 16);
+	}
+}	//End namespace
+
+// Instantiate with common template types for library compilation
+#ifdef IMAGETL_LIBRARY_COMPILE
+namespace ImageTL
+{
+	template void resample(const char*,           int, int, char*,           int, int, resample_filter);
+	template void resample(const unsigned char*,  int, int, unsigned char*,  int, int, resample_filter);
+	template void resample(const short*,          int, int, short*,          int, int, resample_filter);
+	template void resample(const unsigned short*, int, int, unsigned short*, int, int, resample_filter);
+	template void resample(const int*,            int, int, int*,            int, int, resample_filter);
+	template void resample(const long*,           int, int, long*,           int, int, resample_filter);
+	template void resample(const float*,          int, int, float*,          int, int, resample_filter);
+	template void resample(const double*,         int, int, double*,         int, int, resample_filter);
+	template void resample(const std::complex<double>*, int, int, std::complex<double>*, int, int, resample_filter);
+}
+#endif
+
+#endif
\ No newline at end of file
@@ -0,0 +1,47 @@
+#ifndef __IMAGERESAMPLE_H__
+#define __IMAGERESAMPLE_H__
+/** @file ImageResample.h
+	Contains the separable resampling engine used by Image::resize().
+*/
+
+#include "ImageThreads.h"
+#include "Saturate.h"
+
+namespace ImageTL
+{
+	/** The filters that an image can be resampled with.  When an axis is
+		shrunk, the filter is stretched by the scale factor so that every
+		source pixel contributes to the result.
+	*/
+	enum resample_filter
+	{
+		filter_area,		///< Averages the source pixels that each destination pixel covers.
+		filter_bilinear,	///< A triangle filter, which is bilinear interpolation when enlarging.
+		filter_bicubic,		///< The Keys cubic filter with a = -0.5.
+		filter_lanczos3		///< A Lanczos filter with three lobes, the sharpest and slowest filter.
+	};
+
+	/** Resamples the <i>srcWidth</i> x <i>srcHeight</i> pixels at
+		<i>src</i> into the <i>destWidth</i> x <i>destHeight</i> pixels at
+		<i>dest</i>.  The pixel centres of both images are aligned, so that the
+		image keeps its extent.  At the borders the filter is cut off at the
+		edge of the source and its remaining weights are renormalised to sum
+		to one.
+
+		The weights of each axis are computed once into tables.  Rows are
+		filtered horizontally into an intermediate image of floats (or
+		doubles, for 32 bit and real pixels) and then columns vertically, each
+		pass in parallel.  With SSE2 both passes of float intermediates run
+		four lanes at a time.  Integer results are rounded and saturated.
+		@see Image::resize()
+	*/
+	template<class Type> void resample(const Type *src, int srcWidth, int srcHeight, Type *dest, int destWidth, int destHeight,
+									   resample_filter filter = filter_bilinear);
+}	// end namespace
+
+// Include the function definitions in the header if we aren't using a compiled library
+#ifdef IMAGETL_NO_LIBRARY
+#include "ImageResample.cpp"
+#endif
+
+#endif
\ No newline at end of file
@@ -0,0 +1,111 @@
+/** @file ImageRoi.cpp
+	Contains function definitions that are declared in ImageRoi.h
+*/
+
+#include "ImageRoi.h"
+
+namespace ImageTL
+{
+	// Returns the index of the lowest set bit of a nonzero word
+	static inline int roi_lowest_bit(BinaryImage::word w)
+	{
+#if defined(__GNUC__)
+		return __builtin_ctzll(w);
+#else
+		int i = 0;
+		while(!(w & 1)) {
+			w >>= 1;
+			i++; }
+		return i;
+#endif
+	}
+
+	// Building
+	void ImageRoi::begin(int width, int height)
+	{
+		if(width < 0 || height < 0) {
+			throw ImageException("ImageRoi::ImageRoi [The dimensions cannot be negative]"); }
+
+		m_width  = width;
+		m_height = height;
+		m_area   = 0;
+		m_runs.clear();
+		m_rows.assign(height + 1, 0);
+	}
+
+	void ImageRoi::add(int y, int x0, int x1)
+	{
+		// Join a run that touches the last run of the row
+		if(!m_runs.empty() && m_runs.back().y == y && m_runs.back().x1 == x0) {
+			m_runs.back().x1 = x1; }
+		else
+		{
+			roi_run run = {y, x0, x1};
+			m_runs.push_back(run);
+		}
+		m_rows[y + 1] = (int)m_runs.size();
+		m_area += x1 - x0;
+	}
+
+	void ImageRoi::end()
+	{
+		// Rows without runs start where the row before them ends
+		for(int y = 1; y <= m_height; y++) {
+			if(m_rows[y] < m_rows[y - 1]) {
+				m_rows[y] = m_rows[y - 1]; } }
+	}
+
+	// Constructors
+	ImageRoi::ImageRoi(int width, int height)
+	{
+		begin(width, height);
+		if(width > 0) {
+			for(int y = 0; y < height; y++) {
+				add(y, 0, width); } }
+		end();
+	}
+
+	ImageRoi::ImageRoi(int width, int height, int x, int y, int w, int h)
+	{
+		begin(width, height);
+		int x0 = (x > 0)?x:0, x1 = (x + w < width)?(x + w):width;
+		int y0 = (y > 0)?y:0, y1 = (y + h < height)?(y + h):height;
+		if(x1 > x0) {
+			for(int row = y0; row < y1; row++) {
+				add(row, x0, x1); } }
+		end();
+	}
+
+	ImageRoi::ImageRoi(const BinaryImage &mask)
+	{
+		begin(mask.width(), mask.height());
+		const int words = mask.wordsPerRow(), bits = BinaryImage::word_bits;
+		for(int y = 0; y < m_height; y++)
+		{
+			const BinaryImage::word *row = mask.row(y);
+			for(int k = 0; k < words; k++)
+			{
+				// Peel runs off the word, lowest bits first
+				BinaryImage::word w = row[k];
+				while(w != 0)
+				{
+					int start = roi_lowest_bit(w);
+					BinaryImage::word ones = ~(w >> start);
+					int length = (ones == 0)?(bits - start):roi_lowest_bit(ones);
+					add(y, k*bits + start, k*bits + start + length);
+					w = (start + length >= bits)?0:(w & (~BinaryImage::word(0) << (start + length)));
+				}
+			}
+		}
+		end();
+	}
+
+	BinaryImage ImageRoi::toMask() const
+	{
+		BinaryImage mask(m_width, m_height);
+		for(size_t i = 0; i < m_runs.size(); i++) {
+			for(int x = m_runs[i].x0; x < m_runs[i].x1; x++) {
+				mask.set(x, m_runs[i].y); } }
+		return mask;
+	}
+}	// end namespace
\ No newline at end of file
@@ -0,0 +1,343 @@
+#ifndef __IMAGEROI_H__
+#define __IMAGEROI_H__
+/** @file ImageRoi.h
+	Contains the ImageRoi class, a region of an image stored as runs of
+	pixels, and MaskedImage, which applies operations to the pixels of an
+	image inside a region only.
+*/
+
+#include <vector>
+#include "Image.h"
+#include "BinaryImage.h"
+
+namespace ImageTL
+{
+	/** @class roi_run
+		The pixels [x0, x1) of row y.
+	*/
+	struct roi_run
+	{
+		int y;			///< The row of the run.
+		int x0;			///< The first pixel of the run.
+		int x1;			///< One past the last pixel of the run.
+	};
+
+	/** @class ImageRoi
+		A region of interest stored as a list of runs of pixels for every row.
+		The runs of a row are in increasing order and never touch, so the
+		work of an operation over the region is proportional to the number of
+		selected pixels plus the number of runs, and not to the size of the
+		image.
+		@see MaskedImage, masked()
+	*/
+	class ImageRoi
+	{
+	public:
+		// Constructors
+		ImageRoi() : m_width(0), m_height(0), m_area(0), m_rows(1, 0) {}
+		ImageRoi(int width, int height);						///< Selects every pixel of a width x height image.
+		ImageRoi(int width, int height, int x, int y, int w, int h);	///< Selects a rectangle, clipped to a width x height image.
+		explicit ImageRoi(const BinaryImage &mask);				///< Selects the pixels of a mask.
+		template<class Type> explicit ImageRoi(const Image<Type> &mask);	///< Selects the pixels of <i>mask</i> that are not zero.
+
+		int    width()  const { return m_width; }				///< Returns the width of the image the region is in.
+		int    height() const { return m_height; }				///< Returns the height of the image the region is in.
+		size_t area()   const { return m_area; }				///< Returns the number of selected pixels.
+		bool   empty()  const { return m_area == 0; }			///< Returns whether no pixels are selected.
+		const std::vector<roi_run>& runs() const { return m_runs; }	///< Returns every run in row order.
+
+		const roi_run* rowBegin(int y) const { return m_runs.data() + m_rows[y]; }		///< Returns the first run of row <i>y</i>.
+		const roi_run* rowEnd(int y)   const { return m_runs.data() + m_rows[y + 1]; }	///< Returns one past the last run of row <i>y</i>.
+
+		BinaryImage toMask() const;								///< Returns the region as a BinaryImage.
+
+	protected:
+		void begin(int width, int height);
+		void add(int y, int x0, int x1);						// Runs must be added in row order
+		void end();
+
+		int m_width;
+		int m_height;
+		size_t m_area;
+		std::vector<roi_run> m_runs;
+		std::vector<int> m_rows;								// The runs of row y are [m_rows[y], m_rows[y + 1])
+	};
+
+	template<class Type> ImageRoi::ImageRoi(const Image<Type> &mask)
+	{
+		begin(mask.width(), mask.height());
+		for(int y = 0; y < m_height; y++)
+		{
+			const Type *row = mask.data() + (size_t)m_width*y;
+			int x = 0;
+			while(x < m_width)
+			{
+				while(x < m_width && row[x] == Type(0)) {
+					x++; }
+				int x0 = x;
+				while(x < m_width && row[x] != Type(0)) {
+					x++; }
+				if(x > x0) {
+					add(y, x0, x); }
+			}
+		}
+		end();
+	}
+
+	/** @class MaskedImage
+		Applies operations to the pixels of an image that are inside a
+		region, leaving every other pixel unchanged and untouched.
+		A MaskedImage refers to its image and region, so both must outlive
+		it.  Rows of the region are processed in parallel.
+		@code
+		// Replaces mask*a + (1-mask)*b with a single pass over the region
+		masked(b, ImageRoi(mask)) = a;
+		masked(input, organ) += stepSize*filter;
+		@endcode
+	*/
+	template<class Type> class MaskedImage
+	{
+	public:
+		/** @throw ImageException If the region is not the size of the image.
+		*/
+		MaskedImage(Image<Type> &im, const ImageRoi &roi);
+
+		Image<Type>&    image() { return m_image; }			///< Returns the image.
+		const ImageRoi& roi() const { return m_roi; }		///< Returns the region.
+
+		MaskedImage& operator= (const Image<Type> &im);		///< Copies the pixels of <i>im</i> in the region.
+		MaskedImage& operator+=(const Image<Type> &im);		///< Pixel-wise addition in the region.
+		MaskedImage& operator-=(const Image<Type> &im);		///< Pixel-wise subtraction in the region.
+		MaskedImage& operator*=(const Image<Type> &im);		///< Pixel-wise multiplication in the region.
+		MaskedImage& operator/=(const Image<Type> &im);		///< Pixel-wise division in the region, where division by zero gives zero.
+
+		MaskedImage& operator= (const Type &n);				///< Sets the pixels in the region.
+		MaskedImage& operator+=(const Type &n);				///< Pixel-wise addition in the region.
+		MaskedImage& operator-=(const Type &n);				///< Pixel-wise subtraction in the region.
+		MaskedImage& operator*=(const Type &n);				///< Pixel-wise multiplication in the region.
+		MaskedImage& operator/=(const Type &n);				///< Pixel-wise division in the region.
+
+		/** Replaces each pixel in the region with func(pixel).
+			@see Image::genericUnary()
+		*/
+		template<class Func> MaskedImage& genericUnary(Func func);
+
+		/** Replaces each pixel in the region with func(pixel, im(x,y)).
+			@see Image::genericBinary()
+		*/
+		template<class Func> MaskedImage& genericBinary(const Image<Type> &im, Func func);
+
+		/** Replaces each pixel in the region with the convolution of
+			<i>src</i> and <i>tem</i> at that pixel, using <i>policy</i>.
+			Only the neighbourhoods of pixels in the region are read.  Border
+			pixels follow the edge_handling of <i>src</i>, as in convolve().
+			@see convolve(), ConvolutionPolicies.h
+		*/
+		template<class Policy> MaskedImage& convolution(const Image<Type> &src, Template<Type> &tem, const Policy &policy);
+		template<class Policy, int W, int H> MaskedImage& convolution(const Image<Type> &src, const FixedTemplate<Type, W, H> &tem, const Policy &policy)	///< @copydoc convolution()
+		{
+			return convolution(src, tem.data(), W, H, policy);
+		}
+
+	protected:
+		// Calls func(y, x0, x1) for every run, with rows in parallel
+		template<class Func> void forEachRun(Func func) const;
+		void checkSize(const Image<Type> &im, const char *name) const;
+		template<class Policy> MaskedImage& convolution(const Image<Type> &src, const Type *coeff, int tWidth, int tHeight, const Policy &policy);
+
+		Image<Type> &m_image;
+		const ImageRoi &m_roi;
+	};
+
+	/** Returns a MaskedImage that applies operations to the pixels of
+		<i>im</i> in <i>roi</i>.
+	*/
+	template<class Type> MaskedImage<Type> masked(Image<Type> &im, const ImageRoi &roi) { return MaskedImage<Type>(im, roi); }
+
+	// MaskedImage definitions
+	template<class Type> MaskedImage<Type>::MaskedImage(Image<Type> &im, const ImageRoi &roi) : m_image(im), m_roi(roi)
+	{
+		if(im.width() != roi.width() || im.height() != roi.height()) {
+			throw ImageException("MaskedImage::MaskedImage [The region is not the size of the image]"); }
+	}
+
+	template<class Type> template<class Func> void MaskedImage<Type>::forEachRun(Func func) const
+	{
+		const ImageRoi &roi = m_roi;
+		int grain = (roi.area() < 65536)?roi.height():(int)(65536*(size_t)roi.height()/roi.area() + 1);
+		parallelFor(0, roi.height(), [&](int first, int last)
+		{
+			for(int y = first; y < last; y++) {
+				for(const roi_run *r = roi.rowBegin(y), *e = roi.rowEnd(y); r != e; ++r) {
+					func(y, r->x0, r->x1); } }
+		}, grain);
+	}
+
+	template<class Type> void MaskedImage<Type>::checkSize(const Image<Type> &im, const char *name) const
+	{
+		if(im.width() != m_image.width() || im.height() != m_image.height())
+		{
+			std::stringstream msg_stream;
+			msg_stream<<"MaskedImage::"<<name<<" [Unmatched dimensions for operator]";
+			throw ImageException(msg_stream.str());
+		}
+	}
+
+	template<class Type> template<class Func> MaskedImage<Type>& MaskedImage<Type>::genericUnary(Func func)
+	{
+		Type *data = m_image.data();
+		const size_t width = m_image.width();
+		forEachRun([&](int y, int x0, int x1)
+		{
+			Type *p = data + width*y;
+			for(int x = x0; x < x1; x++) {
+				p[x] = func(p[x]); }
+		});
+		return *this;
+	}
+
+	template<class Type> template<class Func> MaskedImage<Type>& MaskedImage<Type>::genericBinary(const Image<Type> &im, Func func)
+	{
+		checkSize(im, "genericBinary");
+		Type *data = m_image.data();
+		const Type *right = im.data();
+		const size_t width = m_image.width();
+		forEachRun([&](int y, int x0, int x1)
+		{
+			Type *p = data + width*y;
+			const Type *q = right + width*y;
+			for(int x = x0; x < x1; x++) {
+				p[x] = func(p[x], q[x]); }
+		});
+		return *this;
+	}
+
+	template<class Type> MaskedImage<Type>& MaskedImage<Type>::operator=(const Image<Type> &im)
+	{
+		if(&im == &m_image) {
+			return *this; }
+		checkSize(im, "operator=");
+		return genericBinary(im, [](const Type &, const Type &b) { return b; });
+	}
+	template<class Type> MaskedImage<Type>& MaskedImage<Type>::operator+=(const Image<Type> &im)
+		{ checkSize(im, "operator+="); return genericBinary(im, [](const Type &a, const Type &b) { return Type(a + b); }); }
+	template<class Type> MaskedImage<Type>& MaskedImage<Type>::operator-=(const Image<Type> &im)
+		{ checkSize(im, "operator-="); return genericBinary(im, [](const Type &a, const Type &b) { return Type(a - b); }); }
+	template<class Type> MaskedImage<Type>& MaskedImage<Type>::operator*=(const Image<Type> &im)
+		{ checkSize(im, "operator*="); return genericBinary(im, [](const Type &a, const Type &b) { return Type(a*b); }); }
+	template<class Type> MaskedImage<Type>& MaskedImage<Type>::operator/=(const Image<Type> &im)
+		{ checkSize(im, "operator/="); return genericBinary(im, [](const Type &a, const Type &b) { return (b != Type(0))?Type(a/b):Type(0); }); }
+
+	template<class Type> MaskedImage<Type>& MaskedImage<Type>::operator= (const Type &n) { return genericUnary([n](const Type &)  { return n; }); }
+	template<class Type> MaskedImage<Type>& MaskedImage<Type>::operator+=(const Type &n) { return genericUnary([n](const Type &a) { return Type(a + n); }); }
+	template<class Type> MaskedImage<Type>& MaskedImage<Type>::operator-=(const Type &n) { return genericUnary([n](const Type &a) { return Type(a - n); }); }
+	template<class Type> MaskedImage<Type>& MaskedImage<Type>::operator*=(const Type &n) { return genericUnary([n](const Type &a) { return Type(a*n); }); }
+	template<class Type> MaskedImage<Type>& MaskedImage<Type>::operator/=(const Type &n) { return genericUnary([n](const Type &a) { return Type(a/n); }); }
+
+	template<class Type> template<class Policy> MaskedImage<Type>& MaskedImage<Type>::convolution(const Image<Type> &src, Template<Type> &tem, const Policy &policy)
+	{
+		if(tem.coefficients() != NULL) {
+			return convolution(src, tem.coefficients(), tem.width(), tem.height(), policy); }
+
+		// The template has to be centered on each pixel, so this is serial
+		checkSize(src, "convolution");
+		if(&src == &m_image) {
+			throw ImageException("MaskedImage::convolution [The source cannot also be the destination]"); }
+
+		const int negX = (tem.width() - 1)/2, negY = (tem.height() - 1)/2;
+		const std::vector<roi_run> &runs = m_roi.runs();
+		for(size_t i = 0; i < runs.size(); i++)
+		{
+			for(int x = runs[i].x0; x < runs[i].x1; x++)
+			{
+				const int y = runs[i].y;
+				typename Policy::accumulator acc = policy.init();
+				int taps = 0;
+				Type value;
+				tem.setCenter(x, y);
+				for(int ty = 0; ty < tem.height(); ty++) {
+					for(int tx = 0; tx < tem.width(); tx++) {
+						if(src.tryGetPixel(x - negX + tx, y - negY + ty, value))
+						{
+							policy.reduce(acc, policy.merge(value, tem(x - negX + tx, y - negY + ty)));
+							taps++;
+						} } }
+				m_image.data()[(size_t)m_image.width()*y + x] = policy.result(acc, taps);
+			}
+		}
+		return *this;
+	}
+
+	template<class Type> template<class Policy> MaskedImage<Type>& MaskedImage<Type>::convolution(const Image<Type> &src, const Type *coeff, int tWidth, int tHeight, const Policy &policy)
+	{
+		typedef typename Policy::accumulator accumulator;
+
+		checkSize(src, "convolution");
+		if(&src == &m_image) {
+			throw ImageException("MaskedImage::convolution [The source cannot also be the destination]"); }
+
+		const int width = src.width(), height = src.height();
+		const int negX = (tWidth - 1)/2,  posX = tWidth/2;
+		const int negY = (tHeight - 1)/2, posY = tHeight/2;
+		const Type *in = src.data();
+		Type *out = m_image.data();
+
+		forEachRun([&](int y, int x0, int x1)
+		{
+			// The part of the run whose neighbourhoods lie inside the image
+			int ix0 = x0, ix1 = x0;
+			if(y >= negY && y + posY < height)
+			{
+				ix0 = (x0 > negX)?x0:negX;
+				ix0 = (ix0 < x1)?ix0:x1;
+				ix1 = (x1 < width - posX)?x1:(width - posX);
+				ix1 = (ix1 > ix0)?ix1:ix0;
+			}
+
+			Type *outRow = out + (size_t)width*y;
+			if(ix1 > ix0)
+			{
+				std::vector<accumulator> acc(ix1 - ix0, policy.init());
+				const int n = ix1 - ix0;
+				for(int ty = 0; ty < tHeight; ty++)
+				{
+					const Type *s = in + (size_t)width*(y - negY + ty) + (ix0 - negX);
+					for(int tx = 0; tx < tWidth; tx++, s++)
+					{
+						const Type c = coeff[tx + tWidth*ty];
+						for(int i = 0; i < n; i++) {
+							policy.reduce(acc[i], policy.merge(s[i], c)); }
+					}
+				}
+				for(int i = 0; i < n; i++) {
+					outRow[ix0 + i] = policy.result(acc[i], tWidth*tHeight); }
+			}
+
+			// Bounds checked pixels
+			auto border = [&](int x)
+			{
+				accumulator acc = policy.init();
+				int taps = 0;
+				Type value;
+				for(int ty = 0; ty < tHeight; ty++)
+				{
+					for(int tx = 0; tx < tWidth; tx++)
+					{
+						if(!src.tryGetPixel(x - negX + tx, y - negY + ty, value)) {
+							continue; }
+						policy.reduce(acc, policy.merge(value, coeff[tx + tWidth*ty]));
+						taps++;
+					}
+				}
+				outRow[x] = policy.result(acc, taps);
+			};
+			for(int x = x0; x < ix0; x++) {
+				border(x); }
+			for(int x = ix1; x < x1; x++) {
+				border(x); }
+		});
+		return *this;
+	}
+}	// end namespace
+
+#endif
\ No newline at end of file
@@ -0,0 +1,154 @@
+#ifndef __IMAGETHREADS_H__
+#define __IMAGETHREADS_H__
+/** @file ImageThreads.h
+	Contains the helpers used to split work on an image across threads.
+	The functions in this header are used by the library wherever an operation
+	can be divided into independent bands of rows (or any other range of
+	indices).  The number of threads used is a global setting so that an
+	application can limit the library to a single thread if it does its own
+	threading.
+*/
+
+#include <vector>
+#include <thread>
+#include <exception>
+#include <cstddef>
+
+#ifdef __unix__
+#include <unistd.h>
+#endif
+
+namespace ImageTL
+{
+	/** Returns a reference to the number of threads the library will use.
+		A value of zero or less means one thread per hardware thread.
+		@see threadCount(), setThreadCount()
+	*/
+	inline int& threadCountSetting()
+	{
+		static int setting = 0;
+		return setting;
+	}
+
+	/** Sets the number of threads the library will use.
+		@param count The number of threads, or zero to use one thread per
+			hardware thread.  Use one to disable threading.
+	*/
+	inline void setThreadCount(int count) { threadCountSetting() = count; }
+
+	/** Returns the number of threads the library will use.
+		@see setThreadCount()
+	*/
+	inline int threadCount()
+	{
+		int count = threadCountSetting();
+		if(count <= 0) {
+			count = (int)std::thread::hardware_concurrency(); }
+		return (count > 0)?count:1;
+	}
+
+	/** Returns a reference to the cache size, in bytes, that the library
+		will fit blocks of work into.
+		A value of zero or less means the size of the L2 cache is used.
+		@see cacheSize(), setCacheSize()
+	*/
+	inline long& cacheSizeSetting()
+	{
+		static long setting = 0;
+		return setting;
+	}
+
+	/** Sets the cache size, in bytes, that the library will fit blocks of
+		work into.
+		@param bytes The size of the cache, or zero to use the size of the L2
+			cache.
+	*/
+	inline void setCacheSize(long bytes) { cacheSizeSetting() = bytes; }
+
+	/** Returns the cache size, in bytes, that the library will fit blocks of
+		work into.
+		Unless it has been set, this is the size of the L2 cache of the
+		system, or 256KB if that cannot be found.
+		@see setCacheSize()
+	*/
+	inline long cacheSize()
+	{
+		long bytes = cacheSizeSetting();
+		if(bytes > 0) {
+			return bytes; }
+
+		static long detected = 0;
+		if(detected == 0)
+		{
+			long found = 0;
+#if defined(__unix__) && defined(_SC_LEVEL2_CACHE_SIZE)
+			found = sysconf(_SC_LEVEL2_CACHE_SIZE);
+#endif
+			detected = (found > 0)?found:(256*1024);
+		}
+		return detected;
+	}
+
+	/** Calls <i>func</i> for contiguous bands of the range [begin, end).
+		The range is divided into at most threadCount() bands of at least
+		<i>grain</i> indices each.  The function must have the form
+		<tt>void func(int bandBegin, int bandEnd)</tt> and may be called on
+		several threads at once.  The last band is run on the calling thread.
+		Any exception thrown by <i>func</i> is rethrown on the calling thread
+		once every band has finished.
+
+		@param begin The first index of the range.
+		@param end One past the last index of the range.
+		@param func The function called for each band.
+		@param grain The smallest number of indices worth giving to a thread.
+	*/
+	template<class Func> void parallelFor(int begin, int end, Func func, int grain = 1)
+	{
+		int length = end - begin;
+		if(length <= 0) {
+			return; }
+
+		if(grain < 1) {
+			grain = 1; }
+
+		int bands = threadCount();
+		if(bands > length/grain) {
+			bands = length/grain; }
+
+		if(bands <= 1)
+		{
+			func(begin, end);
+			return;
+		}
+
+		std::vector<std::thread> threads;
+		std::vector<std::exception_ptr> errors(bands);
+		threads.reserve(bands - 1);
+		for(int band = 0; band < bands - 1; band++)
+		{
+			int bandBegin = begin + (int)((long long)length*band/bands);
+			int bandEnd   = begin + (int)((long long)length*(band + 1)/bands);
+			threads.push_back(std::thread([=, &func, &errors]()
+			{
+				try {
+					func(bandBegin, bandEnd); }
+				catch(...) {
+					errors[band] = std::current_exception(); }
+			}));
+		}
+
+		try {
+			func(begin + (int)((long long)length*(bands - 1)/bands), end); }
+		catch(...) {
+			errors[bands - 1] = std::current_exception(); }
+
+		for(size_t i = 0; i < threads.size(); i++) {
+			threads[i].join(); }
+
+		for(int band = 0; band < bands; band++) {
+			if(errors[band]) {
+				std::rethrow_exception(errors[band]); } }
+	}
+}	// end namespace
+
+#endif
\ No newline at end of file
@@ -0,0 +1,202 @@
+#ifndef __IMAGETRANSPOSE_H__
+#define __IMAGETRANSPOSE_H__
+/** @file ImageTranspose.h
+	Contains the blocked transpose kernels used by Image::transpose() and the
+	rotations.
+*/
+
+#include <cstddef>
+#include <algorithm>
+#include "ImageThreads.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace ImageTL
+{
+	// The side of the square tiles that a transpose works through, so that
+	// the rows of a source tile and of a destination tile all stay in cache
+	static const int transpose_tile = 64;
+
+	/** @class transpose_block
+		Transposes a square block of pixels that are <i>Size</i> bytes each.
+		<tt>run(src, srcStride, dest, destStride)</tt> reads every row of the
+		block before it writes any, so <i>src</i> may be <i>dest</i>.
+		Strides are in pixels.  The general version moves one pixel.
+	*/
+	template<class Type, size_t Size = sizeof(Type)> struct transpose_block
+	{
+		enum { size = 1 };
+		static void run(const Type *src, ptrdiff_t, Type *dest, ptrdiff_t) { *dest = *src; }
+	};
+
+#ifdef __SSE2__
+	// 8x8 bytes, interleaving bytes, then pairs, then quads
+	template<class Type> struct transpose_block<Type, 1>
+	{
+		enum { size = 8 };
+		static void run(const Type *src, ptrdiff_t srcStride, Type *dest, ptrdiff_t destStride)
+		{
+			__m128i r[8];
+			for(int i = 0; i < 8; i++) {
+				r[i] = _mm_loadl_epi64((const __m128i*)(src + i*srcStride)); }
+
+			__m128i a0 = _mm_unpacklo_epi8(r[0], r[1]), a1 = _mm_unpacklo_epi8(r[2], r[3]);
+			__m128i a2 = _mm_unpacklo_epi8(r[4], r[5]), a3 = _mm_unpacklo_epi8(r[6], r[7]);
+			__m128i b0 = _mm_unpacklo_epi16(a0, a1), b1 = _mm_unpackhi_epi16(a0, a1);
+			__m128i b2 = _mm_unpacklo_epi16(a2, a3), b3 = _mm_unpackhi_epi16(a2, a3);
+			__m128i c[4] = {_mm_unpacklo_epi32(b0, b2), _mm_unpackhi_epi32(b0, b2),
+							_mm_unpacklo_epi32(b1, b3), _mm_unpackhi_epi32(b1, b3)};
+
+			for(int i = 0; i < 4; i++)
+			{
+				_mm_storel_epi64((__m128i*)(dest + (2*i)*destStride), c[i]);
+				_mm_storel_epi64((__m128i*)(dest + (2*i + 1)*destStride), _mm_unpackhi_epi64(c[i], c[i]));
+			}
+		}
+	};
+
+	// 8x8 16 bit pixels
+	template<class Type> struct transpose_block<Type, 2>
+	{
+		enum { size = 8 };
+		static void run(const Type *src, ptrdiff_t srcStride, Type *dest, ptrdiff_t destStride)
+		{
+			__m128i r[8];
+			for(int i = 0; i < 8; i++) {
+				r[i] = _mm_loadu_si128((const __m128i*)(src + i*srcStride)); }
+
+			__m128i a[8], b[8];
+			for(int i = 0; i < 4; i++)
+			{
+				a[2*i]     = _mm_unpacklo_epi16(r[2*i], r[2*i + 1]);
+				a[2*i + 1] = _mm_unpackhi_epi16(r[2*i], r[2*i + 1]);
+			}
+			for(int i = 0; i < 2; i++)
+			{
+				b[4*i]     = _mm_unpacklo_epi32(a[4*i],     a[4*i + 2]);
+				b[4*i + 1] = _mm_unpackhi_epi32(a[4*i],     a[4*i + 2]);
+				b[4*i + 2] = _mm_unpacklo_epi32(a[4*i + 1], a[4*i + 3]);
+				b[4*i + 3] = _mm_unpackhi_epi32(a[4*i + 1], a[4*i + 3]);
+			}
+			for(int i = 0; i < 4; i++)
+			{
+				_mm_storeu_si128((__m128i*)(dest + (2*i)*destStride),     _mm_unpacklo_epi64(b[i], b[i + 4]));
+				_mm_storeu_si128((__m128i*)(dest + (2*i + 1)*destStride), _mm_unpackhi_epi64(b[i], b[i + 4]));
+			}
+		}
+	};
+
+	// 4x4 32 bit pixels
+	template<class Type> struct transpose_block<Type, 4>
+	{
+		enum { size = 4 };
+		static void run(const Type *src, ptrdiff_t srcStride, Type *dest, ptrdiff_t destStride)
+		{
+			__m128 r0 = _mm_loadu_ps((const float*)(src)),                 r1 = _mm_loadu_ps((const float*)(src + srcStride));
+			__m128 r2 = _mm_loadu_ps((const float*)(src + 2*srcStride)),   r3 = _mm_loadu_ps((const float*)(src + 3*srcStride));
+			_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+			_mm_storeu_ps((float*)(dest), r0);
+			_mm_storeu_ps((float*)(dest + destStride), r1);
+			_mm_storeu_ps((float*)(dest + 2*destStride), r2);
+			_mm_storeu_ps((float*)(dest + 3*destStride), r3);
+		}
+	};
+
+	// 2x2 64 bit pixels
+	template<class Type> struct transpose_block<Type, 8>
+	{
+		enum { size = 2 };
+		static void run(const Type *src, ptrdiff_t srcStride, Type *dest, ptrdiff_t destStride)
+		{
+			__m128i r0 = _mm_loadu_si128((const __m128i*)(src)), r1 = _mm_loadu_si128((const __m128i*)(src + srcStride));
+			_mm_storeu_si128((__m128i*)(dest),              _mm_unpacklo_epi64(r0, r1));
+			_mm_storeu_si128((__m128i*)(dest + destStride), _mm_unpackhi_epi64(r0, r1));
+		}
+	};
+#endif
+
+	// Transposes the pixels [x0, x1) x [y0, y1) of src into dest, in blocks
+	// where they fit and one pixel at a time at the edges
+	template<class Type> void transposeTile(const Type *src, ptrdiff_t srcStride, Type *dest, ptrdiff_t destStride,
+											int x0, int x1, int y0, int y1)
+	{
+		typedef transpose_block<Type> block;
+		const int xb = x0 + (x1 - x0)/block::size*block::size, yb = y0 + (y1 - y0)/block::size*block::size;
+		for(int y = y0; y < yb; y += block::size) {
+			for(int x = x0; x < xb; x += block::size) {
+				block::run(src + y*srcStride + x, srcStride, dest + x*destStride + y, destStride); } }
+
+		for(int y = y0; y < y1; y++) {
+			for(int x = (y < yb)?xb:x0; x < x1; x++) {
+				dest[x*destStride + y] = src[y*srcStride + x]; } }
+	}
+
+	/** Writes the transpose of the <i>width</i> x <i>height</i> pixels at
+		<i>src</i> to the <i>height</i> x <i>width</i> pixels at <i>dest</i>,
+		which must not overlap them.  The image is worked through in tiles,
+		in parallel over bands of tiles, and each tile in SIMD blocks.
+	*/
+	template<class Type> void transposeCopy(const Type *src, int width, int height, Type *dest)
+	{
+		const int bands = (height + transpose_tile - 1)/transpose_tile;
+		parallelFor(0, bands, [&](int first, int last)
+		{
+			for(int band = first; band < last; band++)
+			{
+				const int y0 = band*transpose_tile, y1 = std::min(y0 + transpose_tile, height);
+				for(int x0 = 0; x0 < width; x0 += transpose_tile) {
+					transposeTile(src, width, dest, height, x0, std::min(x0 + transpose_tile, width), y0, y1); }
+			}
+		});
+	}
+
+	/** Transposes the <i>size</i> x <i>size</i> pixels at <i>data</i> in
+		place.  Each block above the diagonal is swapped with its mirror below
+		it through registers, so no buffer is needed beyond one block.
+	*/
+	template<class Type> void transposeSquare(Type *data, int size)
+	{
+		typedef transpose_block<Type> block;
+		const int n = block::size, full = size/n*n;
+		const ptrdiff_t stride = size;
+		const int bands = (full + transpose_tile - 1)/transpose_tile;
+
+		parallelFor(0, bands, [&](int first, int last)
+		{
+			Type upper[block::size*block::size];
+			for(int band = first; band < last; band++)
+			{
+				const int y0 = band*transpose_tile, y1 = std::min(y0 + transpose_tile, full);
+				for(int x0 = y0; x0 < full; x0 += transpose_tile)
+				{
+					const int x1 = std::min(x0 + transpose_tile, full);
+					for(int y = y0; y < y1; y += n)
+					{
+						for(int x = std::max(x0, y); x < x1; x += n)
+						{
+							Type *a = data + y*stride + x, *b = data + x*stride + y;
+							if(a == b) {
+								block::run(a, stride, a, stride); }
+							else
+							{
+								block::run(a, stride, upper, n);
+								block::run(b, stride, a, stride);
+								for(int i = 0; i < n; i++) {
+									std::copy(upper + i*n, upper + (i + 1)*n, b + i*stride); }
+							}
+						}
+					}
+				}
+			}
+		});
+
+		// The rows and columns past the last whole block
+		for(int y = 0; y < size; y++) {
+			for(int x = std::max(full, y + 1); x < size; x++) {
+				std::swap(data[y*stride + x], data[x*stride + y]); } }
+	}
+}	// end namespace
+
+#endif
\ No newline at end of file
@@ -0,0 +1,367 @@
+#ifndef __ITLIMAGE_CPP__
+#define __ITLIMAGE_CPP__
+/** @file ItlImage.cpp
+	Contains function definitions that are declared in ItlImage.h
+*/
+
+#include "ItlImage.h"
+
+#ifdef _WIN32
+	#include <windows.h>
+#else
+	#include <sys/types.h>
+	#include <sys/stat.h>
+	#include <sys/mman.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+#endif
+
+namespace ImageTL
+{
+	// Returns true if both names refer to the same file on disk
+	static inline bool itl_same_file(const char *a, const char *b)
+	{
+#ifdef _WIN32
+		return (_stricmp(a, b) == 0);
+#else
+		struct stat sa, sb;
+		if(stat(a, &sa) != 0 || stat(b, &sb) != 0) {
+			return false; }
+		return (sa.st_dev == sb.st_dev && sa.st_ino == sb.st_ino);
+#endif
+	}
+
+	//File io and header info
+	template<class Type> void ItlImage<Type>::readHeader(const char *file) throw(ImageException)
+	{
+		std::ifstream fin(file, std::ios::in | std::ios::binary);
+		if(!fin) {
+			throw ImageException((std::string("ItlImage::readHeader [Error reading header in ") + file) + "]"); }
+
+		ITL_HEADER header;
+		fin.read((char*)&header, sizeof(header));
+		if(!fin || std::char_traits<char>::compare(header.magic, "ITL1", 4) != 0) {
+			throw ImageException("ItlImage::readHeader [Invalid file format]"); }
+
+		if(header.byteOrder != 0x01020304) {
+			throw ImageException("ItlImage::readHeader [File was written with a different byte order]"); }
+
+		if(header.elementType != (uint32_t)itl_element_type<Type>::value || header.elementSize != sizeof(Type)) {
+			throw ImageException("ItlImage::readHeader [Pixel type of the file does not match the image]"); }
+
+		if(header.headerSize < sizeof(ITL_HEADER) || header.headerSize%header_size != 0 ||
+		   header.width < 0 || header.height < 0) {
+			throw ImageException("ItlImage::readHeader [Invalid file format]"); }
+
+		fin.seekg(0, std::ios::end);
+		std::istream::pos_type fileLength = fin.tellg();
+		if((double)fileLength < (double)header.headerSize + (double)header.width*header.height*sizeof(Type)) {
+			throw ImageException("ItlImage::readHeader [File is truncated]"); }
+
+		m_header = header;
+		this->m_headerLength = header.headerSize;
+		this->m_width  = header.width;
+		this->m_height = header.height;
+		this->m_depth  = header.depth;
+		this->m_edgeHandling = (edge_handling)header.edgeHandling;
+	}
+
+	template<class Type> void ItlImage<Type>::readData(const char *file) throw(ImageException)
+	{
+		// Release the old data first, the header has already replaced the dimensions
+		freeImage(this->m_image);
+		this->m_image = NULL;
+
+		size_t dataLength = (size_t)this->m_width*this->m_height*sizeof(Type);
+		size_t offset = (size_t)this->m_headerLength;
+
+		if(m_mapping == itl_heap || dataLength == 0)
+		{
+			m_mapping = itl_heap;
+			this->m_image = this->allocateImage();
+
+			std::ifstream fin(file, std::ios::in | std::ios::binary);
+			if(!fin) {
+				throw ImageException((std::string("ItlImage::readData [Error reading data in ") + file) + "]"); }
+
+			fin.seekg(this->m_headerLength);
+			fin.read((char*)this->m_image, dataLength);
+			if(!fin) {
+				throw ImageException((std::string("ItlImage::readData [Error reading data in ") + file) + "]"); }
+			return;
+		}
+
+#ifdef _WIN32
+		DWORD access = GENERIC_READ, protect = PAGE_READONLY, view = FILE_MAP_READ;
+		if(m_mapping == itl_copy_on_write)
+		{
+			protect = PAGE_WRITECOPY;
+			view    = FILE_MAP_COPY;
+		}
+		else if(m_mapping == itl_shared)
+		{
+			access |= GENERIC_WRITE;
+			protect = PAGE_READWRITE;
+			view    = FILE_MAP_WRITE;
+		}
+
+		HANDLE fileHandle = CreateFileA(file, access, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+		if(fileHandle == INVALID_HANDLE_VALUE) {
+			throw ImageException((std::string("ItlImage::readData [Error opening ") + file) + "]"); }
+
+		HANDLE mapHandle = CreateFileMappingA(fileHandle, NULL, protect, 0, 0, NULL);
+		CloseHandle(fileHandle);
+		if(mapHandle == NULL) {
+			throw ImageException((std::string("ItlImage::readData [Error mapping ") + file) + "]"); }
+
+		void *base = MapViewOfFile(mapHandle, view, 0, 0, offset + dataLength);
+		if(base == NULL)
+		{
+			CloseHandle(mapHandle);
+			throw ImageException((std::string("ItlImage::readData [Error mapping ") + file) + "]");
+		}
+		m_mapHandle = mapHandle;
+#else
+		int flags = O_RDONLY, prot = PROT_READ, share = MAP_SHARED;
+		if(m_mapping == itl_copy_on_write)
+		{
+			prot |= PROT_WRITE;
+			share = MAP_PRIVATE;
+		}
+		else if(m_mapping == itl_shared)
+		{
+			flags = O_RDWR;
+			prot |= PROT_WRITE;
+		}
+
+		int fd = open(file, flags);
+		if(fd < 0) {
+			throw ImageException((std::string("ItlImage::readData [Error opening ") + file) + "]"); }
+
+		void *base = mmap(NULL, offset + dataLength, prot, share, fd, 0);
+		close(fd);
+		if(base == MAP_FAILED) {
+			throw ImageException((std::string("ItlImage::readData [Error mapping ") + file) + "]"); }
+#endif
+
+		m_mapBase   = base;
+		m_mapLength = offset + dataLength;
+		m_mapFile   = file;
+		this->m_image = (Type*)((char*)base + offset);
+	}
+
+	template<class Type> void ItlImage<Type>::writeHeader(const char *file, const char *comment) throw(ImageException)
+	{
+		ITL_HEADER header;
+		memset(&header, 0, sizeof(header));
+		memcpy(header.magic, "ITL1", 4);
+		header.byteOrder    = 0x01020304;
+		header.headerSize   = header_size;
+		header.elementType  = itl_element_type<Type>::value;
+		header.elementSize  = sizeof(Type);
+		header.width        = this->m_width;
+		header.height       = this->m_height;
+		header.edgeHandling = this->m_edgeHandling;
+		header.depth        = this->m_depth;
+
+		std::ofstream fout(file, std::ios::out | std::ios::binary | std::ios::trunc);
+		if(!fout) {
+			throw ImageException((std::string("ItlImage::writeHeader [Error opening ") + file) + " for writing]"); }
+
+		fout.write((const char*)&header, sizeof(header));
+		if(!fout) {
+			throw ImageException((std::string("ItlImage::writeHeader [Error writing ") + file) + "]"); }
+	}
+
+	template<class Type> void ItlImage<Type>::writeData(const char *file) throw(ImageException)
+	{
+		size_t dataLength = (size_t)this->m_width*this->m_height*sizeof(Type);
+		if(dataLength == 0) {
+			return; }
+
+#ifdef _WIN32
+		std::ofstream fout(file, std::ios::out | std::ios::binary | std::ios::app);
+		if(!fout) {
+			throw ImageException((std::string("ItlImage::writeData [Error opening ") + file) + " for writing]"); }
+
+		fout.write((const char*)this->m_image, dataLength);
+		if(!fout) {
+			throw ImageException((std::string("ItlImage::writeData [Error writing ") + file) + "]"); }
+#else
+		// The file is extended to its final size and the data is copied
+		// straight into the page cache through a shared mapping
+		int fd = open(file, O_RDWR);
+		if(fd < 0) {
+			throw ImageException((std::string("ItlImage::writeData [Error opening ") + file) + " for writing]"); }
+
+		size_t fileLength = header_size + dataLength;
+		if(ftruncate(fd, (off_t)fileLength) != 0)
+		{
+			close(fd);
+			throw ImageException((std::string("ItlImage::writeData [Error resizing ") + file) + "]");
+		}
+
+		void *base = mmap(NULL, fileLength, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		close(fd);
+		if(base == MAP_FAILED) {
+			throw ImageException((std::string("ItlImage::writeData [Error mapping ") + file) + "]"); }
+
+		memcpy((char*)base + header_size, this->m_image, dataLength);
+		munmap(base, fileLength);
+#endif
+	}
+
+	template<class Type> void ItlImage<Type>::load(const char *file, itl_mapping mapping)
+	{
+		releaseMapping();
+		m_mapping = mapping;
+		this->read(file);
+	}
+
+	template<class Type> void ItlImage<Type>::save(const char *file)
+	{
+		if(m_mapBase != NULL && itl_same_file(file, m_mapFile.c_str()))
+		{
+			if(m_mapping == itl_shared)
+			{
+				sync();
+				return;
+			}
+
+			// The file is truncated before the data is written, so the data
+			// cannot be left in a mapping of it
+			moveToHeap();
+		}
+
+		writeHeader(file, "");
+		writeData(file);
+	}
+
+	template<class Type> void ItlImage<Type>::sync() throw(ImageException)
+	{
+		if(m_mapping != itl_shared || m_mapBase == NULL) {
+			return; }
+
+#ifdef _WIN32
+		if(!FlushViewOfFile(m_mapBase, m_mapLength)) {
+			throw ImageException("ItlImage::sync [Error flushing the mapped file]"); }
+#else
+		if(msync(m_mapBase, m_mapLength, MS_SYNC) != 0) {
+			throw ImageException("ItlImage::sync [Error flushing the mapped file]"); }
+#endif
+	}
+
+	// Memory management
+	template<class Type> void ItlImage<Type>::initMapping()
+	{
+		m_mapping   = itl_heap;
+		m_mapBase   = NULL;
+		m_mapLength = 0;
+		m_mapHandle = NULL;
+		memset(&m_header, 0, sizeof(m_header));
+	}
+
+	template<class Type> void ItlImage<Type>::releaseMapping()
+	{
+		if(m_mapBase == NULL) {
+			return; }
+
+#ifdef _WIN32
+		UnmapViewOfFile(m_mapBase);
+		CloseHandle((HANDLE)m_mapHandle);
+#else
+		munmap(m_mapBase, m_mapLength);
+#endif
+
+		if(this->m_image >= (Type*)m_mapBase && (char*)this->m_image < (char*)m_mapBase + m_mapLength) {
+			this->m_image = NULL; }
+
+		m_mapping   = itl_heap;
+		m_mapBase   = NULL;
+		m_mapLength = 0;
+		m_mapHandle = NULL;
+		m_mapFile.clear();
+	}
+
+	template<class Type> void ItlImage<Type>::freeImage(Type *im)
+	{
+		if(m_mapBase != NULL && im == this->m_image) {
+			releaseMapping(); }
+		else {
+			Image<Type>::freeImage(im); }
+	}
+
+	// Moves read-only mapped data to the heap before it is overwritten
+	template<class Type> void ItlImage<Type>::makeWritable()
+	{
+		if(m_mapping == itl_read_only) {
+			moveToHeap(); }
+	}
+
+	template<class Type> void ItlImage<Type>::moveToHeap()
+	{
+		if(m_mapBase == NULL) {
+			return; }
+
+		Type *heap = this->allocateImage();
+		this->copyImage(heap, this->m_image);
+		releaseMapping();
+		this->m_image = heap;
+	}
+
+	template<class Type> ItlImage<Type>::~ItlImage()
+	{
+		// The base destructor can only release heap memory
+		releaseMapping();
+	}
+
+	// Operators
+	template<class Type> ItlImage<Type>& ItlImage<Type>::operator=(const Image<Type>& im)
+	{
+		makeWritable();
+		Image<Type>::operator=(im);
+
+		return *this;
+	}
+
+	template<class Type> ItlImage<Type>& ItlImage<Type>::operator=(const ImageIO<Type>& im)
+	{
+		makeWritable();
+		ImageIO<Type>::operator=(im);
+
+		return *this;
+	}
+
+	template<class Type> ItlImage<Type>& ItlImage<Type>::operator=(const ItlImage<Type>& im)
+	{
+		makeWritable();
+		ImageIO<Type>::operator=(im);
+
+		return *this;
+	}
+
+	template<class Type> ItlImage<Type>& ItlImage<Type>::operator=(Type n)
+	{
+		makeWritable();
+		Image<Type>::operator=(n);
+
+		return *this;
+	}
+}	//End namespace
+
+// Instantiate with common template types for library compilation
+#ifdef IMAGETL_LIBRARY_COMPILE
+namespace ImageTL
+{
+	template class ItlImage<char>;
+	template class ItlImage<unsigned char>;
+	template class ItlImage<short>;
+	template class ItlImage<unsigned short>;
+	template class ItlImage<int>;
+	template class ItlImage<long>;
+	template class ItlImage<float>;
+	template class ItlImage<double>;
+}
+#endif
+
+#endif
\ No newline at end of file
@@ -0,0 +1,159 @@
+#ifndef __ITLIMAGE_H__
+#define __ITLIMAGE_H__
+/** @file ItlImage.h
+	Contains the native binary image container of the library.
+	An .itl file stores an Image exactly as it is held in memory, so it can be
+	used for lossless checkpoints of intermediate results.  The file consists of
+	a 64 byte header followed by the raw pixel data, which starts on a 64 byte
+	boundary so that the data can be mapped straight into memory.
+*/
+
+// Disable warnings about ignoring throws declarations
+#pragma warning( disable : 4290 )
+
+#include <string>
+#include <complex>
+#include <stdint.h>
+#include "ImageIO.h"
+
+namespace ImageTL
+{
+	/** Definitions used to specify how the pixel data of an .itl file is
+		attached to an ItlImage when it is read.
+		@see ItlImage::load()
+	*/
+	enum itl_mapping
+	{
+		itl_heap,			/*!< The data is read into memory allocated with
+							allocateImage().  The file is not used after the
+							read.*/
+		itl_read_only,		/*!< The file is mapped read-only.  Writing to the
+							image will cause an access violation, so only use
+							this for images that are never modified.*/
+		itl_copy_on_write,	/*!< The file is mapped privately.  Pages are only
+							copied by the operating system when they are
+							written to, and the changes never reach the file.*/
+		itl_shared			/*!< The file is mapped shared and writable.  Any
+							change to the image is written back to the file.
+							@see ItlImage::sync()*/
+	};
+
+	/** Codes used in the .itl header to identify the type of each pixel.
+		Files are only read into an ItlImage with the matching type.
+	*/
+	template<class Type> struct itl_element_type { enum { value = 0 }; };
+	template<> struct itl_element_type<char>   { enum { value = 1 }; };
+	template<> struct itl_element_type<short>  { enum { value = 2 }; };
+	template<> struct itl_element_type<int>    { enum { value = 3 }; };
+	template<> struct itl_element_type<long>   { enum { value = 4 }; };
+	template<> struct itl_element_type<float>  { enum { value = 5 }; };
+	template<> struct itl_element_type<double> { enum { value = 6 }; };
+	template<> struct itl_element_type<std::complex<double> > { enum { value = 7 }; };
+	template<> struct itl_element_type<unsigned char>  { enum { value = 8 }; };
+	template<> struct itl_element_type<unsigned short> { enum { value = 9 }; };
+
+	/** @class ItlImage
+		Reads and writes the native .itl format.
+		Unlike PgmImage and BmpImage, the pixel values are stored without any
+		quantisation, so an image read back from a file is identical to the
+		image that was written.  When an image is read, the pixel data can be
+		mapped into memory instead of being copied (see itl_mapping), which
+		makes reading a large checkpoint almost free.
+
+		@note ImageIO::write() always prepares the image for an integer depth
+			before writing it.  Use save() to write the image without altering
+			it.
+	*/
+	template<class Type> class ItlImage : public ImageIO<Type>
+	{
+	public:
+		/** Layout of the header at the start of every .itl file.
+			All fields are written in the byte order of the machine that wrote
+			the file, which is identified by byteOrder.
+		*/
+		struct ITL_HEADER
+		{
+			char     magic[4];		///< Always "ITL1".
+			uint32_t byteOrder;		///< Always 0x01020304 in the byte order of the writer.
+			uint32_t headerSize;	///< The offset of the pixel data from the start of the file.
+			uint32_t elementType;	///< One of the itl_element_type codes.
+			uint32_t elementSize;	///< sizeof(Type) for the writer.
+			int32_t  width;			///< The width of the image.
+			int32_t  height;		///< The height of the image.
+			int32_t  edgeHandling;	///< The edge_handling of the image.
+			int32_t  depth;			///< The depth used when the image is written to a quantised format.
+			uint32_t reserved[7];	///< Padding to headerSize, must be zero.
+		};
+
+		enum { header_size = 64 };	///< The size of the header and the alignment of the pixel data.
+
+		// File io
+		void readHeader(const char *file) throw(ImageException);
+
+		/** Reads <i>file</i>, attaching the pixel data as specified by
+			<i>mapping</i>.
+			@see itl_mapping
+		*/
+		void load(const char *file, itl_mapping mapping = itl_copy_on_write);
+
+		/** Writes the image to <i>file</i> without altering the pixel data.
+			If the image is mapped with itl_shared from the same file, the
+			mapping is simply flushed with sync().  If it is mapped from the
+			same file in any other mode, the data is first moved to the heap.
+		*/
+		void save(const char *file);
+
+		/** Flushes the changes made to an itl_shared mapping to disk.
+			Nothing is done for the other mapping modes.
+		*/
+		void sync() throw(ImageException);
+
+		/** Returns how the pixel data is currently attached to the image.
+			Any operation that changes the image dimensions moves the data to
+			the heap.
+		*/
+		itl_mapping mapping() const { return m_mapping; }
+
+		// Constructors/Destructor
+		ItlImage() : ImageIO<Type>() { initMapping(); }
+		ItlImage(const ItlImage &i, bool copy = true) : ImageIO<Type>(i, copy) { initMapping(); }
+		ItlImage(const ImageIO<Type> &i, bool copy = true) : ImageIO<Type>(i, copy) { initMapping(); }
+		ItlImage(const char *file, itl_mapping mapping = itl_copy_on_write) : ImageIO<Type>() { initMapping(); load(file, mapping); }
+		ItlImage(int w, int h, int d = 255) : ImageIO<Type>(w, h, d) { initMapping(); }
+		ItlImage(const Image<Type> &i, bool copy = true, int d = 255) : ImageIO<Type>(i, copy, d) { initMapping(); }
+		~ItlImage();
+
+		// Operators (= operator is not inherited)
+		ItlImage& operator=(const Image<Type>&);
+		ItlImage& operator=(const ImageIO<Type>&);
+		ItlImage& operator=(const ItlImage&);
+		ItlImage& operator=(Type);
+
+	protected:
+		// File io
+		void readData(const char *file) throw(ImageException);
+		void writeHeader(const char *file, const char *comment) throw(ImageException);
+		void writeData(const char *file) throw(ImageException);
+
+		// Memory management of mapped data
+		void freeImage(Type *im);
+		void initMapping();
+		void releaseMapping();
+		void makeWritable();
+		void moveToHeap();
+
+		itl_mapping m_mapping;			///< How m_image is attached to the image.
+		void*       m_mapBase;			///< The start of the mapped file or NULL if the data is on the heap.
+		size_t      m_mapLength;		///< The number of bytes mapped at m_mapBase.
+		void*       m_mapHandle;		///< The platform handle of the mapping (only used on Windows).
+		std::string m_mapFile;			///< The file backing the mapping.
+		ITL_HEADER  m_header;			///< The header of the last file read.
+	};
+}	// End namespace
+
+// Include the function definitions in the header if we aren't using a compiled library
+#ifdef IMAGETL_NO_LIBRARY
+#include "ItlImage.cpp"
+#endif
+
+#endif
\ No newline at end of file
@@ -0,0 +1,478 @@
+#ifndef __LAZYIMAGE_CPP__
+#define __LAZYIMAGE_CPP__
+/** @file LazyImage.cpp
+	Contains function definitions that are declared in LazyImage.h
+*/
+
+#include "LazyImage.h"
+
+namespace ImageTL
+{
+	// The number of pixels of a row that a fused pass computes at a time
+	static const int lazy_span = 256;
+
+	// Constructors
+	template<class Type> LazyImage<Type>::LazyImage(const Image<Type> &im) : m_node(new lazy_node<Type>)
+	{
+		m_node->op     = lazy_source;
+		m_node->image  = &im;
+		m_node->width  = im.width();
+		m_node->height = im.height();
+		m_node->edgeHandling = im.edgeHandling();
+	}
+
+	template<class Type> LazyImage<Type> LazyImage<Type>::constant(const Type &value)
+	{
+		node_pointer node(new lazy_node<Type>);
+		node->op    = lazy_constant;
+		node->value = value;
+		return LazyImage<Type>(node);
+	}
+
+	// Graph building
+	template<class Type> LazyImage<Type> LazyImage<Type>::binary(lazy_op op, const LazyImage<Type> &right, const char *name) const
+	{
+		const lazy_node<Type> &l = *m_node, &r = *right.m_node;
+		if(l.width >= 0 && r.width >= 0 && (l.width != r.width || l.height != r.height))
+		{
+			std::stringstream msg_stream;
+			msg_stream<<"LazyImage::operator"<<name<<" [Unmatched dimensions for operator]";
+			throw ImageException(msg_stream.str());
+		}
+
+		// The result takes its dimensions and edge handling from the first image
+		const lazy_node<Type> &shape = (l.width >= 0)?l:r;
+		node_pointer node(new lazy_node<Type>);
+		node->op     = op;
+		node->left   = m_node;
+		node->right  = right.m_node;
+		node->width  = shape.width;
+		node->height = shape.height;
+		node->edgeHandling = shape.edgeHandling;
+		return LazyImage<Type>(node);
+	}
+
+	template<class Type> LazyImage<Type> LazyImage<Type>::convolution(lazy_op op, const Type *coeff, int tWidth, int tHeight) const
+	{
+		if(m_node->width < 0) {
+			throw ImageException("LazyImage::convolution [A constant cannot be convolved]"); }
+
+		node_pointer node(new lazy_node<Type>);
+		node->op      = op;
+		node->left    = m_node;
+		node->coeff.assign(coeff, coeff + tWidth*tHeight);
+		node->tWidth  = tWidth;
+		node->tHeight = tHeight;
+		node->width   = m_node->width;
+		node->height  = m_node->height;
+		node->edgeHandling = m_node->edgeHandling;
+		return LazyImage<Type>(node);
+	}
+
+	template<class Type> LazyImage<Type> LazyImage<Type>::convolution(lazy_op op, Template<Type> &tem) const
+	{
+		if(tem.coefficients() != NULL) {
+			return convolution(op, tem.coefficients(), tem.width(), tem.height()); }
+
+		LazyImage<Type> result = convolution(op, (const Type*)NULL, 0, 0);
+		result.m_node->tem     = &tem;
+		result.m_node->tWidth  = tem.width();
+		result.m_node->tHeight = tem.height();
+		return result;
+	}
+
+	template<class Type> LazyImage<Type> LazyImage<Type>::apply(Type (*func)(Type)) const
+	{
+		if(m_node->width < 0) {
+			throw ImageException("LazyImage::apply [A function cannot be applied to a constant]"); }
+
+		node_pointer node(new lazy_node<Type>);
+		node->op     = lazy_unary;
+		node->left   = m_node;
+		node->func   = func;
+		node->width  = m_node->width;
+		node->height = m_node->height;
+		node->edgeHandling = m_node->edgeHandling;
+		return LazyImage<Type>(node);
+	}
+
+	template<class Type> LazyImage<Type> LazyImage<Type>::operator+ (const LazyImage<Type> &right) const { return binary(lazy_add,           right, "+"); }
+	template<class Type> LazyImage<Type> LazyImage<Type>::operator- (const LazyImage<Type> &right) const { return binary(lazy_sub,           right, "-"); }
+	template<class Type> LazyImage<Type> LazyImage<Type>::operator* (const LazyImage<Type> &right) const { return binary(lazy_mul,           right, "*"); }
+	template<class Type> LazyImage<Type> LazyImage<Type>::operator/ (const LazyImage<Type> &right) const { return binary(lazy_div,           right, "/"); }
+	template<class Type> LazyImage<Type> LazyImage<Type>::operator| (const LazyImage<Type> &right) const { return binary(lazy_max,           right, "|"); }
+	template<class Type> LazyImage<Type> LazyImage<Type>::operator& (const LazyImage<Type> &right) const { return binary(lazy_min,           right, "&"); }
+	template<class Type> LazyImage<Type> LazyImage<Type>::operator< (const LazyImage<Type> &right) const { return binary(lazy_less,          right, "<"); }
+	template<class Type> LazyImage<Type> LazyImage<Type>::operator<=(const LazyImage<Type> &right) const { return binary(lazy_less_equal,    right, "<="); }
+	template<class Type> LazyImage<Type> LazyImage<Type>::operator> (const LazyImage<Type> &right) const { return binary(lazy_greater,       right, ">"); }
+	template<class Type> LazyImage<Type> LazyImage<Type>::operator>=(const LazyImage<Type> &right) const { return binary(lazy_greater_equal, right, ">="); }
+
+	template<class Type> LazyImage<Type> LazyImage<Type>::operator+(Template<Type> &right) const { return convolution(lazy_convolve_sum, right); }
+	template<class Type> LazyImage<Type> LazyImage<Type>::operator|(Template<Type> &right) const { return convolution(lazy_convolve_max, right); }
+	template<class Type> LazyImage<Type> LazyImage<Type>::operator&(Template<Type> &right) const { return convolution(lazy_convolve_min, right); }
+
+	// ***** Planning *****
+	// The graph with identical nodes merged, in an order where every node
+	// comes after its operands
+	template<class Type> struct lazy_plan
+	{
+		std::vector<const lazy_node<Type>*> nodes;
+		std::vector<int> left, right;
+		std::vector<int> uses;				// The number of nodes that read each node
+		std::vector<char> stored;			// Whether the node is kept as an image
+		std::vector<int> slot;				// The scratch span of a fused node
+		std::vector<int> lastUse;			// The last stage that reads a stored node
+		std::vector<const Image<Type>*> images;
+	};
+
+	static inline bool lazy_is_convolution(lazy_op op)
+	{
+		return op == lazy_convolve_sum || op == lazy_convolve_max || op == lazy_convolve_min;
+	}
+
+	template<class Type> static bool lazy_same(const lazy_plan<Type> &plan, int index, const lazy_node<Type> &node, int left, int right)
+	{
+		const lazy_node<Type> &other = *plan.nodes[index];
+		if(other.op != node.op || plan.left[index] != left || plan.right[index] != right) {
+			return false; }
+
+		switch(node.op)
+		{
+		case lazy_source:   return other.image == node.image;
+		case lazy_constant: return other.value == node.value;
+		case lazy_unary:    return other.func  == node.func;
+		case lazy_convolve_sum:
+		case lazy_convolve_max:
+		case lazy_convolve_min:
+			return other.tem == node.tem && other.tWidth == node.tWidth && other.tHeight == node.tHeight && other.coeff == node.coeff;
+		default:
+			return true;
+		}
+	}
+
+	// Adds a node and its operands to the plan, merging it with an identical
+	// node if there is one
+	template<class Type> static int lazy_intern(lazy_plan<Type> &plan, const lazy_node<Type> *node, std::vector<std::pair<const lazy_node<Type>*, int> > &seen)
+	{
+		for(size_t i = 0; i < seen.size(); i++) {
+			if(seen[i].first == node) {
+				return seen[i].second; } }
+
+		int left  = node->left  ? lazy_intern(plan, node->left.get(),  seen) : -1;
+		int right = node->right ? lazy_intern(plan, node->right.get(), seen) : -1;
+
+		// Operands of commutative operations are put in a fixed order
+		lazy_op op = node->op;
+		if((op == lazy_add || op == lazy_mul || op == lazy_max || op == lazy_min) && right < left)
+		{
+			int temp = left;
+			left  = right;
+			right = temp;
+		}
+
+		int index = -1;
+		for(int i = 0; i < (int)plan.nodes.size() && index < 0; i++) {
+			if(lazy_same(plan, i, *node, left, right)) {
+				index = i; } }
+
+		if(index < 0)
+		{
+			index = (int)plan.nodes.size();
+			plan.nodes.push_back(node);
+			plan.left.push_back(left);
+			plan.right.push_back(right);
+		}
+
+		seen.push_back(std::make_pair(node, index));
+		return index;
+	}
+
+	// Marks the stored operands read by the fused pass that computes
+	// <index>, and gives every fused node a scratch span
+	template<class Type> static void lazy_mark_reads(lazy_plan<Type> &plan, int index, int stage, int &slots)
+	{
+		const int operands[2] = {plan.left[index], plan.right[index]};
+		for(int k = 0; k < 2; k++)
+		{
+			int operand = operands[k];
+			if(operand < 0) {
+				continue; }
+
+			if(plan.stored[operand]) {
+				plan.lastUse[operand] = stage; }
+			else
+			{
+				plan.slot[operand] = slots++;
+				lazy_mark_reads(plan, operand, stage, slots);
+			}
+		}
+	}
+
+	// ***** Evaluation *****
+	// Computes the pixels [x, x + n) of row y of a convolution of src
+	template<class Type, class Policy> static void lazy_convolve_span(const Image<Type> &src, const lazy_node<Type> &node, const Policy &policy,
+																	 int y, int x, int n, Type *dest)
+	{
+		typedef typename Policy::accumulator accumulator;
+
+		const int width  = src.width(),  height  = src.height();
+		const int tWidth = node.tWidth,  tHeight = node.tHeight;
+		const int negX = (tWidth - 1)/2,  posX = tWidth/2;
+		const int negY = (tHeight - 1)/2, posY = tHeight/2;
+		const Type *coeff = &node.coeff[0];
+
+		// The pixels whose neighbourhoods lie inside the image
+		int ix0 = x, ix1 = x;
+		if(y >= negY && y + posY < height)
+		{
+			ix0 = (negX > x)?negX:x;
+			ix0 = (ix0 < x + n)?ix0:(x + n);
+			ix1 = (width - posX < x + n)?(width - posX):(x + n);
+			ix1 = (ix1 > ix0)?ix1:ix0;
+		}
+
+		if(ix1 > ix0)
+		{
+			accumulator acc[lazy_span];
+			const int count = ix1 - ix0;
+			for(int i = 0; i < count; i++) {
+				acc[i] = policy.init(); }
+			for(int ty = 0; ty < tHeight; ty++)
+			{
+				const Type *s = src.data() + (size_t)width*(y - negY + ty) + (ix0 - negX);
+				for(int tx = 0; tx < tWidth; tx++, s++)
+				{
+					const Type c = coeff[tx + tWidth*ty];
+					for(int i = 0; i < count; i++) {
+						policy.reduce(acc[i], policy.merge(s[i], c)); }
+				}
+			}
+			for(int i = 0; i < count; i++) {
+				dest[ix0 - x + i] = policy.result(acc[i], tWidth*tHeight); }
+		}
+
+		// Bounds checked pixels
+		auto border = [&](int px)
+		{
+			accumulator acc = policy.init();
+			int taps = 0;
+			Type value;
+			for(int ty = 0; ty < tHeight; ty++)
+			{
+				for(int tx = 0; tx < tWidth; tx++)
+				{
+					if(!src.tryGetPixel(px - negX + tx, y - negY + ty, value)) {
+						continue; }
+					policy.reduce(acc, policy.merge(value, coeff[tx + tWidth*ty]));
+					taps++;
+				}
+			}
+			dest[px - x] = policy.result(acc, taps);
+		};
+		for(int px = x; px < ix0; px++) {
+			border(px); }
+		for(int px = ix1; px < x + n; px++) {
+			border(px); }
+	}
+
+	// Computes the pixels [x, x + n) of row y of node <index>, returning a
+	// pointer to them.  Stored nodes other than the root of the pass are
+	// read from their images.
+	template<class Type> static const Type* lazy_evaluate_span(const lazy_plan<Type> &plan, int index, int root, Type *rootRow,
+															  int y, int x, int n, Type *scratch)
+	{
+		if(plan.stored[index] && index != root) {
+			return plan.images[index]->data() + (size_t)plan.images[index]->width()*y + x; }
+
+		const lazy_node<Type> &node = *plan.nodes[index];
+		Type *dest = (index == root)?rootRow:(scratch + (size_t)plan.slot[index]*lazy_span);
+
+		switch(node.op)
+		{
+		case lazy_constant:
+			for(int i = 0; i < n; i++) {
+				dest[i] = node.value; }
+			return dest;
+
+		case lazy_unary:
+		{
+			const Type *a = lazy_evaluate_span(plan, plan.left[index], root, rootRow, y, x, n, scratch);
+			for(int i = 0; i < n; i++) {
+				dest[i] = node.func(a[i]); }
+			return dest;
+		}
+
+		case lazy_convolve_sum:
+			lazy_convolve_span(*plan.images[plan.left[index]], node, MulSumPolicy<Type>(), y, x, n, dest);
+			return dest;
+		case lazy_convolve_max:
+			lazy_convolve_span(*plan.images[plan.left[index]], node, MulMaxPolicy<Type>(), y, x, n, dest);
+			return dest;
+		case lazy_convolve_min:
+			lazy_convolve_span(*plan.images[plan.left[index]], node, MulMinPolicy<Type>(), y, x, n, dest);
+			return dest;
+
+		default:
+			break;
+		}
+
+		const Type *a = lazy_evaluate_span(plan, plan.left[index],  root, rootRow, y, x, n, scratch);
+		const Type *b = lazy_evaluate_span(plan, plan.right[index], root, rootRow, y, x, n, scratch);
+		switch(node.op)
+		{
+		case lazy_add:           for(int i = 0; i < n; i++) { dest[i] = a[i] + b[i]; } break;
+		case lazy_sub:           for(int i = 0; i < n; i++) { dest[i] = a[i] - b[i]; } break;
+		case lazy_mul:           for(int i = 0; i < n; i++) { dest[i] = a[i] * b[i]; } break;
+		case lazy_div:           for(int i = 0; i < n; i++) { dest[i] = (b[i] != Type(0))?Type(a[i]/b[i]):Type(0); } break;
+		case lazy_max:           for(int i = 0; i < n; i++) { dest[i] = (a[i] < b[i])?b[i]:a[i]; } break;
+		case lazy_min:           for(int i = 0; i < n; i++) { dest[i] = (a[i] > b[i])?b[i]:a[i]; } break;
+		case lazy_less:          for(int i = 0; i < n; i++) { dest[i] = Type((a[i] <  b[i])?1:0); } break;
+		case lazy_less_equal:    for(int i = 0; i < n; i++) { dest[i] = Type((a[i] <= b[i])?1:0); } break;
+		case lazy_greater:       for(int i = 0; i < n; i++) { dest[i] = Type((a[i] >  b[i])?1:0); } break;
+		case lazy_greater_equal: for(int i = 0; i < n; i++) { dest[i] = Type((a[i] >= b[i])?1:0); } break;
+		default:
+			throw ImageException("LazyImage::evaluate [Unknown operation]");
+		}
+		return dest;
+	}
+
+	template<class Type> Image<Type> LazyImage<Type>::evaluate() const
+	{
+		if(m_node->width < 0) {
+			throw ImageException("LazyImage::evaluate [The expression does not contain an image]"); }
+
+		// *** Merge identical subexpressions
+		lazy_plan<Type> plan;
+		std::vector<std::pair<const lazy_node<Type>*, int> > seen;
+		const int root = lazy_intern(plan, m_node.get(), seen);
+		const int count = (int)plan.nodes.size();
+		if(plan.nodes[root]->op == lazy_source) {
+			return *plan.nodes[root]->image; }
+
+		// *** Decide which nodes are stored as images
+		plan.uses.assign(count, 0);
+		plan.stored.assign(count, 0);
+		plan.slot.assign(count, -1);
+		plan.lastUse.assign(count, -1);
+		plan.images.assign(count, (const Image<Type>*)NULL);
+		for(int i = 0; i < count; i++)
+		{
+			if(plan.left[i]  >= 0) { plan.uses[plan.left[i]]++; }
+			if(plan.right[i] >= 0) { plan.uses[plan.right[i]]++; }
+		}
+		for(int i = 0; i < count; i++)
+		{
+			lazy_op op = plan.nodes[i]->op;
+			if(op == lazy_constant) {
+				continue; }
+
+			if(op == lazy_source || i == root || plan.uses[i] > 1 || (lazy_is_convolution(op) && plan.nodes[i]->tem != NULL)) {
+				plan.stored[i] = 1; }
+			if(lazy_is_convolution(op)) {
+				plan.stored[plan.left[i]] = 1; }
+		}
+
+		// *** Each stored node other than a source is computed by one stage
+		std::vector<int> stages, slots;
+		for(int i = 0; i < count; i++)
+		{
+			if(!plan.stored[i] || plan.nodes[i]->op == lazy_source) {
+				continue; }
+
+			int stage = (int)stages.size(), stageSlots = 0;
+			stages.push_back(i);
+			if(plan.nodes[i]->tem != NULL) {
+				plan.lastUse[plan.left[i]] = stage; }
+			else {
+				lazy_mark_reads(plan, i, stage, stageSlots); }
+			slots.push_back(stageSlots);
+		}
+
+		// *** Run the stages, reusing images once they are no longer read
+		const int width = m_node->width, height = m_node->height;
+		Image<Type> result(width, height, m_node->edgeHandling);
+		std::vector<std::unique_ptr<Image<Type> > > buffers;
+		std::vector<Image<Type>*> pool;
+		std::vector<Image<Type>*> owned(count, (Image<Type>*)NULL);
+
+		for(int i = 0; i < count; i++) {
+			if(plan.nodes[i]->op == lazy_source) {
+				plan.images[i] = plan.nodes[i]->image; } }
+
+		for(int stage = 0; stage < (int)stages.size(); stage++)
+		{
+			const int index = stages[stage];
+			const lazy_node<Type> &node = *plan.nodes[index];
+
+			Image<Type> *image = &result;
+			if(index != root)
+			{
+				if(pool.empty())
+				{
+					buffers.push_back(std::unique_ptr<Image<Type> >(new Image<Type>(width, height, node.edgeHandling)));
+					pool.push_back(buffers.back().get());
+				}
+				image = pool.back();
+				pool.pop_back();
+				image->edgeHandling() = node.edgeHandling;
+				owned[index] = image;
+			}
+			plan.images[index] = image;
+
+			if(node.tem != NULL)
+			{
+				const Image<Type> &src = *plan.images[plan.left[index]];
+				if(node.op == lazy_convolve_sum) {
+					convolve(src, *node.tem, MulSumPolicy<Type>(), *image); }
+				else if(node.op == lazy_convolve_max) {
+					convolve(src, *node.tem, MulMaxPolicy<Type>(), *image); }
+				else {
+					convolve(src, *node.tem, MulMinPolicy<Type>(), *image); }
+			}
+			else
+			{
+				const int stageSlots = slots[stage];
+				Type *out = image->data();
+				parallelFor(0, height, [&](int first, int last)
+				{
+					std::vector<Type> scratch((size_t)(stageSlots + 1)*lazy_span);
+					for(int y = first; y < last; y++)
+					{
+						for(int x = 0; x < width; x += lazy_span)
+						{
+							int n = (x + lazy_span < width)?lazy_span:(width - x);
+							lazy_evaluate_span(plan, index, index, out + (size_t)width*y + x, y, x, n, &scratch[0]);
+						}
+					}
+				}, (width < 16384)?(16384/width + 1):1);
+			}
+
+			// Release the images that no later stage reads
+			for(int i = 0; i < count; i++) {
+				if(owned[i] != NULL && plan.lastUse[i] == stage)
+				{
+					pool.push_back(owned[i]);
+					owned[i] = NULL;
+				} }
+		}
+
+		return result;
+	}
+}	//End namespace
+
+// Instantiate with common template types for library compilation
+#ifdef IMAGETL_LIBRARY_COMPILE
+namespace ImageTL
+{
+	template class LazyImage<char>;
+	template class LazyImage<unsigned char>;
+	template class LazyImage<short>;
+	template class LazyImage<unsigned short>;
+	template class LazyImage<int>;
+	template class LazyImage<long>;
+	template class LazyImage<float>;
+	template class LazyImage<double>;
+}
+#endif
+
+#endif
\ No newline at end of file
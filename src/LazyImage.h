@@ -0,0 +1,168 @@
+#ifndef __LAZYIMAGE_H__
+#define __LAZYIMAGE_H__
+/** @file LazyImage.h
+	Contains the LazyImage class, which records operations on images as a
+	graph and evaluates the whole graph at once when the result is needed.
+*/
+
+#include <memory>
+#include <vector>
+#include "Image.h"
+
+namespace ImageTL
+{
+	/** The operations of a node in the graph of a LazyImage. */
+	enum lazy_op
+	{
+		lazy_source,			///< An Image.
+		lazy_constant,			///< The same value at every pixel.
+		lazy_add,				///< Pixel-wise addition.
+		lazy_sub,				///< Pixel-wise subtraction.
+		lazy_mul,				///< Pixel-wise multiplication.
+		lazy_div,				///< Pixel-wise division, where division by zero gives zero.
+		lazy_max,				///< Pixel-wise maximum.
+		lazy_min,				///< Pixel-wise minimum.
+		lazy_less,				///< Less than characteristic function.
+		lazy_less_equal,		///< Less than or equal to characteristic function.
+		lazy_greater,			///< Greater than characteristic function.
+		lazy_greater_equal,		///< Greater than or equal to characteristic function.
+		lazy_unary,				///< A function of each pixel.
+		lazy_convolve_sum,		///< Linear convolution product.
+		lazy_convolve_max,		///< Multiplicative maximum convolution product.
+		lazy_convolve_min		///< Multiplicative minimum convolution product.
+	};
+
+	/** @class lazy_node
+		A node in the graph of a LazyImage.
+		Nodes are shared between the LazyImage objects that were built from
+		them, and are never changed once they are made.
+	*/
+	template<class Type> struct lazy_node
+	{
+		lazy_op op;								///< The operation of the node.
+		std::shared_ptr<lazy_node> left;		///< The first operand.
+		std::shared_ptr<lazy_node> right;		///< The second operand.
+		Type value;								///< The value of a constant.
+		const Image<Type> *image;				///< The image of a source.
+		Type (*func)(Type);						///< The function of a unary node.
+		Template<Type> *tem;					///< The template of a convolution that has no coefficients.
+		std::vector<Type> coeff;				///< The coefficients of a convolution.
+		int tWidth;								///< The width of the template of a convolution.
+		int tHeight;							///< The height of the template of a convolution.
+		int width;								///< The width of the result, or -1 for a constant.
+		int height;								///< The height of the result, or -1 for a constant.
+		edge_handling edgeHandling;				///< The edge handling of the result.
+
+		lazy_node() : op(lazy_constant), value(), image(NULL), func(NULL), tem(NULL), tWidth(0), tHeight(0),
+					  width(-1), height(-1), edgeHandling(edge_skip) {}
+	};
+
+	/** @class LazyImage
+		An image expression that is evaluated when it is assigned to an Image.
+		Operations on a LazyImage build a graph instead of computing a new
+		image for every step.  When the result is converted to an Image, the
+		graph is planned and evaluated at once:
+		- Identical subexpressions are found and computed once.
+		- Chains of pixel-wise operations, and the convolutions they read, are
+		  fused into a single pass that works on short spans of a row, so
+		  their intermediate results never become full images.
+		- Only nodes that are read by a convolution or by more than one
+		  consumer are stored, and their images are reused once their last
+		  consumer has run.
+		- Each pass runs on bands of rows in parallel.
+
+		The images that a LazyImage was built from must not change or be
+		destroyed until it is evaluated.
+		@code
+		LazyImage<double> c1 = lazy(input) > 0.;
+		Image<double> d1 = (c1 | fixed_moore) & (1. - c1);
+		@endcode
+	*/
+	template<class Type> class LazyImage
+	{
+	public:
+		typedef std::shared_ptr<lazy_node<Type> > node_pointer;	///< A pointer to a node of the graph.
+
+		LazyImage(const Image<Type> &im);		///< Makes a source of the graph from an image.
+
+		/** Makes an expression that has the same value at every pixel.
+			A constant takes its dimensions from the images it is combined
+			with.
+		*/
+		static LazyImage constant(const Type &value);
+
+		int width()  const { return m_node->width; }	///< Returns the width of the result, or -1 for a constant.
+		int height() const { return m_node->height; }	///< Returns the height of the result, or -1 for a constant.
+		const node_pointer& node() const { return m_node; }	///< Returns the root node of the graph.
+
+		/** Plans and evaluates the graph.
+			@return The resulting image.
+		*/
+		Image<Type> evaluate() const;
+		operator Image<Type>() const { return evaluate(); }	///< Evaluates the graph.
+
+		LazyImage apply(Type (*func)(Type)) const;			///< Applies <i>func</i> to each pixel.
+
+		LazyImage operator+(const LazyImage &right) const;	///< Pixel-wise addition.
+		LazyImage operator-(const LazyImage &right) const;	///< Pixel-wise subtraction.
+		LazyImage operator*(const LazyImage &right) const;	///< Pixel-wise multiplication.
+		LazyImage operator/(const LazyImage &right) const;	///< Pixel-wise division.
+		LazyImage operator|(const LazyImage &right) const;	///< Pixel-wise maximum.
+		LazyImage operator&(const LazyImage &right) const;	///< Pixel-wise minimum.
+		LazyImage operator< (const LazyImage &right) const;	///< Less than characteristic function.
+		LazyImage operator<=(const LazyImage &right) const;	///< Less than or equal to characteristic function.
+		LazyImage operator> (const LazyImage &right) const;	///< Greater than characteristic function.
+		LazyImage operator>=(const LazyImage &right) const;	///< Greater than or equal to characteristic function.
+
+		LazyImage operator+(const Type &right) const { return *this +  constant(right); }	///< Pixel-wise addition.
+		LazyImage operator-(const Type &right) const { return *this -  constant(right); }	///< Pixel-wise subtraction.
+		LazyImage operator*(const Type &right) const { return *this *  constant(right); }	///< Pixel-wise multiplication.
+		LazyImage operator/(const Type &right) const { return *this /  constant(right); }	///< Pixel-wise division.
+		LazyImage operator|(const Type &right) const { return *this |  constant(right); }	///< Pixel-wise maximum.
+		LazyImage operator&(const Type &right) const { return *this &  constant(right); }	///< Pixel-wise minimum.
+		LazyImage operator< (const Type &right) const { return *this <  constant(right); }	///< Less than characteristic function.
+		LazyImage operator<=(const Type &right) const { return *this <= constant(right); }	///< Less than or equal to characteristic function.
+		LazyImage operator> (const Type &right) const { return *this >  constant(right); }	///< Greater than characteristic function.
+		LazyImage operator>=(const Type &right) const { return *this >= constant(right); }	///< Greater than or equal to characteristic function.
+
+		// Template Convolution Operators
+		LazyImage operator+(Template<Type> &right) const;	///< Right linear convolution product.
+		LazyImage operator|(Template<Type> &right) const;	///< Right multiplicative maximum convolution product.
+		LazyImage operator&(Template<Type> &right) const;	///< Right multiplicative minimun convolution product.
+
+		template<int W, int H> LazyImage operator+(const FixedTemplate<Type, W, H> &right) const	///< Right linear convolution product.
+			{ return convolution(lazy_convolve_sum, right.data(), W, H); }
+		template<int W, int H> LazyImage operator|(const FixedTemplate<Type, W, H> &right) const	///< Right multiplicative maximum convolution product.
+			{ return convolution(lazy_convolve_max, right.data(), W, H); }
+		template<int W, int H> LazyImage operator&(const FixedTemplate<Type, W, H> &right) const	///< Right multiplicative minimun convolution product.
+			{ return convolution(lazy_convolve_min, right.data(), W, H); }
+
+	protected:
+		LazyImage(const node_pointer &node) : m_node(node) {}
+
+		LazyImage binary(lazy_op op, const LazyImage &right, const char *name) const;
+		LazyImage convolution(lazy_op op, const Type *coeff, int tWidth, int tHeight) const;
+		LazyImage convolution(lazy_op op, Template<Type> &tem) const;
+
+		node_pointer m_node;					///< The root node of the graph.
+	};
+
+	/** Makes a LazyImage from <i>im</i>, so that the operations on it are
+		deferred.
+	*/
+	template<class Type> LazyImage<Type> lazy(const Image<Type> &im) { return LazyImage<Type>(im); }
+
+	template<class Type> LazyImage<Type> operator+(const Type &left, const LazyImage<Type> &right) { return LazyImage<Type>::constant(left) + right; }	///< Pixel-wise addition.
+	template<class Type> LazyImage<Type> operator-(const Type &left, const LazyImage<Type> &right) { return LazyImage<Type>::constant(left) - right; }	///< Pixel-wise subtraction.
+	template<class Type> LazyImage<Type> operator*(const Type &left, const LazyImage<Type> &right) { return LazyImage<Type>::constant(left) * right; }	///< Pixel-wise multiplication.
+	template<class Type> LazyImage<Type> operator/(const Type &left, const LazyImage<Type> &right) { return LazyImage<Type>::constant(left) / right; }	///< Pixel-wise division.
+	template<class Type> LazyImage<Type> operator|(const Type &left, const LazyImage<Type> &right) { return LazyImage<Type>::constant(left) | right; }	///< Pixel-wise maximum.
+	template<class Type> LazyImage<Type> operator&(const Type &left, const LazyImage<Type> &right) { return LazyImage<Type>::constant(left) & right; }	///< Pixel-wise minimum.
+}	// end namespace
+
+// Include the function definitions in the header if we aren't using a compiled library
+#ifdef IMAGETL_NO_LIBRARY
+#include "LazyImage.cpp"
+#endif
+
+#endif
\ No newline at end of file
@@ -0,0 +1,243 @@
+#ifndef __MULTICHANNELIMAGE_CPP__
+#define __MULTICHANNELIMAGE_CPP__
+/** @file MultiChannelImage.cpp
+	Contains function definitions that are declared in MultiChannelImage.h
+*/
+
+#include <type_traits>
+#include "MultiChannelImage.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace ImageTL
+{
+	/** @class color_traits
+		The type that colour conversions of a pixel type are computed in, and
+		the value that its chroma channels are centred on.
+	*/
+	template<class Type> struct color_traits
+	{
+		typedef typename std::conditional<(sizeof(Type) <= 2 || std::is_same<Type, float>::value), float, double>::type work;
+		static double chroma() { return std::numeric_limits<Type>::is_signed?0.:(double(std::numeric_limits<Type>::max()/2) + 1.); }
+	};
+
+	/** @class color_kernel
+		Applies a 3x3 colour matrix to <i>n</i> pixels held as three planar
+		rows, <tt>out[k][i] = m[3k]*in[0][i] + m[3k+1]*in[1][i] + m[3k+2]*in[2][i] + add[k]</tt>
+		for the first <i>outs</i> rows of the matrix.  Float has an SSE2
+		version that converts four pixels at a time.
+	*/
+	template<class Work> struct color_kernel
+	{
+		static void run(Work *const in[3], Work *const out[3], int outs, const Work m[9], const Work add[3], int n)
+		{
+			for(int k = 0; k < outs; k++)
+			{
+				const Work *r = m + 3*k;
+				for(int i = 0; i < n; i++) {
+					out[k][i] = r[0]*in[0][i] + r[1]*in[1][i] + r[2]*in[2][i] + add[k]; }
+			}
+		}
+	};
+
+#ifdef __SSE2__
+	template<> struct color_kernel<float>
+	{
+		static void run(float *const in[3], float *const out[3], int outs, const float m[9], const float add[3], int n)
+		{
+			for(int k = 0; k < outs; k++)
+			{
+				const float *r = m + 3*k;
+				const __m128 m0 = _mm_set1_ps(r[0]), m1 = _mm_set1_ps(r[1]), m2 = _mm_set1_ps(r[2]), a = _mm_set1_ps(add[k]);
+				int i = 0;
+				for(; i + 4 <= n; i += 4)
+				{
+					__m128 sum = _mm_add_ps(_mm_mul_ps(m0, _mm_loadu_ps(in[0] + i)), a);
+					sum = _mm_add_ps(sum, _mm_mul_ps(m1, _mm_loadu_ps(in[1] + i)));
+					sum = _mm_add_ps(sum, _mm_mul_ps(m2, _mm_loadu_ps(in[2] + i)));
+					_mm_storeu_ps(out[k] + i, sum);
+				}
+				for(; i < n; i++) {
+					out[k][i] = r[0]*in[0][i] + r[1]*in[1][i] + r[2]*in[2][i] + add[k]; }
+			}
+		}
+	};
+#endif
+
+	// Finds the first value of each channel of an image and the distance
+	// between the values of neighbouring pixels
+	template<class Type> static void color_channels(Type *data, int channels, size_t pixels, batch_layout layout, Type *base[3], ptrdiff_t &step)
+	{
+		step = (layout == batch_planar)?1:channels;
+		for(int k = 0; k < channels && k < 3; k++) {
+			base[k] = data + ((layout == batch_planar)?(pixels*k):k); }
+	}
+
+	// Applies matrix to (pixel - inOffset) and adds outOffset for every pixel
+	// of src, writing outs channels to dest.  Blocks of pixels are gathered
+	// into planar rows of the work type, converted by the kernel and
+	// scattered back, so the source and destination may be the same.
+	template<class Type> static void color_transform(const MultiChannelImage<Type> &src, Type *const dest[3], ptrdiff_t destStep, int outs,
+													 const double matrix[9], const double inOffset[3], const double outOffset[3])
+	{
+		typedef typename color_traits<Type>::work work;
+		enum { block = 256 };
+
+		const size_t pixels = (size_t)src.width()*src.height();
+		Type *in[3];
+		ptrdiff_t step;
+		color_channels(const_cast<Type*>(src.data()), src.channels(), pixels, src.layout(), in, step);
+
+		work m[9], add[3];
+		for(int k = 0; k < outs; k++)
+		{
+			double a = outOffset[k];
+			for(int j = 0; j < 3; j++)
+			{
+				m[3*k + j] = work(matrix[3*k + j]);
+				a -= matrix[3*k + j]*inOffset[j];
+			}
+			add[k] = work(a);
+		}
+
+		const int blocks = (int)((pixels + block - 1)/block);
+		parallelFor(0, blocks, [&](int first, int last)
+		{
+			work buffer[6][block];
+			work *const bin[3]  = {buffer[0], buffer[1], buffer[2]};
+			work *const bout[3] = {buffer[3], buffer[4], buffer[5]};
+			for(int b = first; b < last; b++)
+			{
+				const size_t p0 = (size_t)b*block;
+				const int n = (int)std::min((size_t)block, pixels - p0);
+				for(int j = 0; j < 3; j++)
+				{
+					const Type *s = in[j] + p0*step;
+					for(int i = 0; i < n; i++) {
+						bin[j][i] = work(s[i*step]); }
+				}
+				color_kernel<work>::run(bin, bout, outs, m, add, n);
+				for(int k = 0; k < outs; k++)
+				{
+					Type *d = dest[k] + p0*destStep;
+					for(int i = 0; i < n; i++) {
+						d[i*destStep] = saturate_cast<Type>(bout[k][i]); }
+				}
+			}
+		}, 16);
+	}
+
+	// Checks that a colour image has three channels and makes dest a three
+	// channel image of the same size and layout
+	template<class Type> static void color_prepare(const MultiChannelImage<Type> &src, MultiChannelImage<Type> &dest, const char *name)
+	{
+		if(src.channels() != 3)
+		{
+			std::stringstream msg_stream;
+			msg_stream<<name<<" [The image does not have 3 channels]";
+			throw ImageException(msg_stream.str());
+		}
+		if(dest.channels() != 3 || dest.width() != src.width() || dest.height() != src.height() || dest.layout() != src.layout()) {
+			dest = MultiChannelImage<Type>(3, src.width(), src.height(), src.layout(), src.edgeHandling()); }
+	}
+
+	// Constructor
+	template<class Type> MultiChannelImage<Type>::MultiChannelImage(const std::vector<Image<Type> > &channels, batch_layout layout)
+		: ImageBatch<Type>((int)channels.size(), channels.empty()?0:channels[0].width(), channels.empty()?0:channels[0].height(), layout,
+						   channels.empty()?edge_clamp:channels[0].edgeHandling())
+	{
+		for(int c = 0; c < (int)channels.size(); c++) {
+			this->set(c, channels[c]); }
+	}
+
+	// Colour conversion
+	template<class Type> void rgbToGray(const MultiChannelImage<Type> &rgb, Image<Type> &gray)
+	{
+		if(rgb.channels() != 3) {
+			throw ImageException("rgbToGray [The image does not have 3 channels]"); }
+		if(gray.width() != rgb.width() || gray.height() != rgb.height()) {
+			gray.resize(rgb.width(), rgb.height(), false); }
+		gray.edgeHandling() = rgb.edgeHandling();
+
+		static const double luma[9] = {0.299, 0.587, 0.114};
+		static const double zero[3] = {0., 0., 0.};
+		Type *dest[3] = {gray.data(), NULL, NULL};
+		color_transform(rgb, dest, 1, 1, luma, zero, zero);
+	}
+
+	template<class Type> void rgbToYCbCr(const MultiChannelImage<Type> &rgb, MultiChannelImage<Type> &ycbcr)
+	{
+		color_prepare(rgb, ycbcr, "rgbToYCbCr");
+
+		static const double matrix[9] = { 0.299,     0.587,     0.114,
+										  -0.168736, -0.331264,  0.5,
+										   0.5,      -0.418688, -0.081312};
+		const double c = color_traits<Type>::chroma();
+		const double in[3] = {0., 0., 0.}, out[3] = {0., c, c};
+		Type *dest[3];
+		ptrdiff_t step;
+		color_channels(ycbcr.data(), 3, (size_t)ycbcr.width()*ycbcr.height(), ycbcr.layout(), dest, step);
+		color_transform(rgb, dest, step, 3, matrix, in, out);
+	}
+
+	template<class Type> void yCbCrToRgb(const MultiChannelImage<Type> &ycbcr, MultiChannelImage<Type> &rgb)
+	{
+		color_prepare(ycbcr, rgb, "yCbCrToRgb");
+
+		static const double matrix[9] = {1.,  0.,        1.402,
+										 1., -0.344136, -0.714136,
+										 1.,  1.772,     0.};
+		const double c = color_traits<Type>::chroma();
+		const double in[3] = {0., c, c}, out[3] = {0., 0., 0.};
+		Type *dest[3];
+		ptrdiff_t step;
+		color_channels(rgb.data(), 3, (size_t)rgb.width()*rgb.height(), rgb.layout(), dest, step);
+		color_transform(ycbcr, dest, step, 3, matrix, in, out);
+	}
+}	//End namespace
+
+// Instantiate with common template types for library compilation
+#ifdef IMAGETL_LIBRARY_COMPILE
+namespace ImageTL
+{
+	template class MultiChannelImage<char>;
+	template class MultiChannelImage<unsigned char>;
+	template class MultiChannelImage<short>;
+	template class MultiChannelImage<unsigned short>;
+	template class MultiChannelImage<int>;
+	template class MultiChannelImage<long>;
+	template class MultiChannelImage<float>;
+	template class MultiChannelImage<double>;
+
+	template void rgbToGray(const MultiChannelImage<char>&,           Image<char>&);
+	template void rgbToGray(const MultiChannelImage<unsigned char>&,  Image<unsigned char>&);
+	template void rgbToGray(const MultiChannelImage<short>&,          Image<short>&);
+	template void rgbToGray(const MultiChannelImage<unsigned short>&, Image<unsigned short>&);
+	template void rgbToGray(const MultiChannelImage<int>&,            Image<int>&);
+	template void rgbToGray(const MultiChannelImage<long>&,           Image<long>&);
+	template void rgbToGray(const MultiChannelImage<float>&,          Image<float>&);
+	template void rgbToGray(const MultiChannelImage<double>&,         Image<double>&);
+
+	template void rgbToYCbCr(const MultiChannelImage<char>&,           MultiChannelImage<char>&);
+	template void rgbToYCbCr(const MultiChannelImage<unsigned char>&,  MultiChannelImage<unsigned char>&);
+	template void rgbToYCbCr(const MultiChannelImage<short>&,          MultiChannelImage<short>&);
+	template void rgbToYCbCr(const MultiChannelImage<unsigned short>&, MultiChannelImage<unsigned short>&);
+	template void rgbToYCbCr(const MultiChannelImage<int>&,            MultiChannelImage<int>&);
+	template void rgbToYCbCr(const MultiChannelImage<long>&,           MultiChannelImage<long>&);
+	template void rgbToYCbCr(const MultiChannelImage<float>&,          MultiChannelImage<float>&);
+	template void rgbToYCbCr(const MultiChannelImage<double>&,         MultiChannelImage<double>&);
+
+	template void yCbCrToRgb(const MultiChannelImage<char>&,           MultiChannelImage<char>&);
+	template void yCbCrToRgb(const MultiChannelImage<unsigned char>&,  MultiChannelImage<unsigned char>&);
+	template void yCbCrToRgb(const MultiChannelImage<short>&,          MultiChannelImage<short>&);
+	template void yCbCrToRgb(const MultiChannelImage<unsigned short>&, MultiChannelImage<unsigned short>&);
+	template void yCbCrToRgb(const MultiChannelImage<int>&,            MultiChannelImage<int>&);
+	template void yCbCrToRgb(const MultiChannelImage<long>&,           MultiChannelImage<long>&);
+	template void yCbCrToRgb(const MultiChannelImage<float>&,          MultiChannelImage<float>&);
+	template void yCbCrToRgb(const MultiChannelImage<double>&,         MultiChannelImage<double>&);
+}
+#endif
+
+#endif
\ No newline at end of file
@@ -0,0 +1,111 @@
+#ifndef __MULTICHANNELIMAGE_H__
+#define __MULTICHANNELIMAGE_H__
+/** @file MultiChannelImage.h
+	Contains the MultiChannelImage class, an image with several values per
+	pixel, and the colour space conversions between RGB, YCbCr and gray.
+*/
+
+#include <vector>
+#include "ImageBatch.h"
+
+namespace ImageTL
+{
+	/** @class MultiChannelImage
+		An image with several channels, such as the red, green and blue of a
+		colour image.  The channels are the images of an ImageBatch, so they
+		are stored in one allocation, either planar, where each channel is
+		stored whole, or interleaved, where the channels of each pixel are
+		stored together.  setLayout() converts between the two with a blocked
+		transpose.
+
+		Every operator of ImageBatch is inherited, and so runs over all of the
+		channels in one sweep: the pixel-wise operators over the whole buffer,
+		and convolutions over the channels of a row at once, which for an
+		interleaved image is one contiguous span.
+		@code
+		std::vector<Image<float> > rgb(3);
+		bmp.readChannels("photo.bmp", rgb[0], rgb[1], rgb[2]);
+		MultiChannelImage<float> colour(rgb);
+		MultiChannelImage<float> smooth = colour + gauss;
+		Image<float> gray;
+		rgbToGray(smooth, gray);
+		@endcode
+	*/
+	template<class Type> class MultiChannelImage : public ImageBatch<Type>
+	{
+	public:
+		/** Creates an image of <i>channels</i> channels of <i>width</i> x
+			<i>height</i> pixels, all zero.
+			@throw ImageException If any dimension is negative.
+		*/
+		MultiChannelImage(int channels = 0, int width = 0, int height = 0, batch_layout layout = batch_interleaved, edge_handling eh = edge_clamp)
+			: ImageBatch<Type>(channels, width, height, layout, eh) {}
+
+		/** Takes the images of <i>batch</i> as its channels, so the results of
+			the ImageBatch operators can be assigned to a MultiChannelImage.
+		*/
+		MultiChannelImage(const ImageBatch<Type> &batch) : ImageBatch<Type>(batch) {}
+
+		/** Creates an image whose channels are copies of <i>channels</i>,
+			which must all be the same size.  The edge handling of the first
+			channel is used.
+			@throw ImageException If the channels are not the same size.
+		*/
+		explicit MultiChannelImage(const std::vector<Image<Type> > &channels, batch_layout layout = batch_interleaved);
+
+		int channels() const { return this->count(); }	///< Returns the number of channels.
+
+		/** Returns pixel (<i>x</i>,<i>y</i>) of channel <i>c</i>, which must be
+			inside the image.
+		*/
+		Type&       operator()(int x, int y, int c)       { return this->pixel(c, x, y); }
+		const Type& operator()(int x, int y, int c) const { return this->pixel(c, x, y); }	///< @copydoc operator()(int,int,int)
+
+		/** Copies channel <i>c</i> into <i>im</i>, resizing it if needed.
+			@throw ImageException If there is no such channel.
+		*/
+		void channel(int c, Image<Type> &im) const { this->get(c, im); }
+
+		/** Copies <i>im</i> into channel <i>c</i>.
+			@throw ImageException If there is no such channel or <i>im</i> is
+				the wrong size.
+		*/
+		void setChannel(int c, const Image<Type> &im) { this->set(c, im); }
+	};
+
+	/** Converts an RGB image to gray with the ITU-R BT.601 weights
+		(0.299 R + 0.587 G + 0.114 B), as BmpImage reads bmp_luma.
+		The weights are applied to blocks of pixels with SSE2.
+		@param rgb An image with red, green and blue channels in that order.
+		@param gray Resized to the image and set to the gray levels.
+		@throw ImageException If <i>rgb</i> does not have 3 channels.
+	*/
+	template<class Type> void rgbToGray(const MultiChannelImage<Type> &rgb, Image<Type> &gray);
+
+	/** Converts an RGB image to YCbCr with the full range BT.601 matrix of
+		JPEG.  The chroma channels are centred on zero for signed and real
+		types and on half the range for unsigned types, e.g. 128 for
+		unsigned char.  The matrix is applied to blocks of pixels with SSE2.
+		@param rgb An image with red, green and blue channels in that order.
+		@param ycbcr Set to the Y, Cb and Cr channels in the layout of
+			<i>rgb</i>.
+		@throw ImageException If <i>rgb</i> does not have 3 channels.
+	*/
+	template<class Type> void rgbToYCbCr(const MultiChannelImage<Type> &rgb, MultiChannelImage<Type> &ycbcr);
+
+	/** Converts a YCbCr image made by rgbToYCbCr() back to RGB, saturating to
+		the range of the type.
+		@param ycbcr An image with Y, Cb and Cr channels in that order.
+		@param rgb Set to the red, green and blue channels in the layout of
+			<i>ycbcr</i>.
+		@throw ImageException If <i>ycbcr</i> does not have 3 channels.
+	*/
+	template<class Type> void yCbCrToRgb(const MultiChannelImage<Type> &ycbcr, MultiChannelImage<Type> &rgb);
+}	// end namespace
+
+// Include the function definitions in the header if we aren't using a compiled library
+#ifdef IMAGETL_NO_LIBRARY
+#include "MultiChannelImage.cpp"
+#endif
+
+#endif
\ No newline at end of file
@@ -93,7 +93,9 @@ namespace ImageTL
 namespace ImageTL
 {
 	template class OWAIterator<char>;
+	template class OWAIterator<unsigned char>;
 	template class OWAIterator<short>;
+	template class OWAIterator<unsigned short>;
 	template class OWAIterator<int>;
 	template class OWAIterator<long>;
 	template class OWAIterator<float>;
@@ -105,6 +105,7 @@ namespace ImageTL
 				throw ImageException((std::string("PgmImage::readData [Error reading data in ") + file) + "]"); }
 
 			// Allocate memory for the image
+			this->freeImage(this->m_image);
 			this->m_image = this->allocateImage();
 
 			// Skip the header in the pgm file
@@ -263,7 +264,9 @@ namespace ImageTL
 namespace ImageTL
 {
 	template class PgmImage<char>;
+	template class PgmImage<unsigned char>;
 	template class PgmImage<short>;
+	template class PgmImage<unsigned short>;
 	template class PgmImage<int>;
 	template class PgmImage<long>;
 	template class PgmImage<float>;
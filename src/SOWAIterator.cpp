@@ -74,7 +74,9 @@ namespace ImageTL
 namespace ImageTL
 {
 	template class SOWAIterator<char>;
+	template class SOWAIterator<unsigned char>;
 	template class SOWAIterator<short>;
+	template class SOWAIterator<unsigned short>;
 	template class SOWAIterator<int>;
 	template class SOWAIterator<long>;
 	template class SOWAIterator<float>;
@@ -0,0 +1,287 @@
+#ifndef __SATURATE_H__
+#define __SATURATE_H__
+/** @file Saturate.h
+	Contains the wide accumulator types, saturating conversions, and the
+	saturating pixel-wise arithmetic for integer images.
+	The pixel-wise operators of Image wrap on overflow like the built-in
+	integer types.  The functions in this header clamp the result to the
+	range of the pixel type instead, with SSE2 saturating instructions for 8
+	and 16 bit images.
+*/
+
+#include <limits>
+#include <complex>
+#include <cstddef>
+#include <string>
+#include "ImageThreads.h"
+#include "ImageException.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace ImageTL
+{
+	template<class Type> class Image;
+
+	/** @class wide_traits
+		The type that sums and products of a pixel type are computed in.
+		8 bit and signed 16 bit pixels are widened to int, and unsigned 16
+		bit pixels, whose products don't fit in an int, and 32 bit integers
+		to long long.  Every other type is its own wide type, so long images
+		still wrap on overflow.
+	*/
+	template<class Type> struct wide_traits                 { typedef Type type; };
+	template<> struct wide_traits<char>                     { typedef int type; };
+	template<> struct wide_traits<signed char>              { typedef int type; };
+	template<> struct wide_traits<unsigned char>            { typedef int type; };
+	template<> struct wide_traits<short>                    { typedef int type; };
+	template<> struct wide_traits<unsigned short>           { typedef long long type; };
+	template<> struct wide_traits<int>                      { typedef long long type; };
+	template<> struct wide_traits<unsigned int>             { typedef long long type; };
+
+	// Clamps an integer or rounds and clamps a real value into an integer type
+	template<class Dst, class Src, bool DstInteger = std::numeric_limits<Dst>::is_integer,
+			 bool SrcInteger = std::numeric_limits<Src>::is_integer> struct saturate_convert
+	{
+		static Dst run(const Src &value) { return Dst(value); }
+	};
+
+	template<class Dst, class Src> struct saturate_convert<Dst, Src, true, true>
+	{
+		static Dst run(const Src &value)
+		{
+			typedef std::numeric_limits<Dst> limits;
+			if(std::numeric_limits<Src>::is_signed)
+			{
+				long long n = (long long)value;
+				if(n < 0 && (!limits::is_signed || n < (long long)limits::min())) {
+					return limits::min(); }
+				if(n > 0 && (limits::digits < 64) && (unsigned long long)n > (unsigned long long)limits::max()) {
+					return limits::max(); }
+			}
+			else if((unsigned long long)value > (unsigned long long)limits::max()) {
+				return limits::max(); }
+			return Dst(value);
+		}
+	};
+
+	template<class Dst, class Src> struct saturate_convert<Dst, Src, true, false>
+	{
+		static Dst run(const Src &value)
+		{
+			typedef std::numeric_limits<Dst> limits;
+			if(value != value) {
+				return Dst(0); }
+			if(value <= (Src)limits::min()) {
+				return limits::min(); }
+			if(value >= (Src)limits::max()) {
+				return limits::max(); }
+			return Dst((value < 0)?(value - Src(0.5)):(value + Src(0.5)));
+		}
+	};
+
+	/** Converts <i>value</i> to <i>Dst</i>, clamping it to the range of an
+		integer type.  Real values are rounded to the nearest integer, and NaN
+		becomes zero.  Conversions to real types are plain casts.
+	*/
+	template<class Dst, class Src> inline Dst saturate_cast(const Src &value) { return saturate_convert<Dst, Src>::run(value); }
+
+	template<class Type> inline Type saturate_add(const Type &a, const Type &b)		///< Returns a + b clamped to the range of the type.
+	{
+		typedef typename wide_traits<Type>::type wide;
+		return saturate_cast<Type>(wide(a) + wide(b));
+	}
+	template<class Type> inline Type saturate_sub(const Type &a, const Type &b)		///< Returns a - b clamped to the range of the type.
+	{
+		typedef typename wide_traits<Type>::type wide;
+		return saturate_cast<Type>(wide(a) - wide(b));
+	}
+	template<class Type> inline Type saturate_mul(const Type &a, const Type &b)		///< Returns a*b clamped to the range of the type.
+	{
+		typedef typename wide_traits<Type>::type wide;
+		return saturate_cast<Type>(wide(a)*wide(b));
+	}
+
+	/** The saturating operations that saturate_span() can apply. */
+	enum saturate_op
+	{
+		saturate_op_add,		///< a + b
+		saturate_op_sub,		///< a - b
+		saturate_op_mul			///< a*b
+	};
+
+	/** @class saturate_simd
+		The SSE2 saturating instructions of a pixel type.
+		The general version has no lanes, so saturate_span() only uses the
+		scalar functions.
+	*/
+	template<class Type> struct saturate_simd { enum { lanes = 0 }; };
+
+#ifdef __SSE2__
+	// Loads 8 bytes as 16 bit lanes
+	inline __m128i saturate_widen_u8(const unsigned char *p) { return _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)p), _mm_setzero_si128()); }
+	inline __m128i saturate_widen_s8(const signed char *p)   { __m128i v = _mm_loadl_epi64((const __m128i*)p); return _mm_srai_epi16(_mm_unpacklo_epi8(v, v), 8); }
+
+	template<> struct saturate_simd<unsigned char>
+	{
+		enum { lanes = 16 };
+		static __m128i set1(unsigned char n) { return _mm_set1_epi8((char)n); }
+		static __m128i add(__m128i a, __m128i b) { return _mm_adds_epu8(a, b); }
+		static __m128i sub(__m128i a, __m128i b) { return _mm_subs_epu8(a, b); }
+		static __m128i mul(__m128i a, __m128i b)
+		{
+			// The 16 bit products are exact, and min(p, 255) = p - subs(p, 255)
+			const __m128i zero = _mm_setzero_si128(), top = _mm_set1_epi16(255);
+			__m128i lo = _mm_mullo_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+			__m128i hi = _mm_mullo_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+			lo = _mm_sub_epi16(lo, _mm_subs_epu16(lo, top));
+			hi = _mm_sub_epi16(hi, _mm_subs_epu16(hi, top));
+			return _mm_packus_epi16(lo, hi);
+		}
+	};
+
+	template<> struct saturate_simd<signed char>
+	{
+		enum { lanes = 16 };
+		static __m128i set1(signed char n) { return _mm_set1_epi8(n); }
+		static __m128i add(__m128i a, __m128i b) { return _mm_adds_epi8(a, b); }
+		static __m128i sub(__m128i a, __m128i b) { return _mm_subs_epi8(a, b); }
+		static __m128i mul(__m128i a, __m128i b)
+		{
+			// The 16 bit products are exact, and packs clamps them
+			__m128i lo = _mm_mullo_epi16(_mm_srai_epi16(_mm_unpacklo_epi8(a, a), 8), _mm_srai_epi16(_mm_unpacklo_epi8(b, b), 8));
+			__m128i hi = _mm_mullo_epi16(_mm_srai_epi16(_mm_unpackhi_epi8(a, a), 8), _mm_srai_epi16(_mm_unpackhi_epi8(b, b), 8));
+			return _mm_packs_epi16(lo, hi);
+		}
+	};
+
+	// char is signed wherever SSE2 is available unless the compiler is told otherwise
+	template<> struct saturate_simd<char> : public saturate_simd<signed char>
+	{
+		enum { lanes = std::numeric_limits<char>::is_signed?16:0 };
+		static __m128i set1(char n) { return _mm_set1_epi8(n); }
+	};
+
+	template<> struct saturate_simd<unsigned short>
+	{
+		enum { lanes = 8 };
+		static __m128i set1(unsigned short n) { return _mm_set1_epi16((short)n); }
+		static __m128i add(__m128i a, __m128i b) { return _mm_adds_epu16(a, b); }
+		static __m128i sub(__m128i a, __m128i b) { return _mm_subs_epu16(a, b); }
+		static __m128i mul(__m128i a, __m128i b)
+		{
+			// Lanes whose high half of the product is not zero become 0xFFFF
+			__m128i lo = _mm_mullo_epi16(a, b), hi = _mm_mulhi_epu16(a, b);
+			__m128i fits = _mm_cmpeq_epi16(hi, _mm_setzero_si128());
+			return _mm_or_si128(lo, _mm_andnot_si128(fits, _mm_cmpeq_epi16(lo, lo)));
+		}
+	};
+
+	template<> struct saturate_simd<short>
+	{
+		enum { lanes = 8 };
+		static __m128i set1(short n) { return _mm_set1_epi16(n); }
+		static __m128i add(__m128i a, __m128i b) { return _mm_adds_epi16(a, b); }
+		static __m128i sub(__m128i a, __m128i b) { return _mm_subs_epi16(a, b); }
+		static __m128i mul(__m128i a, __m128i b)
+		{
+			// Rebuild the 32 bit products, and packs clamps them
+			__m128i lo = _mm_mullo_epi16(a, b), hi = _mm_mulhi_epi16(a, b);
+			return _mm_packs_epi32(_mm_unpacklo_epi16(lo, hi), _mm_unpackhi_epi16(lo, hi));
+		}
+	};
+#endif
+
+	template<class Type, saturate_op Op> inline Type saturate_apply(const Type &a, const Type &b)
+	{
+		return (Op == saturate_op_add)?saturate_add(a, b):((Op == saturate_op_sub)?saturate_sub(a, b):saturate_mul(a, b));
+	}
+
+	// Applies Op to n pixels with SIMD, returning the number of pixels done
+	template<class Type, saturate_op Op, int Lanes = saturate_simd<Type>::lanes> struct saturate_vector
+	{
+		static size_t run(const Type *, const Type *, bool, Type *, size_t) { return 0; }
+	};
+
+#ifdef __SSE2__
+	template<class Type, saturate_op Op> struct saturate_vector<Type, Op, 16>
+	{
+		static size_t run(const Type *a, const Type *b, bool scalar, Type *out, size_t n) { return saturate_vector<Type, Op, 8>::block(a, b, scalar, out, n, 16); }
+	};
+
+	template<class Type, saturate_op Op> struct saturate_vector<Type, Op, 8>
+	{
+		static size_t run(const Type *a, const Type *b, bool scalar, Type *out, size_t n) { return block(a, b, scalar, out, n, 8); }
+
+		static size_t block(const Type *a, const Type *b, bool scalar, Type *out, size_t n, size_t lanes)
+		{
+			typedef saturate_simd<Type> simd;
+			const __m128i value = scalar?simd::set1(*b):_mm_setzero_si128();
+			size_t i = 0;
+			for(; i + lanes <= n; i += lanes)
+			{
+				__m128i va = _mm_loadu_si128((const __m128i*)(a + i));
+				__m128i vb = scalar?value:_mm_loadu_si128((const __m128i*)(b + i));
+				__m128i r = (Op == saturate_op_add)?simd::add(va, vb):((Op == saturate_op_sub)?simd::sub(va, vb):simd::mul(va, vb));
+				_mm_storeu_si128((__m128i*)(out + i), r);
+			}
+			return i;
+		}
+	};
+#endif
+
+	/** Applies the saturating operation <i>Op</i> to <i>n</i> pixels, where
+		<i>b</i> is a single value if <i>scalar</i> is true.  <i>out</i> may
+		be the same as <i>a</i> or <i>b</i>.
+	*/
+	template<class Type, saturate_op Op> void saturate_span(const Type *a, const Type *b, bool scalar, Type *out, size_t n)
+	{
+		size_t i = saturate_vector<Type, Op>::run(a, b, scalar, out, n);
+		for(; i < n; i++) {
+			out[i] = saturate_apply<Type, Op>(a[i], scalar?*b:b[i]); }
+	}
+
+	// Applies Op to every pixel of left with right or value, in bands of rows
+	template<class Type, saturate_op Op> Image<Type> saturate_image(const Image<Type> &left, const Image<Type> *right, const Type &value, const char *name)
+	{
+		if(right != NULL && (left.width() != right->width() || left.height() != right->height()))
+		{
+			std::string msg = name;
+			throw ImageException(msg + " [Unmatched dimensions for operator]");
+		}
+
+		Image<Type> result(left, false);
+		const size_t width = left.width();
+		Type *const out = result.data();
+		parallelFor(0, left.height(), [&](int first, int last)
+		{
+			const size_t offset = width*first, count = width*(last - first);
+			if(right != NULL) {
+				saturate_span<Type, Op>(left.data() + offset, right->data() + offset, false, out + offset, count); }
+			else {
+				saturate_span<Type, Op>(left.data() + offset, &value, true, out + offset, count); }
+		}, 64);
+		return result;
+	}
+
+	/** Pixel-wise addition that clamps to the range of the pixel type.
+		@throw ImageException If the images have different dimensions.
+	*/
+	template<class Type> Image<Type> saturatedAdd(const Image<Type> &left, const Image<Type> &right) { return saturate_image<Type, saturate_op_add>(left, &right, Type(), "saturatedAdd"); }
+	template<class Type> Image<Type> saturatedAdd(const Image<Type> &left, const Type &right) { return saturate_image<Type, saturate_op_add>(left, NULL, right, "saturatedAdd"); }	///< @copydoc saturatedAdd()
+
+	/** Pixel-wise subtraction that clamps to the range of the pixel type.
+		@throw ImageException If the images have different dimensions.
+	*/
+	template<class Type> Image<Type> saturatedSubtract(const Image<Type> &left, const Image<Type> &right) { return saturate_image<Type, saturate_op_sub>(left, &right, Type(), "saturatedSubtract"); }
+	template<class Type> Image<Type> saturatedSubtract(const Image<Type> &left, const Type &right) { return saturate_image<Type, saturate_op_sub>(left, NULL, right, "saturatedSubtract"); }	///< @copydoc saturatedSubtract()
+
+	/** Pixel-wise multiplication that clamps to the range of the pixel type.
+		@throw ImageException If the images have different dimensions.
+	*/
+	template<class Type> Image<Type> saturatedMultiply(const Image<Type> &left, const Image<Type> &right) { return saturate_image<Type, saturate_op_mul>(left, &right, Type(), "saturatedMultiply"); }
+	template<class Type> Image<Type> saturatedMultiply(const Image<Type> &left, const Type &right) { return saturate_image<Type, saturate_op_mul>(left, NULL, right, "saturatedMultiply"); }	///< @copydoc saturatedMultiply()
+}	// end namespace
+
+#endif
\ No newline at end of file
@@ -244,21 +244,27 @@ namespace ImageTL
 namespace ImageTL
 {
 	template class Template<char>;
+	template class Template<unsigned char>;
 	template class Template<short>;
+	template class Template<unsigned short>;
 	template class Template<int>;
 	template class Template<long>;
 	template class Template<float>;
 	template class Template<double>;
 
 	template class ConstantTemplate<char>;
+	template class ConstantTemplate<unsigned char>;
 	template class ConstantTemplate<short>;
+	template class ConstantTemplate<unsigned short>;
 	template class ConstantTemplate<int>;
 	template class ConstantTemplate<long>;
 	template class ConstantTemplate<float>;
 	template class ConstantTemplate<double>;
 
 	template class FunctionalTemplate<char>;
+	template class FunctionalTemplate<unsigned char>;
 	template class FunctionalTemplate<short>;
+	template class FunctionalTemplate<unsigned short>;
 	template class FunctionalTemplate<int>;
 	template class FunctionalTemplate<long>;
 	template class FunctionalTemplate<float>;
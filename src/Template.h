@@ -2,6 +2,7 @@
 #define __TEMPLATE_H__
 
 #include <list>
+#include <cstddef>
 #include <sstream>
 #include "ImageException.h"
 
@@ -75,6 +76,14 @@ namespace ImageTL
 		*/
 		virtual Type operator()(int x, int y) const = 0;
 
+		/** Returns the values of the template in row-major order, or NULL if
+			the values depend on the center of the template.
+			When the values are available, a convolution can read them directly
+			instead of calling operator()() for every tap.
+			@see convolve()
+		*/
+		virtual const Type* coefficients() const { return NULL; }
+
 		/** A constructor that sets all of the Template parameters.
 			@param width The width of the template.
 			@param height The height of the template.
@@ -105,6 +114,7 @@ namespace ImageTL
 		Type  operator()(int x, int y) const;
 		Type& operator()(int x, int y);
 		Type& operator()(int index);
+		const Type* coefficients() const { return m_data; }
 
 		ConstantTemplate& operator+=(Type value);
 		ConstantTemplate& operator-=(Type value);